@@ -0,0 +1,186 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <wayland-server-core.h>
+#include "sway/commands.h"
+#include "sway/config.h"
+#include "sway/input/seat.h"
+#include "sway/ipc-server.h"
+#include "sway/server.h"
+#include "sway/tree/container.h"
+#include "sway/tree/root.h"
+#include "list.h"
+#include "log.h"
+
+/**
+ * Compares running a binding's command through execute_command, which parses
+ * it on every keypress, with the compiled form bindings keep, which is run by
+ * execute_compiled_command. Reports the time and number of allocations per
+ * keypress for each.
+ *
+ * The commands run against a container which isn't part of any workspace, so
+ * that no outputs are needed. Usage:
+ *
+ *     bench-commands [keypresses]
+ */
+
+struct sway_server server = {0};
+struct sway_debug debug = {0};
+
+void sway_terminate(int exit_code) {
+	exit(exit_code);
+}
+
+static size_t allocations = 0;
+
+#ifdef __GLIBC__
+// Count the allocations of sway and the libraries it uses, including those
+// made by libc itself, such as in strdup
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t nmemb, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+
+void *malloc(size_t size) {
+	++allocations;
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+	++allocations;
+	return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+	++allocations;
+	return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+	__libc_free(ptr);
+}
+#endif
+
+static const char bench_config[] =
+	"set $mark terminal\n"
+	"set $opacity 0.9\n";
+
+/**
+ * Bindings modelled on common configs: a plain command, a command list using
+ * variables, and criteria which don't match anything.
+ */
+static const char *bindings[] = {
+	"opacity set 1",
+	"mark --add --toggle $mark; opacity set $opacity, opacity plus 0.05",
+	"[app_id=\"^firefox$\" title=\"Private\"] opacity set 0.8; "
+		"mark --add --toggle $mark",
+};
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void free_results(list_t *res_list) {
+	for (int i = 0; i < res_list->length; ++i) {
+		free_cmd_results(res_list->items[i]);
+	}
+	list_free(res_list);
+}
+
+static void report(const char *command, const char *method, double elapsed,
+		size_t allocs, int keypresses) {
+	printf("%-18s %8.3f us %8.1f allocations  %s\n", method,
+			elapsed / keypresses * 1e6, (double)allocs / keypresses, command);
+}
+
+static void bench_binding(const char *binding, struct sway_seat *seat,
+		struct sway_container *con, int keypresses) {
+	char *command = strdup(binding);
+
+	size_t start_allocs = allocations;
+	double start = now();
+	for (int i = 0; i < keypresses; ++i) {
+		free_results(execute_command(command, seat, con));
+	}
+	report(command, "execute_command", now() - start,
+			allocations - start_allocs, keypresses);
+
+	// The first run compiles the command, as it does for a binding
+	struct cmd_program *program = NULL;
+	start_allocs = allocations;
+	start = now();
+	free_results(execute_compiled_command(&program, command, seat, con));
+	report(command, "compile and run", now() - start,
+			allocations - start_allocs, 1);
+
+	start_allocs = allocations;
+	start = now();
+	for (int i = 0; i < keypresses; ++i) {
+		free_results(execute_compiled_command(&program, command, seat, con));
+	}
+	report(command, "compiled", now() - start,
+			allocations - start_allocs, keypresses);
+
+	cmd_program_unref(program);
+	free(command);
+}
+
+static bool write_config(char *path) {
+	int fd = mkstemp(path);
+	if (fd == -1) {
+		return false;
+	}
+	size_t len = strlen(bench_config);
+	bool success = write(fd, bench_config, len) == (ssize_t)len;
+	close(fd);
+	return success;
+}
+
+int main(int argc, char **argv) {
+	sway_log_init(SWAY_ERROR, NULL);
+
+	int keypresses = argc > 1 ? atoi(argv[1]) : 100000;
+	if (keypresses <= 0) {
+		fprintf(stderr, "Usage: %s [keypresses]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	// The IPC server is needed for the events the commands send, but not
+	// the rest of the compositor
+	char sock[64];
+	snprintf(sock, sizeof(sock), "/tmp/bench-commands-%d.sock", getpid());
+	setenv("SWAYSOCK", sock, 1);
+	server.wl_display = wl_display_create();
+	server.wl_event_loop = wl_display_get_event_loop(server.wl_display);
+	root = root_create();
+	ipc_init(&server);
+
+	char config_path[] = "/tmp/bench-commands-XXXXXX";
+	if (!write_config(config_path) ||
+			!load_main_config(config_path, false, false)) {
+		sway_log(SWAY_ERROR, "Unable to load the benchmark config");
+		unlink(config_path);
+		return EXIT_FAILURE;
+	}
+	unlink(config_path);
+	config->active = true;
+
+	// Commands only look up the focus of the seat when no container is given
+	struct sway_seat seat = {0};
+	wl_list_init(&seat.focus_stack);
+	struct sway_container *con = container_create(NULL);
+
+	printf("%d keypresses per command\n", keypresses);
+	for (size_t i = 0; i < sizeof(bindings) / sizeof(bindings[0]); ++i) {
+		bench_binding(bindings[i], &seat, con, keypresses);
+	}
+
+	wl_display_destroy(server.wl_display);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,374 @@
+#define _POSIX_C_SOURCE 200809L
+#include <json.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ipc-encoding.h"
+#include "log.h"
+#include "sway/json-writer.h"
+
+/**
+ * Compares building IPC payloads as json-c object graphs with streaming them
+ * through json_writer, and parsing them again with json-c and msgpack_parse.
+ *
+ * The payloads are modelled on the get_tree and get_workspaces replies and on
+ * a stream of window events for a synthetic layout. Usage:
+ *
+ *     bench-ipc-encoding [outputs] [workspaces per output] [views per workspace]
+ */
+
+struct bench_node {
+	int id;
+	char name[64];
+	const char *type;
+	const char *layout;
+	int x, y, width, height;
+	bool focused;
+	char app_id[32];
+	int pid;
+	struct bench_node *children;
+	int nchildren;
+};
+
+static int next_id = 1;
+
+static void init_node(struct bench_node *node, const char *type,
+		const char *name, int width, int height) {
+	memset(node, 0, sizeof(struct bench_node));
+	node->id = next_id++;
+	node->type = type;
+	node->layout = "splith";
+	node->width = width;
+	node->height = height;
+	snprintf(node->name, sizeof(node->name), "%s", name);
+}
+
+static void create_tree(struct bench_node *root, int outputs, int workspaces,
+		int views) {
+	init_node(root, "root", "root", 1920 * outputs, 1080);
+	root->nchildren = outputs;
+	root->children = calloc(outputs, sizeof(struct bench_node));
+	for (int o = 0; o < outputs; ++o) {
+		struct bench_node *output = &root->children[o];
+		char name[64];
+		snprintf(name, sizeof(name), "DP-%d", o + 1);
+		init_node(output, "output", name, 1920, 1080);
+		output->x = 1920 * o;
+		output->layout = "output";
+		output->nchildren = workspaces;
+		output->children = calloc(workspaces, sizeof(struct bench_node));
+		for (int w = 0; w < workspaces; ++w) {
+			struct bench_node *ws = &output->children[w];
+			snprintf(name, sizeof(name), "%d", o * workspaces + w + 1);
+			init_node(ws, "workspace", name, 1920, 1080);
+			ws->x = output->x;
+			ws->layout = w % 2 ? "tabbed" : "splith";
+			ws->nchildren = views;
+			ws->children = calloc(views, sizeof(struct bench_node));
+			for (int v = 0; v < views; ++v) {
+				struct bench_node *con = &ws->children[v];
+				snprintf(name, sizeof(name),
+						"user@host: ~/src/project-%d - vim file%d.c", v, v);
+				init_node(con, "con", name, 1920 / views, 1080);
+				con->x = ws->x + v * con->width;
+				con->focused = o == 0 && w == 0 && v == 0;
+				snprintf(con->app_id, sizeof(con->app_id), "terminal-%d", v % 4);
+				con->pid = 1000 + con->id;
+			}
+		}
+	}
+}
+
+static void destroy_tree(struct bench_node *node) {
+	for (int i = 0; i < node->nchildren; ++i) {
+		destroy_tree(&node->children[i]);
+	}
+	free(node->children);
+}
+
+static json_object *describe_rect(const struct bench_node *node) {
+	json_object *rect = json_object_new_object();
+	json_object_object_add(rect, "x", json_object_new_int(node->x));
+	json_object_object_add(rect, "y", json_object_new_int(node->y));
+	json_object_object_add(rect, "width", json_object_new_int(node->width));
+	json_object_object_add(rect, "height", json_object_new_int(node->height));
+	return rect;
+}
+
+/**
+ * Describe the node, and its children if recursive. The output name is added
+ * for get_workspaces if not NULL.
+ */
+static json_object *describe_node(const struct bench_node *node,
+		bool recursive, const char *output) {
+	json_object *object = json_object_new_object();
+	json_object_object_add(object, "id", json_object_new_int(node->id));
+	json_object_object_add(object, "name", json_object_new_string(node->name));
+	json_object_object_add(object, "rect", describe_rect(node));
+	json_object_object_add(object, "focused",
+			json_object_new_boolean(node->focused));
+	json_object_object_add(object, "layout",
+			json_object_new_string(node->layout));
+	json_object_object_add(object, "percent", json_object_new_double(0.5));
+	json_object_object_add(object, "marks", json_object_new_array());
+	if (node->pid) {
+		json_object_object_add(object, "pid", json_object_new_int(node->pid));
+		json_object_object_add(object, "app_id",
+				json_object_new_string(node->app_id));
+		json_object_object_add(object, "shell",
+				json_object_new_string("xdg_shell"));
+	}
+	json_object *nodes = json_object_new_array();
+	for (int i = 0; recursive && i < node->nchildren; ++i) {
+		json_object_array_add(nodes,
+				describe_node(&node->children[i], true, NULL));
+	}
+	json_object_object_add(object, "nodes", nodes);
+	if (output) {
+		json_object_object_add(object, "output",
+				json_object_new_string(output));
+	}
+	json_object_object_add(object, "type", json_object_new_string(node->type));
+	return object;
+}
+
+static void write_rect(struct json_writer *writer,
+		const struct bench_node *node) {
+	json_writer_begin_object(writer);
+	json_writer_key(writer, "x");
+	json_writer_int(writer, node->x);
+	json_writer_key(writer, "y");
+	json_writer_int(writer, node->y);
+	json_writer_key(writer, "width");
+	json_writer_int(writer, node->width);
+	json_writer_key(writer, "height");
+	json_writer_int(writer, node->height);
+	json_writer_end_object(writer);
+}
+
+static void write_node(struct json_writer *writer,
+		const struct bench_node *node, bool recursive, const char *output) {
+	json_writer_begin_object(writer);
+	json_writer_key(writer, "id");
+	json_writer_int(writer, node->id);
+	json_writer_key(writer, "name");
+	json_writer_string(writer, node->name);
+	json_writer_key(writer, "rect");
+	write_rect(writer, node);
+	json_writer_key(writer, "focused");
+	json_writer_bool(writer, node->focused);
+	json_writer_key(writer, "layout");
+	json_writer_string(writer, node->layout);
+	json_writer_key(writer, "percent");
+	json_writer_double(writer, 0.5);
+	json_writer_key(writer, "marks");
+	json_writer_begin_array(writer);
+	json_writer_end_array(writer);
+	if (node->pid) {
+		json_writer_key(writer, "pid");
+		json_writer_int(writer, node->pid);
+		json_writer_key(writer, "app_id");
+		json_writer_string(writer, node->app_id);
+		json_writer_key(writer, "shell");
+		json_writer_string(writer, "xdg_shell");
+	}
+	json_writer_key(writer, "nodes");
+	json_writer_begin_array(writer);
+	for (int i = 0; recursive && i < node->nchildren; ++i) {
+		write_node(writer, &node->children[i], true, NULL);
+	}
+	json_writer_end_array(writer);
+	if (output) {
+		json_writer_key(writer, "output");
+		json_writer_string(writer, output);
+	}
+	json_writer_key(writer, "type");
+	json_writer_string(writer, node->type);
+	json_writer_end_object(writer);
+}
+
+/**
+ * A payload, which is described either as a json-c object or by writing it
+ * straight to a json_writer.
+ */
+struct payload {
+	const char *name;
+	json_object *(*describe)(const struct bench_node *root);
+	void (*write)(struct json_writer *writer, const struct bench_node *root);
+	// Number of messages the payload stands for, for event streams
+	int messages;
+};
+
+static json_object *describe_tree(const struct bench_node *root) {
+	return describe_node(root, true, NULL);
+}
+
+static void write_tree(struct json_writer *writer,
+		const struct bench_node *root) {
+	write_node(writer, root, true, NULL);
+}
+
+static json_object *describe_workspaces(const struct bench_node *root) {
+	json_object *workspaces = json_object_new_array();
+	for (int o = 0; o < root->nchildren; ++o) {
+		const struct bench_node *output = &root->children[o];
+		for (int w = 0; w < output->nchildren; ++w) {
+			json_object_array_add(workspaces, describe_node(
+						&output->children[w], false, output->name));
+		}
+	}
+	return workspaces;
+}
+
+static void write_workspaces(struct json_writer *writer,
+		const struct bench_node *root) {
+	json_writer_begin_array(writer);
+	for (int o = 0; o < root->nchildren; ++o) {
+		const struct bench_node *output = &root->children[o];
+		for (int w = 0; w < output->nchildren; ++w) {
+			write_node(writer, &output->children[w], false, output->name);
+		}
+	}
+	json_writer_end_array(writer);
+}
+
+static const struct bench_node *first_view(const struct bench_node *root) {
+	const struct bench_node *node = root;
+	while (node->nchildren) {
+		node = &node->children[0];
+	}
+	return node;
+}
+
+static json_object *describe_window_event(const struct bench_node *root) {
+	json_object *event = json_object_new_object();
+	json_object_object_add(event, "change", json_object_new_string("title"));
+	json_object_object_add(event, "container",
+			describe_node(first_view(root), false, NULL));
+	return event;
+}
+
+static void write_window_event(struct json_writer *writer,
+		const struct bench_node *root) {
+	json_writer_begin_object(writer);
+	json_writer_key(writer, "change");
+	json_writer_string(writer, "title");
+	json_writer_key(writer, "container");
+	write_node(writer, first_view(root), false, NULL);
+	json_writer_end_object(writer);
+}
+
+static const struct payload payloads[] = {
+	{ "get_tree", describe_tree, write_tree, 1 },
+	{ "get_workspaces", describe_workspaces, write_workspaces, 1 },
+	{ "window events", describe_window_event, write_window_event, 1000 },
+};
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *payload, const char *method, double elapsed,
+		int iterations, size_t bytes) {
+	printf("%-16s %-24s %10.2f us %10zu bytes\n", payload, method,
+			elapsed / iterations * 1e6, bytes);
+}
+
+static void bench_payload(const struct payload *payload,
+		const struct bench_node *root, int iterations) {
+	// Encoding with json-c, as the IPC server used to for every message
+	size_t json_len = 0;
+	double start = now();
+	for (int i = 0; i < iterations; ++i) {
+		for (int m = 0; m < payload->messages; ++m) {
+			json_object *obj = payload->describe(root);
+			json_len = strlen(json_object_to_json_string(obj));
+			json_object_put(obj);
+		}
+	}
+	report(payload->name, "json-c encode", now() - start, iterations,
+			json_len * payload->messages);
+
+	// Encoding with json_writer in both formats
+	char *encoded[2] = { NULL, NULL };
+	size_t encoded_len[2] = { 0, 0 };
+	const char *methods[2] = { "json_writer text", "json_writer msgpack" };
+	enum json_writer_format formats[2] = {
+		JSON_WRITER_TEXT, JSON_WRITER_MSGPACK
+	};
+	for (int f = 0; f < 2; ++f) {
+		struct json_writer writer;
+		json_writer_init(&writer, formats[f]);
+		start = now();
+		for (int i = 0; i < iterations; ++i) {
+			for (int m = 0; m < payload->messages; ++m) {
+				payload->write(&writer, root);
+				free(encoded[f]);
+				encoded[f] = json_writer_finish(&writer, &encoded_len[f]);
+			}
+		}
+		report(payload->name, methods[f], now() - start, iterations,
+				encoded_len[f] * payload->messages);
+	}
+	if (!encoded[0] || !encoded[1]) {
+		sway_log(SWAY_ERROR, "Unable to encode %s", payload->name);
+		exit(EXIT_FAILURE);
+	}
+
+	// Decoding, as swaybar and other clients do
+	start = now();
+	for (int i = 0; i < iterations; ++i) {
+		for (int m = 0; m < payload->messages; ++m) {
+			json_object_put(json_tokener_parse(encoded[0]));
+		}
+	}
+	report(payload->name, "json-c decode", now() - start, iterations,
+			encoded_len[0] * payload->messages);
+
+	start = now();
+	for (int i = 0; i < iterations; ++i) {
+		for (int m = 0; m < payload->messages; ++m) {
+			json_object *obj = msgpack_parse(encoded[1], encoded_len[1]);
+			if (!obj) {
+				sway_log(SWAY_ERROR, "Unable to decode %s", payload->name);
+				exit(EXIT_FAILURE);
+			}
+			json_object_put(obj);
+		}
+	}
+	report(payload->name, "msgpack_parse decode", now() - start, iterations,
+			encoded_len[1] * payload->messages);
+
+	free(encoded[0]);
+	free(encoded[1]);
+}
+
+int main(int argc, char **argv) {
+	sway_log_init(SWAY_ERROR, NULL);
+
+	int outputs = argc > 1 ? atoi(argv[1]) : 2;
+	int workspaces = argc > 2 ? atoi(argv[2]) : 10;
+	int views = argc > 3 ? atoi(argv[3]) : 10;
+	if (outputs <= 0 || workspaces <= 0 || views <= 0) {
+		fprintf(stderr, "Usage: %s [outputs] [workspaces per output] "
+				"[views per workspace]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	struct bench_node root;
+	create_tree(&root, outputs, workspaces, views);
+	printf("%d outputs, %d workspaces per output, %d views per workspace\n",
+			outputs, workspaces, views);
+	printf("%-16s %-24s %13s %16s\n", "payload", "method", "per iteration",
+			"size");
+	for (size_t i = 0; i < sizeof(payloads) / sizeof(payloads[0]); ++i) {
+		bench_payload(&payloads[i], &root, 100);
+	}
+	destroy_tree(&root);
+	return EXIT_SUCCESS;
+}
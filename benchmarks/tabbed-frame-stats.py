@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+
+# Measures how a workspace with many tabs renders. It opens the given number of
+# clients in a tabbed workspace of the running sway, then cycles the focus
+# through the tabs so that the tab bar is redrawn on every frame, and prints
+# the frame stats of the output covering the last frames.
+#
+# Only swaymsg and a client which opens a window are needed. To measure without
+# a session, run it in a headless sway:
+#
+#     WLR_BACKENDS=headless WLR_LIBINPUT_NO_DEVICES=1 sway -c /dev/null &
+#     SWAYSOCK=... ./tabbed-frame-stats.py --client foot
+
+import argparse
+import json
+import subprocess
+import sys
+import time
+
+WORKSPACE = "frame-stats-tabs"
+
+
+def swaymsg(*args):
+    result = subprocess.run(["swaymsg", "-r", *args],
+                            capture_output=True, text=True)
+    return json.loads(result.stdout) if result.stdout else None
+
+
+def command(cmd):
+    for reply in swaymsg(cmd):
+        if not reply["success"]:
+            sys.exit("Command '%s' failed: %s" % (cmd, reply.get("error")))
+
+
+def find_workspace(node):
+    if node["type"] == "workspace" and node["name"] == WORKSPACE:
+        return node
+    for child in node["nodes"]:
+        found = find_workspace(child)
+        if found:
+            return found
+    return None
+
+
+def count_views(node):
+    if "pid" in node:
+        return 1
+    return sum(count_views(child) for child in node["nodes"])
+
+
+def wait_for_views(count, timeout):
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        workspace = find_workspace(swaymsg("-t", "get_tree"))
+        if workspace and count_views(workspace) >= count:
+            return
+        time.sleep(0.1)
+    sys.exit("Timed out waiting for %d windows" % count)
+
+
+def describe(samples):
+    return "p50 %6d  p90 %6d  p99 %6d  max %6d" % (
+        samples["p50"], samples["p90"], samples["p99"], samples["max"])
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Measure the rendering of a tabbed workspace")
+    parser.add_argument("--tabs", type=int, default=50)
+    parser.add_argument("--switches", type=int, default=256,
+                        help="focus changes, more than the 128 frame samples")
+    parser.add_argument("--interval", type=float, default=0.05,
+                        help="seconds between focus changes")
+    parser.add_argument("--client", default="foot",
+                        help="command opening one window")
+    parser.add_argument("--keep", action="store_true",
+                        help="don't close the windows afterwards")
+    args = parser.parse_args()
+
+    command("workspace %s; layout tabbed" % WORKSPACE)
+    for _ in range(args.tabs):
+        command("exec %s" % args.client)
+    wait_for_views(args.tabs, 30)
+
+    for _ in range(args.switches):
+        command("focus right")
+        time.sleep(args.interval)
+
+    output = next(ws["output"] for ws in swaymsg("-t", "get_workspaces")
+                  if ws["name"] == WORKSPACE)
+    stats = next(o for o in swaymsg("-t", "get_frame_stats")
+                 if o["name"] == output)
+
+    print("%d tabs on %s, %d frames sampled" % (
+        args.tabs, output, stats["render_time"]["samples"]))
+    print("render time (us)  %s" % describe(stats["render_time"]))
+    print("draw calls        %s" % describe(stats["draw_calls"]))
+    print("scissor changes   %s" % describe(stats["scissor_changes"]))
+
+    if not args.keep:
+        command('[workspace="^%s$"] kill' % WORKSPACE)
+
+
+if __name__ == "__main__":
+    main()
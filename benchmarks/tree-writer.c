@@ -0,0 +1,263 @@
+#define _POSIX_C_SOURCE 200809L
+#include <json.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wayland-server-core.h>
+#include <wlr/types/wlr_seat.h>
+#include "sway/desktop/idle_inhibit_v1.h"
+#include "sway/input/input-manager.h"
+#include "sway/input/seat.h"
+#include "sway/ipc-json.h"
+#include "sway/json-writer.h"
+#include "sway/server.h"
+#include "sway/tree/container.h"
+#include "sway/tree/node.h"
+#include "sway/tree/root.h"
+#include "sway/tree/view.h"
+#include "sway/tree/workspace.h"
+#include "list.h"
+#include "log.h"
+
+/**
+ * Compares describing the real tree of workspaces, containers and views as
+ * GET_TREE does: streamed by the tree writer as text and as MessagePack, and
+ * built as a json-c object graph and serialized, as every reply used to be.
+ * Reports the time, number of allocations and size of each description.
+ *
+ * Each workspace holds half of its views side by side and the other half in a
+ * tabbed container, and every node is on the focus stack of the seat. The
+ * containers aren't attached to their workspaces, so that no outputs are
+ * needed, which only leaves out their deco_rect and visibility. Usage:
+ *
+ *     bench-tree-writer [iterations] [workspaces] [views per workspace]
+ */
+
+struct sway_server server = {0};
+struct sway_debug debug = {0};
+
+void sway_terminate(int exit_code) {
+	exit(exit_code);
+}
+
+static size_t allocations = 0;
+
+#ifdef __GLIBC__
+// Count the allocations of sway and json-c, including those made by libc
+// itself, such as in strdup
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t nmemb, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+
+void *malloc(size_t size) {
+	++allocations;
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+	++allocations;
+	return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+	++allocations;
+	return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+	__libc_free(ptr);
+}
+#endif
+
+static const char *app_ids[] = {
+	"foot",
+	"firefox",
+	"org.gnome.Nautilus",
+	"code-oss",
+};
+
+static const char *bench_get_string_prop(struct sway_view *view,
+		enum sway_view_prop prop) {
+	if (prop != VIEW_PROP_APP_ID) {
+		return NULL;
+	}
+	return app_ids[view->pid % (sizeof(app_ids) / sizeof(app_ids[0]))];
+}
+
+static const struct sway_view_impl bench_view_impl = {
+	.get_string_prop = bench_get_string_prop,
+};
+
+static struct sway_seat seat = {0};
+
+static void focus_node(struct sway_node *node) {
+	struct sway_seat_node *seat_node = calloc(1, sizeof(*seat_node));
+	seat_node->seat = &seat;
+	seat_node->node = node;
+	wl_list_insert(&seat.focus_stack, &seat_node->link);
+}
+
+static struct sway_container *create_view(int id, int x, int width) {
+	struct sway_view *view = calloc(1, sizeof(struct sway_view));
+	view->type = SWAY_VIEW_XDG_SHELL;
+	view->impl = &bench_view_impl;
+	view->pid = 1000 + id;
+	view->natural_width = width;
+	view->natural_height = 1080;
+
+	struct sway_container *con = container_create(view);
+	view->container = con;
+	char title[128];
+	snprintf(title, sizeof(title),
+			"user@host: ~/src/project-%d - vim file%d.c", id, id);
+	con->title = strdup(title);
+	if (id % 3 == 0) {
+		snprintf(title, sizeof(title), "mark-%d", id);
+		list_add(con->marks, strdup(title));
+	}
+	con->x = con->content_x = x;
+	con->width = con->content_width = width;
+	con->height = con->content_height = 1080;
+	con->current.border = B_PIXEL;
+	con->current.border_thickness = 2;
+	focus_node(&con->node);
+	return con;
+}
+
+static struct sway_workspace *create_workspace(int num, int views) {
+	struct sway_workspace *ws = calloc(1, sizeof(struct sway_workspace));
+	node_init(&ws->node, N_WORKSPACE, ws);
+	char name[16];
+	snprintf(name, sizeof(name), "%d", num);
+	ws->name = strdup(name);
+	ws->layout = L_HORIZ;
+	ws->tiling = create_list();
+	ws->floating = create_list();
+	ws->width = 1920;
+	ws->height = 1080;
+
+	int tiled = views / 2;
+	int width = ws->width / (tiled + 1);
+	for (int v = 0; v < tiled; ++v) {
+		struct sway_container *con =
+			create_view(num * views + v, v * width, width);
+		list_add(ws->tiling, con);
+	}
+
+	struct sway_container *tabs = container_create(NULL);
+	tabs->layout = L_TABBED;
+	tabs->x = tiled * width;
+	tabs->width = width;
+	tabs->height = 1080;
+	for (int v = tiled; v < views; ++v) {
+		struct sway_container *con =
+			create_view(num * views + v, tabs->x, width);
+		con->parent = tabs;
+		list_add(tabs->children, con);
+	}
+	list_add(ws->tiling, tabs);
+	focus_node(&tabs->node);
+	focus_node(&ws->node);
+	return ws;
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *method, double elapsed, size_t allocs,
+		size_t bytes, int iterations) {
+	printf("%-20s %10.2f us %10.1f allocations %10zu bytes\n", method,
+			elapsed / iterations * 1e6, (double)allocs / iterations, bytes);
+}
+
+static void bench_writer(list_t *workspaces, enum json_writer_format format,
+		const char *method, int iterations) {
+	struct json_writer writer;
+	json_writer_init(&writer, format);
+	size_t bytes = 0;
+	size_t start_allocs = allocations;
+	double start = now();
+	for (int i = 0; i < iterations; ++i) {
+		bytes = 0;
+		for (int w = 0; w < workspaces->length; ++w) {
+			struct sway_workspace *ws = workspaces->items[w];
+			ipc_json_write_node_recursive(&writer, &ws->node, NULL, 1);
+			size_t len = 0;
+			free(json_writer_finish(&writer, &len));
+			bytes += len;
+		}
+	}
+	report(method, now() - start, allocations - start_allocs, bytes,
+			iterations);
+}
+
+static void bench_json_c(list_t *workspaces, int iterations) {
+	size_t bytes = 0;
+	size_t start_allocs = allocations;
+	double start = now();
+	for (int i = 0; i < iterations; ++i) {
+		bytes = 0;
+		for (int w = 0; w < workspaces->length; ++w) {
+			struct sway_workspace *ws = workspaces->items[w];
+			json_object *obj = ipc_json_describe_node_recursive(&ws->node);
+			bytes += strlen(json_object_to_json_string(obj));
+			json_object_put(obj);
+		}
+	}
+	report("json-c", now() - start, allocations - start_allocs, bytes,
+			iterations);
+}
+
+int main(int argc, char **argv) {
+	sway_log_init(SWAY_ERROR, NULL);
+
+	int iterations = argc > 1 ? atoi(argv[1]) : 1000;
+	int nworkspaces = argc > 2 ? atoi(argv[2]) : 10;
+	int views = argc > 3 ? atoi(argv[3]) : 8;
+	if (iterations <= 0 || nworkspaces <= 0 || views <= 0) {
+		fprintf(stderr, "Usage: %s [iterations] [workspaces] "
+				"[views per workspace]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	server.wl_display = wl_display_create();
+	server.wl_event_loop = wl_display_get_event_loop(server.wl_display);
+	root = root_create();
+
+	// The writer looks up the focus of the default seat and the idle
+	// inhibitors of views, which are all that's needed of the compositor
+	struct sway_input_manager input = {0};
+	wl_list_init(&input.devices);
+	wl_list_init(&input.seats);
+	server.input = &input;
+	char seat_name[] = "seat0";
+	struct wlr_seat wlr_seat = { .name = seat_name };
+	seat.wlr_seat = &wlr_seat;
+	wl_list_init(&seat.focus_stack);
+	wl_list_insert(&input.seats, &seat.link);
+	struct sway_idle_inhibit_manager_v1 idle_inhibit = {0};
+	wl_list_init(&idle_inhibit.inhibitors);
+	server.idle_inhibit_manager_v1 = &idle_inhibit;
+
+	list_t *workspaces = create_list();
+	for (int w = 0; w < nworkspaces; ++w) {
+		list_add(workspaces, create_workspace(w + 1, views));
+	}
+
+	printf("%d workspaces with %d views each, per GET_TREE\n",
+			nworkspaces, views);
+	bench_json_c(workspaces, iterations);
+	bench_writer(workspaces, JSON_WRITER_TEXT, "tree writer text",
+			iterations);
+	bench_writer(workspaces, JSON_WRITER_MSGPACK, "tree writer msgpack",
+			iterations);
+
+	wl_display_destroy(server.wl_display);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,224 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <json.h>
+#include "ipc-client.h"
+#include "ipc-encoding.h"
+#include "log.h"
+
+// Deeper nesting than sway ever produces is treated as malformed
+#define MSGPACK_MAX_DEPTH 1024
+
+struct msgpack_reader {
+	const unsigned char *data;
+	size_t len, pos;
+};
+
+static bool read_be(struct msgpack_reader *reader, int bytes,
+		uint64_t *value) {
+	if (reader->len - reader->pos < (size_t)bytes) {
+		return false;
+	}
+	*value = 0;
+	for (int i = 0; i < bytes; ++i) {
+		*value = *value << 8 | reader->data[reader->pos++];
+	}
+	return true;
+}
+
+static bool read_string(struct msgpack_reader *reader, size_t len,
+		const char **str) {
+	if (reader->len - reader->pos < len) {
+		return false;
+	}
+	*str = (const char *)reader->data + reader->pos;
+	reader->pos += len;
+	return true;
+}
+
+static json_object *read_value(struct msgpack_reader *reader, int depth);
+
+static json_object *read_array(struct msgpack_reader *reader, uint64_t count,
+		int depth) {
+	json_object *array = json_object_new_array();
+	for (uint64_t i = 0; i < count; ++i) {
+		json_object *value = read_value(reader, depth + 1);
+		if (!value && reader->pos == SIZE_MAX) {
+			json_object_put(array);
+			return NULL;
+		}
+		json_object_array_add(array, value);
+	}
+	return array;
+}
+
+static json_object *read_map(struct msgpack_reader *reader, uint64_t count,
+		int depth) {
+	json_object *object = json_object_new_object();
+	for (uint64_t i = 0; i < count; ++i) {
+		if (reader->pos >= reader->len) {
+			goto error;
+		}
+		// Keys are always strings, as in JSON
+		uint8_t type = reader->data[reader->pos++];
+		uint64_t len;
+		if ((type & 0xe0) == 0xa0) {
+			len = type & 0x1f;
+		} else if (type < 0xd9 || type > 0xdb
+				|| !read_be(reader, 1 << (type - 0xd9), &len)) {
+			goto error;
+		}
+		const char *str;
+		if (!read_string(reader, len, &str)) {
+			goto error;
+		}
+		char *key = strndup(str, len);
+		json_object *value = read_value(reader, depth + 1);
+		if (!key || (!value && reader->pos == SIZE_MAX)) {
+			free(key);
+			goto error;
+		}
+		json_object_object_add(object, key, value);
+		free(key);
+	}
+	return object;
+error:
+	reader->pos = SIZE_MAX;
+	json_object_put(object);
+	return NULL;
+}
+
+// Returns NULL both for nil and on errors, which set pos to SIZE_MAX
+static json_object *read_value(struct msgpack_reader *reader, int depth) {
+	if (depth > MSGPACK_MAX_DEPTH || reader->pos >= reader->len) {
+		goto error;
+	}
+	uint8_t type = reader->data[reader->pos++];
+	uint64_t value;
+	const char *str;
+	json_object *result;
+
+	if (type <= 0x7f) {
+		return json_object_new_int64(type);
+	} else if (type >= 0xe0) {
+		return json_object_new_int64((int8_t)type);
+	} else if (type <= 0x8f) {
+		result = read_map(reader, type & 0x0f, depth);
+		goto container;
+	} else if (type <= 0x9f) {
+		result = read_array(reader, type & 0x0f, depth);
+		goto container;
+	} else if (type <= 0xbf) {
+		if (!read_string(reader, type & 0x1f, &str)) {
+			goto error;
+		}
+		return json_object_new_string_len(str, type & 0x1f);
+	}
+
+	switch (type) {
+	case 0xc0:
+		return NULL;
+	case 0xc2:
+		return json_object_new_boolean(false);
+	case 0xc3:
+		return json_object_new_boolean(true);
+	case 0xca:; // float 32
+		if (!read_be(reader, 4, &value)) {
+			goto error;
+		}
+		uint32_t bits32 = value;
+		float f;
+		memcpy(&f, &bits32, sizeof(f));
+		return json_object_new_double(f);
+	case 0xcb:; // float 64
+		if (!read_be(reader, 8, &value)) {
+			goto error;
+		}
+		double d;
+		memcpy(&d, &value, sizeof(d));
+		return json_object_new_double(d);
+	case 0xcc: case 0xcd: case 0xce: case 0xcf: // uint 8 to 64
+		if (!read_be(reader, 1 << (type - 0xcc), &value)) {
+			goto error;
+		}
+		return json_object_new_int64(
+				value > INT64_MAX ? INT64_MAX : (int64_t)value);
+	case 0xd0: case 0xd1: case 0xd2: case 0xd3:; // int 8 to 64
+		int bytes = 1 << (type - 0xd0);
+		if (!read_be(reader, bytes, &value)) {
+			goto error;
+		}
+		// Sign-extend
+		int shift = 64 - bytes * 8;
+		return json_object_new_int64(
+				(int64_t)(value << shift) >> shift);
+	case 0xd9: case 0xda: case 0xdb: // str 8 to 32
+		if (!read_be(reader, 1 << (type - 0xd9), &value)
+				|| !read_string(reader, value, &str)) {
+			goto error;
+		}
+		return json_object_new_string_len(str, (int)value);
+	case 0xdc: case 0xdd: // array 16 and 32
+		if (!read_be(reader, type == 0xdc ? 2 : 4, &value)) {
+			goto error;
+		}
+		result = read_array(reader, value, depth);
+		goto container;
+	case 0xde: case 0xdf: // map 16 and 32
+		if (!read_be(reader, type == 0xde ? 2 : 4, &value)) {
+			goto error;
+		}
+		result = read_map(reader, value, depth);
+		goto container;
+	}
+	// bin, ext and the never used 0xc1 have no JSON equivalent
+	goto error;
+
+container:
+	if (!result) {
+		goto error;
+	}
+	return result;
+error:
+	reader->pos = SIZE_MAX;
+	return NULL;
+}
+
+json_object *msgpack_parse(const char *data, size_t len) {
+	struct msgpack_reader reader = {
+		.data = (const unsigned char *)data,
+		.len = len,
+	};
+	json_object *result = read_value(&reader, 0);
+	if (reader.pos != len) {
+		// Malformed, or trailing data
+		json_object_put(result);
+		return NULL;
+	}
+	return result;
+}
+
+json_object *ipc_parse_payload(const char *payload, uint32_t len,
+		bool msgpack) {
+	if (msgpack) {
+		return msgpack_parse(payload, len);
+	}
+	return json_tokener_parse(payload);
+}
+
+bool ipc_set_encoding(int socketfd, const char *encoding) {
+	uint32_t len = strlen(encoding);
+	char *res = ipc_single_command(socketfd, IPC_SET_ENCODING, encoding, &len);
+	// The reply is always JSON text, the encoding changes after it
+	json_object *reply = json_tokener_parse(res);
+	json_object *success;
+	bool ret = json_object_object_get_ex(reply, "success", &success)
+		&& json_object_get_boolean(success);
+	if (!ret) {
+		sway_log(SWAY_DEBUG, "sway refused the %s IPC encoding", encoding);
+	}
+	json_object_put(reply);
+	free(res);
+	return ret;
+}
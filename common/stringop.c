@@ -1,6 +1,7 @@
 #define _POSIX_C_SOURCE 200809L
 #include <ctype.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -328,3 +329,61 @@ bool expand_path(char **path) {
 	wordfree(&p);
 	return true;
 }
+
+static struct {
+	char **slots;
+	size_t len, cap; // cap is a power of two
+} interned;
+
+static uint32_t hash_string(const char *str) {
+	uint32_t hash = 2166136261u; // FNV-1a
+	for (; *str; ++str) {
+		hash = (hash ^ (unsigned char)*str) * 16777619u;
+	}
+	return hash;
+}
+
+static char **intern_slot(char **slots, size_t cap, const char *str) {
+	size_t i = hash_string(str) & (cap - 1);
+	while (slots[i] && strcmp(slots[i], str) != 0) {
+		i = (i + 1) & (cap - 1);
+	}
+	return &slots[i];
+}
+
+const char *intern_string(const char *str) {
+	if (interned.cap) {
+		char **slot = intern_slot(interned.slots, interned.cap, str);
+		if (*slot) {
+			return *slot;
+		}
+	}
+
+	// Keep the table at most half full
+	if ((interned.len + 1) * 2 > interned.cap) {
+		size_t cap = interned.cap ? interned.cap * 2 : 64;
+		char **slots = calloc(cap, sizeof(char *));
+		if (!slots) {
+			sway_log(SWAY_ERROR, "Unable to allocate interned strings");
+			return NULL;
+		}
+		for (size_t i = 0; i < interned.cap; ++i) {
+			if (interned.slots[i]) {
+				*intern_slot(slots, cap, interned.slots[i]) =
+					interned.slots[i];
+			}
+		}
+		free(interned.slots);
+		interned.slots = slots;
+		interned.cap = cap;
+	}
+
+	char *copy = strdup(str);
+	if (!copy) {
+		sway_log(SWAY_ERROR, "Unable to allocate interned string");
+		return NULL;
+	}
+	*intern_slot(interned.slots, interned.cap, str) = copy;
+	++interned.len;
+	return copy;
+}
@@ -16,6 +16,11 @@ uint32_t get_current_time_msec(void) {
 	return now.tv_sec * 1000 + now.tv_nsec / 1000000;
 }
 
+int64_t timespec_sub_nsec(const struct timespec *a, const struct timespec *b) {
+	return (int64_t)(a->tv_sec - b->tv_sec) * 1000000000
+		+ (a->tv_nsec - b->tv_nsec);
+}
+
 int wrap(int i, int max) {
 	return ((i % max) + max) % max;
 }
@@ -21,5 +21,8 @@ complete -c swaymsg -s t -l type -fra 'get_binding_modes' --description "Gets a
 complete -c swaymsg -s t -l type -fra 'get_binding_state' --description "Get JSON-encoded info about the current binding state."
 complete -c swaymsg -s t -l type -fra 'get_config' --description "Gets a JSON-encoded copy of the current configuration."
 complete -c swaymsg -s t -l type -fra 'get_seats' --description "Gets a JSON-encoded list of all seats, its properties and all assigned devices."
+complete -c swaymsg -s t -l type -fra 'get_frame_stats' --description "Gets JSON-encoded frame timing statistics for each output."
+complete -c swaymsg -s t -l type -fra 'get_damage_stats' --description "Gets JSON-encoded damage statistics for each output."
+complete -c swaymsg -s t -l type -fra 'get_titlebar_cache' --description "Gets JSON-encoded statistics of the titlebar texture cache."
 complete -c swaymsg -s t -l type -fra 'send_tick' --description "Sends a tick event to all subscribed clients."
 complete -c swaymsg -s t -l type -fra 'subscribe' --description "Subscribe to a list of event types."
@@ -0,0 +1,26 @@
+#ifndef _SWAY_IPC_ENCODING_H
+#define _SWAY_IPC_ENCODING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <json.h>
+
+/**
+ * Asks sway to encode every following reply and event on the socket with the
+ * given encoding, "json" or "msgpack". Returns false if sway refused.
+ */
+bool ipc_set_encoding(int socketfd, const char *encoding);
+/**
+ * Decodes a MessagePack payload into the json-c objects the JSON encoding of
+ * the same message would give. Returns NULL if the payload is malformed or
+ * uses types outside of the JSON data model.
+ */
+json_object *msgpack_parse(const char *data, size_t len);
+/**
+ * Decodes a reply or event payload, which is MessagePack if msgpack is set and
+ * JSON text otherwise.
+ */
+json_object *ipc_parse_payload(const char *payload, uint32_t len, bool msgpack);
+
+#endif
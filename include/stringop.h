@@ -30,4 +30,8 @@ char *argsep(char **stringp, const char *delim, char *matched_delim);
 // Expand a path using shell replacements such as $HOME and ~
 bool expand_path(char **path);
 
+// Returns the canonical copy of str, so that interned strings can be compared
+// by pointer. Interned strings live until exit and must not be freed.
+const char *intern_string(const char *str);
+
 #endif
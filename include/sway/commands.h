@@ -5,6 +5,7 @@
 #include "config.h"
 
 struct sway_container;
+struct cmd_program;
 
 typedef struct cmd_results *sway_cmd(int argc, char **argv);
 
@@ -58,6 +59,15 @@ struct cmd_handler *find_handler(char *line, struct cmd_handler *cmd_handlers,
  */
 list_t *execute_command(char *command,  struct sway_seat *seat,
 		struct sway_container *con);
+/**
+ * Like execute_command, but parses the command only once. The compiled form
+ * is stored in *program on first use and has to be released with
+ * cmd_program_unref.
+ */
+list_t *execute_compiled_command(struct cmd_program **program, char *command,
+		struct sway_seat *seat, struct sway_container *con);
+
+void cmd_program_unref(struct cmd_program *program);
 /**
  * Parse and handles a command during config file loading.
  *
@@ -188,6 +198,7 @@ sway_cmd cmd_title_align;
 sway_cmd cmd_title_format;
 sway_cmd cmd_titlebar_border_thickness;
 sway_cmd cmd_titlebar_padding;
+sway_cmd cmd_trace;
 sway_cmd cmd_unbindcode;
 sway_cmd cmd_unbindswitch;
 sway_cmd cmd_unbindsym;
@@ -288,6 +299,7 @@ sway_cmd output_cmd_toggle;
 sway_cmd output_cmd_transform;
 
 sway_cmd seat_cmd_attach;
+sway_cmd seat_cmd_coalesce_motion;
 sway_cmd seat_cmd_cursor;
 sway_cmd seat_cmd_fallback;
 sway_cmd seat_cmd_hide_cursor;
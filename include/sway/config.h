@@ -24,6 +24,16 @@ struct sway_variable {
 	char *value;
 };
 
+/**
+ * A node of the trie over variable names. Children are kept in a sibling list
+ * sorted by character.
+ */
+struct sway_variable_trie {
+	char c;
+	struct sway_variable *var; // the variable whose name ends here, if any
+	struct sway_variable_trie *child, *next;
+};
+
 enum binding_input_type {
 	BINDING_KEYCODE,
 	BINDING_KEYSYM,
@@ -50,13 +60,14 @@ enum binding_flags {
 struct sway_binding {
 	enum binding_input_type type;
 	int order;
-	char *input;
+	const char *input; // interned
 	uint32_t flags;
 	list_t *keys; // sorted in ascending order
 	list_t *syms; // sorted in ascending order; NULL if BINDING_CODE is not set
 	uint32_t modifiers;
 	xkb_layout_index_t group;
 	char *command;
+	struct cmd_program *program; // command compiled on first use
 };
 
 /**
@@ -87,6 +98,36 @@ enum sway_fowa {
 	FOWA_NONE,
 };
 
+struct binding_index_match {
+	struct sway_binding *binding;
+	int position; // in the indexed binding list
+};
+
+/**
+ * The bindings of an index which share the same modifiers, release flag and
+ * keys, in binding list order.
+ */
+struct binding_index_slot {
+	uint32_t hash;
+	uint32_t modifiers;
+	bool release;
+	list_t *keys;
+	struct binding_index_match *matches;
+	int len, cap;
+	struct binding_index_slot *next;
+};
+
+/**
+ * A hash index over a list of key bindings, keyed by modifiers, release flag
+ * and key set. It is built lazily on the first lookup and has to be
+ * invalidated whenever the list changes.
+ */
+struct sway_binding_index {
+	list_t *bindings; // the indexed list, NULL if the index is invalid
+	struct binding_index_slot **buckets;
+	size_t nbuckets;
+};
+
 /**
  * A "mode" of keybindings created via the `mode` command.
  */
@@ -96,6 +137,8 @@ struct sway_mode {
 	list_t *keycode_bindings;
 	list_t *mouse_bindings;
 	list_t *switch_bindings;
+	struct sway_binding_index keysym_index;
+	struct sway_binding_index keycode_index;
 	bool pango;
 };
 
@@ -184,6 +227,12 @@ enum seat_config_shortcuts_inhibit {
 	SHORTCUTS_INHIBIT_DISABLE,
 };
 
+enum seat_config_coalesce_motion {
+	COALESCE_MOTION_DEFAULT, // the default is currently disabled
+	COALESCE_MOTION_ENABLE,
+	COALESCE_MOTION_DISABLE,
+};
+
 enum seat_keyboard_grouping {
 	KEYBOARD_GROUP_DEFAULT, // the default is currently smart
 	KEYBOARD_GROUP_NONE,
@@ -209,6 +258,7 @@ struct seat_config {
 	int hide_cursor_timeout;
 	enum seat_config_allow_constrain allow_constrain;
 	enum seat_config_shortcuts_inhibit shortcuts_inhibit;
+	enum seat_config_coalesce_motion coalesce_motion;
 	enum seat_keyboard_grouping keyboard_grouping;
 	uint32_t idle_inhibit_sources, idle_wake_sources;
 	struct {
@@ -230,6 +280,9 @@ enum scale_filter_mode {
 	SCALE_FILTER_SMART,
 };
 
+// Derive the output max render time from measured render durations
+#define MAX_RENDER_TIME_AUTO -2
+
 /**
  * Size and position configuration for a particular output.
  *
@@ -246,7 +299,7 @@ struct output_config {
 	enum scale_filter_mode scale_filter;
 	int32_t transform;
 	enum wl_output_subpixel subpixel;
-	int max_render_time; // In milliseconds
+	int max_render_time; // In milliseconds, or MAX_RENDER_TIME_AUTO
 	int adaptive_sync;
 
 	char *background;
@@ -432,6 +485,19 @@ enum xwayland_mode {
 	XWAYLAND_MODE_IMMEDIATE,
 };
 
+/**
+ * The parts of the config which differ from the previous one after a reload.
+ */
+enum config_change {
+	CONFIG_CHANGE_FONT = 1 << 0,
+	CONFIG_CHANGE_COLORS = 1 << 1,
+	CONFIG_CHANGE_GAPS = 1 << 2,
+	CONFIG_CHANGE_BINDINGS = 1 << 3,
+	CONFIG_CHANGE_INPUTS = 1 << 4,
+	CONFIG_CHANGE_OUTPUTS = 1 << 5,
+	CONFIG_CHANGE_BARS = 1 << 6,
+};
+
 /**
  * The configuration struct. The result of loading a config file.
  */
@@ -439,6 +505,7 @@ struct sway_config {
 	char *swaynag_command;
 	struct swaynag_instance swaynag_config_errors;
 	list_t *symbols;
+	struct sway_variable_trie *symbol_trie; // indexes symbols by name
 	list_t *modes;
 	list_t *bars;
 	list_t *cmd_queue;
@@ -486,6 +553,7 @@ struct sway_config {
 	bool active;
 	bool failed;
 	bool reloading;
+	uint32_t reload_changes; // enum config_change, set by the last reload
 	bool reading;
 	bool validating;
 	bool auto_back_and_forth;
@@ -583,6 +651,15 @@ void run_deferred_bindings(void);
  */
 void config_add_swaynag_warning(char *fmt, ...);
 
+/**
+ * Compare a freshly loaded config against the one it replaces and return the
+ * changed parts as a mask of enum config_change.
+ *
+ * Bars which did not change take over the swaybar client of their old config,
+ * so they keep running.
+ */
+uint32_t config_diff(struct sway_config *old, struct sway_config *new);
+
 /**
  * Free config struct
  */
@@ -590,6 +667,26 @@ void free_config(struct sway_config *config);
 
 void free_sway_variable(struct sway_variable *var);
 
+/**
+ * Add the variable to the trie. The trie does not own the variable.
+ */
+bool variable_trie_insert(struct sway_variable_trie **trie,
+		struct sway_variable *var);
+
+/**
+ * Find the variable with exactly the given name.
+ */
+struct sway_variable *variable_trie_find(struct sway_variable_trie *trie,
+		const char *name);
+
+/**
+ * Find the variable with the longest name which is a prefix of str.
+ */
+struct sway_variable *variable_trie_match(struct sway_variable_trie *trie,
+		const char *str);
+
+void variable_trie_destroy(struct sway_variable_trie *trie);
+
 /**
  * Does variable replacement for a string based on the config's currently loaded variables.
  */
@@ -652,6 +749,11 @@ void free_output_config(struct output_config *oc);
 
 bool spawn_swaybg(void);
 
+/**
+ * Move the running swaybg client from the old config to the new one.
+ */
+void swaybg_reuse_client(struct sway_config *new, struct sway_config *old);
+
 int workspace_output_cmp_workspace(const void *a, const void *b);
 
 void free_sway_binding(struct sway_binding *sb);
@@ -664,6 +766,11 @@ void load_swaybar(struct bar_config *bar);
 
 void load_swaybars(void);
 
+/**
+ * Move the running swaybar client from the old bar config to the new one.
+ */
+void bar_config_reuse_client(struct bar_config *bar, struct bar_config *old);
+
 struct bar_config *default_bar_config(void);
 
 void free_bar_config(struct bar_config *bar);
@@ -692,6 +799,20 @@ void translate_keysyms(struct input_config *input_config);
 
 void binding_add_translated(struct sway_binding *binding, list_t *bindings);
 
+/**
+ * Drop the index, which will be rebuilt on the next lookup.
+ */
+void binding_index_invalidate(struct sway_binding_index *index);
+
+/**
+ * Find the bindings in the list which have exactly the given modifiers,
+ * release flag and keys. The keys must be sorted in ascending order. Returns
+ * NULL if there are none.
+ */
+const struct binding_index_slot *binding_index_find(
+		struct sway_binding_index *index, list_t *bindings,
+		uint32_t modifiers, bool release, const uint32_t *keys, size_t nkeys);
+
 /* Global config singleton. */
 extern struct sway_config *config;
 
@@ -21,13 +21,17 @@ enum pattern_type {
 
 struct pattern {
 	enum pattern_type match_type;
-	pcre *regex;
+	pcre *regex; // NULL for literals
+	pcre_extra *regex_extra; // study data, JIT compiled if supported
+	char *literal; // set if the regex has no special characters
+	bool anchored; // whether the literal has to match the whole value
 };
 
 struct criteria {
 	enum criteria_type type;
 	char *raw; // entire criteria string (for logging)
 	char *cmdlist;
+	struct cmd_program *program; // cmdlist compiled on first use
 	char *target; // workspace or output name for `assign` criteria
 
 	struct pattern *title;
@@ -70,9 +74,24 @@ struct criteria *criteria_parse(char *raw, char **error);
  * Compile a list of criterias matching the given view.
  *
  * Criteria types can be bitwise ORed.
+ *
+ * Which criteria match the view's title, app_id, class, instance, window_role,
+ * shell and window_type is cached per view, see criteria_invalidate_view.
  */
 list_t *criteria_for_view(struct sway_view *view, enum criteria_type types);
 
+/**
+ * Drop the view's cached criteria matches. Has to be called when any of the
+ * attributes listed for criteria_for_view change.
+ */
+void criteria_invalidate_view(struct sway_view *view);
+
+/**
+ * Drop the criteria index if it was built from the given list, which is about
+ * to be freed.
+ */
+void criteria_list_destroyed(list_t *criteria);
+
 /**
  * Compile a list of containers matching the given criteria.
  */
@@ -0,0 +1,60 @@
+#ifndef _SWAY_TITLEBAR_CACHE_H
+#define _SWAY_TITLEBAR_CACHE_H
+#include <stddef.h>
+#include <stdint.h>
+#include <wlr/render/wlr_texture.h>
+
+/**
+ * The titlebar cache shares rendered titlebar text between containers.
+ * Containers showing the same text with the same font, colors and scale use
+ * the same texture.
+ *
+ * Textures are reference counted. Once nobody references a texture any more,
+ * it is kept in a small LRU list so that a title flipping back and forth, or a
+ * window being mapped again, doesn't have to be rasterized again.
+ */
+
+struct border_colors;
+struct sway_output;
+
+enum titlebar_text_type {
+	TITLEBAR_TEXT_TITLE,
+	TITLEBAR_TEXT_MARKS,
+};
+
+struct titlebar_cache_stats {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t bytes_saved; // pixel data not rendered and uploaded thanks to hits
+	size_t entries;
+	size_t unused_entries;
+	size_t bytes; // pixel data of all cached textures
+};
+
+/**
+ * Get a texture of the text rendered for the output in the colors of the given
+ * class, or NULL if there is nothing to render. The height is in layout
+ * coordinates.
+ *
+ * The caller owns a reference to the texture and must drop it with
+ * titlebar_cache_release instead of destroying it.
+ */
+struct wlr_texture *titlebar_cache_get(struct sway_output *output,
+		enum titlebar_text_type type, const char *text, int height,
+		struct border_colors *class);
+
+/**
+ * Drop a reference obtained from titlebar_cache_get. Accepts NULL.
+ */
+void titlebar_cache_release(struct wlr_texture *texture);
+
+void titlebar_cache_get_stats(struct titlebar_cache_stats *stats);
+
+/**
+ * Destroy all cached textures, including unused ones and those still
+ * referenced, and free the cache. Called on shutdown, before the renderers
+ * are destroyed.
+ */
+void titlebar_cache_finish(void);
+
+#endif
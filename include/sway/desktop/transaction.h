@@ -1,5 +1,6 @@
 #ifndef _SWAY_TRANSACTION_H
 #define _SWAY_TRANSACTION_H
+#include <stdbool.h>
 #include <stdint.h>
 
 /**
@@ -19,15 +20,40 @@
  * create and commits a transaction from the dirty containers.
  */
 
+struct sway_node;
 struct sway_transaction_instruction;
 struct sway_view;
 
+/**
+ * Return true if committing the node would change its current state. This is
+ * conservatively true while the node is part of a transaction in flight, as
+ * its current state is then about to be replaced.
+ */
+bool transaction_node_changed(struct sway_node *node);
+
 /**
  * Find all dirty containers, create and commit a transaction containing them,
  * and unmark them as dirty.
+ *
+ * If transaction batching is enabled (-Dtxn-batch), the dirty containers are
+ * only collected once the batching window is over, so that bursts of layout
+ * changes are folded into a single transaction.
  */
 void transaction_commit_dirty(void);
 
+/**
+ * Like transaction_commit_dirty(), but never deferred by batching. Used when
+ * something the transaction needs is about to go away, such as the surface of
+ * an unmapping view which has to be saved for it.
+ */
+void transaction_commit_dirty_now(void);
+
+/**
+ * Commit the dirty containers of a pending batch right away. Called on each
+ * output frame.
+ */
+void transaction_flush_batch(void);
+
 /**
  * Notify the transaction system that a view is ready for the new layout.
  *
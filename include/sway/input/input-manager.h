@@ -50,6 +50,12 @@ void input_manager_reset_input(struct sway_input_device *input_device);
 
 void input_manager_reset_all_inputs(void);
 
+/**
+ * Disarm key repeat and drop the held release binding of every keyboard. Done
+ * on reload, as the bindings belong to the config which is freed.
+ */
+void input_manager_forget_bindings(void);
+
 void input_manager_apply_seat_config(struct seat_config *seat_config);
 
 struct sway_seat *input_manager_get_default_seat(void);
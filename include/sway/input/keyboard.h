@@ -50,6 +50,7 @@ struct sway_shortcut_state {
 
 struct sway_keyboard {
 	struct sway_seat_device *seat_device;
+	const char *identifier; // interned, for comparing to binding inputs
 
 	struct xkb_keymap *keymap;
 	xkb_layout_index_t effective_layout;
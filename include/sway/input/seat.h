@@ -30,6 +30,8 @@ struct sway_seatop_impl {
 	void (*render)(struct sway_seat *seat, struct sway_output *output,
 			pixman_region32_t *damage);
 	bool allow_set_cursor;
+	// Pointer motion only drives layout changes, so it may be coalesced
+	bool coalesce_motion;
 };
 
 struct sway_seat_device {
@@ -93,6 +95,13 @@ struct sway_seat {
 	const struct sway_seatop_impl *seatop_impl;
 	void *seatop_data;
 
+	// Pointer motion held back until the next output frame
+	struct {
+		bool pending;
+		uint32_t time_msec;
+		double dx, dy;
+	} coalesced_motion;
+
 	uint32_t last_button_serial;
 
 	uint32_t idle_inhibit_sources, idle_wake_sources;
@@ -275,6 +284,18 @@ void seatop_button(struct sway_seat *seat, uint32_t time_msec,
 void seatop_pointer_motion(struct sway_seat *seat, uint32_t time_msec,
 		double dx, double dy);
 
+/**
+ * Dispatch pointer motion which was coalesced by seatop_pointer_motion. Called
+ * once per output frame.
+ */
+void seatop_flush_pointer_motion(struct sway_seat *seat);
+
+/**
+ * Drop the pointer motion coalesced by seatop_pointer_motion. Used by seatops
+ * whose container is going away before they end.
+ */
+void seatop_discard_pointer_motion(struct sway_seat *seat);
+
 void seatop_pointer_axis(struct sway_seat *seat,
 		struct wlr_event_pointer_axis *event);
 
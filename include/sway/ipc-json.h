@@ -1,17 +1,71 @@
 #ifndef _SWAY_IPC_JSON_H
 #define _SWAY_IPC_JSON_H
 #include <json.h>
+#include "sway/output.h"
 #include "sway/tree/container.h"
+#include "sway/tree/workspace.h"
 #include "sway/input/input-manager.h"
+#include "sway/json-writer.h"
 
 json_object *ipc_json_get_version(void);
 
 json_object *ipc_json_get_binding_mode(void);
 
 json_object *ipc_json_describe_disabled_output(struct sway_output *o);
+json_object *ipc_json_describe_frame_stats(struct sway_output *o);
+json_object *ipc_json_describe_damage_stats(struct sway_output *o);
+json_object *ipc_json_describe_titlebar_cache(void);
+/**
+ * Describe a node as GET_TREE does, leaving out its tiling children.
+ */
 json_object *ipc_json_describe_node(struct sway_node *node);
 json_object *ipc_json_describe_node_recursive(struct sway_node *node);
+
+/**
+ * Restricts the nodes and fields written by ipc_json_write_node_recursive.
+ */
+struct ipc_json_tree_query {
+	int max_depth; // levels of children to include, or -1 for all
+	list_t *fields; // char *, NULL for all fields
+};
+
+/**
+ * Write the same description as ipc_json_describe_node_recursive, without
+ * building json-c objects. If query is not NULL, only the selected
+ * fields of the nodes up to its depth are written. The nodes and
+ * floating_nodes fields are always written, except below the depth limit.
+ * The top node also gets the given tree generation.
+ */
+void ipc_json_write_node_recursive(struct json_writer *writer,
+		struct sway_node *node, const struct ipc_json_tree_query *query,
+		uint64_t generation);
 json_object *ipc_json_describe_input(struct sway_input_device *device);
+
+/**
+ * Append to deltas the changes applying the state will make to the node's
+ * current state.
+ */
+void ipc_json_describe_output_delta(json_object *deltas,
+		struct sway_output *output, struct sway_output_state *state);
+void ipc_json_describe_workspace_delta(json_object *deltas,
+		struct sway_workspace *workspace, struct sway_workspace_state *state);
+void ipc_json_describe_container_delta(json_object *deltas,
+		struct sway_container *container, struct sway_container_state *state);
+
+/**
+ * Append a property delta with the node's value of a property which changes
+ * outside of transactions: name, app_id, marks or urgent.
+ */
+void ipc_json_describe_property_change(json_object *deltas,
+		struct sway_node *node, const char *property);
+
+/**
+ * Append a property delta if the urgency of a container without a view, which
+ * follows its descendants, changed since it was last reported. deltas may be
+ * NULL to only remember the urgency.
+ */
+void ipc_json_describe_urgency_change(json_object *deltas,
+		struct sway_container *container);
 json_object *ipc_json_describe_seat(struct sway_seat *seat);
 json_object *ipc_json_describe_bar_config(struct bar_config *bar);
 
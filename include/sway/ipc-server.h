@@ -1,5 +1,6 @@
 #ifndef _SWAY_IPC_SERVER_H
 #define _SWAY_IPC_SERVER_H
+#include <json.h>
 #include <sys/socket.h>
 #include "sway/config.h"
 #include "sway/input/input-manager.h"
@@ -22,4 +23,29 @@ void ipc_event_shutdown(const char *reason);
 void ipc_event_binding(struct sway_binding *binding);
 void ipc_event_input(const char *change, struct sway_input_device *device);
 
+/**
+ * Return an array to collect the tree deltas of a transaction in, or NULL if
+ * no client is subscribed to tree events.
+ */
+json_object *ipc_event_tree_begin(void);
+
+/**
+ * Send the deltas, if any, to the subscribed clients as the next tree
+ * generation. Called once per applied transaction. Takes ownership of deltas,
+ * which may be NULL.
+ */
+void ipc_event_tree(json_object *deltas);
+
+/**
+ * Send a tree event for a change to a property which isn't part of
+ * transactions, such as a view's title or marks.
+ */
+void ipc_event_tree_property(struct sway_node *node, const char *property);
+
+/**
+ * Send a tree event for the containers above a view whose urgency changed, as
+ * their urgency follows their descendants.
+ */
+void ipc_event_tree_ancestors_urgency(struct sway_container *container);
+
 #endif
@@ -0,0 +1,89 @@
+#ifndef _SWAY_JSON_WRITER_H
+#define _SWAY_JSON_WRITER_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <json.h>
+
+enum json_writer_format {
+	JSON_WRITER_TEXT,
+	JSON_WRITER_MSGPACK,
+	JSON_WRITER_OBJECT,
+};
+
+struct json_writer_container {
+	size_t offset; // of the container header
+	uint32_t count;
+	bool object;
+	json_object *json; // only used for JSON_WRITER_OBJECT
+};
+
+/**
+ * Writes JSON directly into a growable buffer, without building a json-c
+ * object graph first. The caller is responsible for producing well-formed
+ * output: keys are only valid directly inside objects, and every begin has to
+ * be matched by an end.
+ *
+ * With JSON_WRITER_MSGPACK the same data model is written as MessagePack.
+ * Containers are written with 32-bit length headers which are filled in when
+ * the container ends.
+ *
+ * With JSON_WRITER_OBJECT the data is built as json-c objects instead, for
+ * callers which need to modify it or embed it in other objects. These writers
+ * are finished with json_writer_finish_object. Keys are only referenced until
+ * their value is written.
+ *
+ * Allocation failures are sticky: once one happens the writer stops writing
+ * and json_writer_finish returns NULL.
+ */
+struct json_writer {
+	enum json_writer_format format;
+	char *buf;
+	size_t len, cap;
+	bool need_comma;
+	bool failed;
+	// Open containers, not used for text
+	struct json_writer_container *stack;
+	size_t depth, stack_cap;
+	// The top-level value and the pending key, for JSON_WRITER_OBJECT
+	json_object *result;
+	const char *key;
+};
+
+void json_writer_init(struct json_writer *writer,
+		enum json_writer_format format);
+
+/**
+ * Return the data written so far, which the caller must free, and reset the
+ * writer. The data is NUL-terminated, although MessagePack may also contain
+ * NUL bytes. Returns NULL if writing failed.
+ */
+char *json_writer_finish(struct json_writer *writer, size_t *len);
+/**
+ * Return the object built by a JSON_WRITER_OBJECT writer, which the caller
+ * owns, and reset the writer. Returns NULL if writing failed.
+ */
+json_object *json_writer_finish_object(struct json_writer *writer);
+
+void json_writer_begin_object(struct json_writer *writer);
+void json_writer_end_object(struct json_writer *writer);
+void json_writer_begin_array(struct json_writer *writer);
+void json_writer_end_array(struct json_writer *writer);
+
+void json_writer_key(struct json_writer *writer, const char *key);
+
+/**
+ * Write a string, or null if str is NULL.
+ */
+void json_writer_string(struct json_writer *writer, const char *str);
+void json_writer_int(struct json_writer *writer, int64_t value);
+void json_writer_double(struct json_writer *writer, double value);
+void json_writer_bool(struct json_writer *writer, bool value);
+void json_writer_null(struct json_writer *writer);
+
+/**
+ * Write a json-c object graph.
+ */
+void json_writer_object(struct json_writer *writer, json_object *obj);
+
+#endif
@@ -12,6 +12,84 @@
 struct sway_server;
 struct sway_container;
 
+#define OUTPUT_FRAME_SAMPLES 128
+#define OUTPUT_DAMAGE_SOURCES 16
+#define OUTPUT_DAMAGE_HISTORY 8
+
+/**
+ * A ring buffer holding the most recent per-frame samples. Timings are in
+ * microseconds.
+ */
+struct sway_frame_samples {
+	uint32_t samples[OUTPUT_FRAME_SAMPLES];
+	size_t next; // index the next sample will be written to
+	size_t len;
+};
+
+/**
+ * Why direct scan-out of a surface was not possible.
+ */
+enum sway_scanout_rejection {
+	SCANOUT_REJECT_SAVED_BUFFERS, // the view is in a transaction
+	SCANOUT_REJECT_FLOATING, // floating containers are shown on top
+	SCANOUT_REJECT_UNMANAGED, // Xwayland unmanaged surfaces are shown
+	SCANOUT_REJECT_LAYERS, // other layer surfaces are shown on top
+	SCANOUT_REJECT_DRAG_ICONS,
+	SCANOUT_REJECT_SEATOP, // a seat operation draws on the output
+	SCANOUT_REJECT_NO_BUFFER,
+	SCANOUT_REJECT_SURFACES, // there are subsurfaces or popups
+	SCANOUT_REJECT_GEOMETRY, // the surface does not cover the output exactly
+	SCANOUT_REJECT_NOT_OPAQUE,
+	SCANOUT_REJECT_SCALE,
+	SCANOUT_REJECT_TRANSFORM,
+	SCANOUT_REJECT_COMMIT, // the backend refused the buffer
+	SCANOUT_REJECT_COUNT,
+};
+
+struct sway_output_frame_stats {
+	struct sway_frame_samples render; // time spent in output_render
+	struct sway_frame_samples present; // latency from commit to presentation
+	struct sway_frame_samples draw_calls; // per rendered frame
+	struct sway_frame_samples scissor_changes; // per rendered frame
+
+	uint64_t frames_rendered;
+	uint64_t frames_missed; // presented after the refresh they were aiming for
+	uint64_t scanout_attempts;
+	uint64_t scanout_hits;
+	uint64_t scanout_rejections[SCANOUT_REJECT_COUNT];
+	bool scanning_out; // whether the last frame was scanned out
+
+	bool commit_pending;
+	struct timespec commit_time; // in the backend's presentation clock
+};
+
+/**
+ * A client damaging the output. Only the clients which damaged the most area
+ * are kept: when all slots are taken, the one with the least area is replaced.
+ */
+struct sway_damage_source {
+	struct wl_client *client; // NULL if the slot is free
+	pid_t pid;
+	char name[64]; // app_id or class of the view it last damaged, if any
+	uint64_t commits;
+	uint64_t whole_commits; // which damaged the whole surface
+	uint64_t area; // in output buffer pixels
+	struct wl_listener client_destroy;
+};
+
+struct sway_output_damage_stats {
+	struct sway_frame_samples area; // damaged pixels per rendered frame
+	struct sway_frame_samples rects; // damage rectangles per rendered frame
+	uint64_t frames_full; // the whole output was damaged
+	uint64_t frames_skipped; // frame events without any damage
+
+	struct sway_damage_source sources[OUTPUT_DAMAGE_SOURCES];
+
+	// Damage of the most recent frames, kept for -Ddamage=heatmap
+	pixman_region32_t history[OUTPUT_DAMAGE_HISTORY];
+	size_t history_next;
+};
+
 struct sway_output_state {
 	list_t *workspaces;
 	struct sway_workspace *active_workspace;
@@ -55,7 +133,13 @@ struct sway_output {
 	struct timespec last_presentation;
 	uint32_t refresh_nsec;
 	int max_render_time; // In milliseconds
+	bool max_render_time_auto;
+	int max_render_time_backoff; // In milliseconds, grows on missed frames
+	int frames_since_miss;
 	struct wl_event_source *repaint_timer;
+
+	struct sway_output_frame_stats frame_stats;
+	struct sway_output_damage_stats damage_stats;
 };
 
 struct sway_output *output_create(struct wlr_output *wlr_output);
@@ -105,9 +189,25 @@ bool output_has_opaque_overlay_layer_surface(struct sway_output *output);
 
 struct sway_workspace *output_get_active_workspace(struct sway_output *output);
 
-void output_render(struct sway_output *output, struct timespec *when,
+/**
+ * Render and commit a frame. Returns true if the frame was committed.
+ */
+bool output_render(struct sway_output *output, struct timespec *when,
 	pixman_region32_t *damage);
 
+void frame_samples_add(struct sway_frame_samples *samples, uint32_t value);
+
+void output_damage_stats_init(struct sway_output *output);
+
+void output_damage_stats_finish(struct sway_output *output);
+
+/**
+ * Get the given percentile (0-100) of the recorded samples, or 0 if there are
+ * none.
+ */
+uint32_t frame_samples_percentile(const struct sway_frame_samples *samples,
+	int percentile);
+
 void output_surface_for_each_surface(struct sway_output *output,
 		struct wlr_surface *surface, double ox, double oy,
 		sway_surface_iterator_func_t iterator, void *user_data);
@@ -86,6 +86,12 @@ struct sway_server {
 	struct wlr_foreign_toplevel_manager_v1 *foreign_toplevel_manager;
 
 	size_t txn_timeout_ms;
+	// Dirty nodes are batched into one transaction for this long, or until
+	// the next output frame if txn_batch_frame is set
+	size_t txn_batch_ms;
+	bool txn_batch_frame;
+	struct wl_event_source *txn_batch_timer;
+	bool txn_batch_pending;
 	list_t *transactions;
 	list_t *dirty_nodes;
 };
@@ -101,7 +107,9 @@ struct sway_debug {
 		DAMAGE_DEFAULT,    // Default behaviour
 		DAMAGE_HIGHLIGHT,  // Highlight regions of the screen being damaged
 		DAMAGE_RERENDER,   // Render the full output when any damage occurs
+		DAMAGE_HEATMAP,    // Tint the damage of recent frames over each other
 	} damage;
+	bool occlusion;        // Highlight regions skipped as hidden by opaque surfaces
 };
 
 extern struct sway_debug debug;
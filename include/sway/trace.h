@@ -0,0 +1,47 @@
+#ifndef _SWAY_TRACE_H
+#define _SWAY_TRACE_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <json.h>
+
+/**
+ * The tracer records spans of compositor work into a file in the Chrome
+ * trace-event JSON format, which can be loaded into Perfetto or
+ * chrome://tracing.
+ *
+ * Timestamps are CLOCK_MONOTONIC. Spans recorded on the same track are shown on
+ * the same row and must nest properly; async spans may overlap freely and are
+ * grouped by name.
+ *
+ * The args objects passed to the recording functions are always consumed, even
+ * when tracing is inactive.
+ */
+
+bool trace_start(const char *path);
+
+void trace_stop(void);
+
+bool trace_is_active(void);
+
+/**
+ * Record a span on the given track.
+ */
+void trace_span(const char *track, const char *name,
+		const struct timespec *start, const struct timespec *end,
+		json_object *args);
+
+/**
+ * Record a span which may overlap other spans of the same name.
+ */
+void trace_async_span(const char *name, uint64_t id,
+		const struct timespec *start, const struct timespec *end,
+		json_object *args);
+
+/**
+ * Record a point in time on the given track.
+ */
+void trace_instant(const char *track, const char *name,
+		const struct timespec *when, json_object *args);
+
+#endif
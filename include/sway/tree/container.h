@@ -35,6 +35,7 @@ struct sway_root;
 struct sway_output;
 struct sway_workspace;
 struct sway_view;
+struct border_colors;
 
 enum wlr_direction;
 
@@ -132,12 +133,18 @@ struct sway_container {
 	// Hidden scratchpad containers have a NULL parent.
 	bool scratchpad;
 
+	// For containers without a view, whether a descendant was urgent when
+	// tree events last reported it
+	bool urgent_reported;
+
 	float alpha;
 
 	struct wlr_texture *title_focused;
 	struct wlr_texture *title_focused_inactive;
 	struct wlr_texture *title_unfocused;
 	struct wlr_texture *title_urgent;
+	// Rendering the title gave no texture, eg. because it's empty
+	bool title_textures_empty;
 	size_t title_height;
 	size_t title_baseline;
 
@@ -146,6 +153,7 @@ struct sway_container {
 	struct wlr_texture *marks_focused_inactive;
 	struct wlr_texture *marks_unfocused;
 	struct wlr_texture *marks_urgent;
+	bool marks_textures_empty;
 
 	struct {
 		struct wl_signal destroy;
@@ -195,8 +203,27 @@ void container_reap_empty(struct sway_container *con);
 
 struct sway_container *container_flatten(struct sway_container *container);
 
+/**
+ * Drop the container's title textures. They are rendered again when the
+ * container's titlebar is next drawn.
+ */
 void container_update_title_textures(struct sway_container *container);
 
+/**
+ * Get the title texture for the given border color class, rendering it if it
+ * hasn't been rendered since the title last changed. Only the class actually
+ * displayed is ever rendered. A title which gives no texture isn't tried
+ * again until it changes.
+ */
+struct wlr_texture *container_get_title_texture(struct sway_container *con,
+		struct border_colors *class);
+
+/**
+ * Drop all title and marks textures of the container, e.g. because it isn't
+ * visible any more.
+ */
+void container_release_textures(struct sway_container *con);
+
 /**
  * Calculate the container's title_height property.
  */
@@ -361,6 +388,13 @@ void container_add_mark(struct sway_container *container, char *mark);
 
 void container_update_marks_textures(struct sway_container *container);
 
+/**
+ * Get the marks texture for the given border color class, rendering it on
+ * demand. Returns NULL if marks aren't shown or there are none to display.
+ */
+struct wlr_texture *container_get_marks_texture(struct sway_container *con,
+		struct border_colors *class);
+
 void container_raise_floating(struct sway_container *con);
 
 bool container_is_scratchpad_hidden(struct sway_container *con);
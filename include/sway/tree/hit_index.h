@@ -0,0 +1,64 @@
+#ifndef _SWAY_HIT_INDEX_H
+#define _SWAY_HIT_INDEX_H
+#include <stdbool.h>
+
+struct sway_container;
+struct sway_node;
+struct sway_seat;
+struct sway_workspace;
+
+struct sway_hit_rect {
+	double x, y, width, height;
+	// Whether points on the right and bottom edges hit the rect
+	bool right_edge, bottom_edge;
+	struct sway_container *con;
+};
+
+/**
+ * A uniform grid over the regions of a workspace's tiling layer which resolve
+ * to a container when hit-testing: views and the titlebars of tabbed and
+ * stacked containers. Like tiling_container_at, it is built from the pending
+ * state of the tree and the focus of the current seat. Every change to the
+ * workspace's tiling layer invalidates it, and it is rebuilt lazily on the next
+ * lookup, so that a burst of changes costs one rebuild.
+ *
+ * Each grid cell lists the rects overlapping it in hit priority order, so a
+ * lookup only has to test the handful of rects in one cell instead of
+ * recursing through the whole tree.
+ */
+struct sway_hit_index {
+	bool valid;
+	struct sway_seat *seat; // whose focus the index was built with
+
+	struct sway_hit_rect *rects; // in hit priority order
+	int rects_len, rects_cap;
+
+	double x, y, width, height; // bounds of all rects
+	int cols, rows;
+	int *cell_start; // cols * rows + 1 offsets into cell_rects
+	int *cell_rects; // indices into rects
+	int cells_cap, cell_rects_cap;
+};
+
+/**
+ * Mark the index for rebuilding on its next lookup.
+ */
+void hit_index_invalidate(struct sway_hit_index *index);
+
+/**
+ * Invalidate the index of the workspace whose tiling layer the node is in, if
+ * any.
+ */
+void hit_index_invalidate_node(struct sway_node *node);
+
+void hit_index_finish(struct sway_hit_index *index);
+
+/**
+ * Find the tiling container at the given layout coordinates on the workspace.
+ * This is equivalent to tiling_container_at on the workspace node, except that
+ * it doesn't look up surfaces.
+ */
+struct sway_container *hit_index_container_at(struct sway_workspace *ws,
+		double lx, double ly);
+
+#endif
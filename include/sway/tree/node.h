@@ -39,6 +39,10 @@ struct sway_node {
 	size_t ntxnrefs;
 	bool destroying;
 
+	// Whether the current state describes the node, ie. a transaction has
+	// applied state to it and it isn't being destroyed
+	bool current_applied;
+
 	// If true, indicates that the container has pending state that differs from
 	// the current.
 	bool dirty;
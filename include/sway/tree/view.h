@@ -1,5 +1,6 @@
 #ifndef _SWAY_VIEW_H
 #define _SWAY_VIEW_H
+#include <time.h>
 #include <wayland-server-core.h>
 #include <wlr/types/wlr_surface.h>
 #include "config.h"
@@ -65,6 +66,15 @@ struct sway_saved_buffer {
 	struct wl_list link; // sway_view::saved_buffers
 };
 
+/**
+ * How long a client takes to respond to configures, smoothed the way TCP
+ * smooths round-trip times.
+ */
+struct sway_configure_latency {
+	double srtt_ms, rttvar_ms;
+	int samples;
+};
+
 struct sway_view {
 	enum sway_view_type type;
 	const struct sway_view_impl *impl;
@@ -97,6 +107,19 @@ struct sway_view {
 	// when a transaction is applied.
 	struct wlr_box saved_geometry;
 
+	// X11 windows all share the Xwayland client, so their configure latency
+	// is tracked per view rather than per client
+	struct sway_configure_latency configure_latency;
+
+	// A configure which stopped being waited for before the client responded,
+	// so that the latency of the late response can still be sampled
+	struct {
+		bool pending;
+		uint32_t serial;
+		int width, height;
+		struct timespec sent;
+	} late_configure;
+
 	struct wlr_foreign_toplevel_handle_v1 *foreign_toplevel;
 	struct wl_listener foreign_activate_request;
 	struct wl_listener foreign_fullscreen_request;
@@ -106,6 +129,9 @@ struct sway_view {
 	bool destroying;
 
 	list_t *executed_criteria; // struct criteria *
+	// Criteria whose attribute patterns match, see criteria_for_view
+	list_t *attribute_criteria; // struct criteria *
+	uint32_t attribute_criteria_generation; // 0 if stale
 
 	union {
 		struct wlr_xdg_surface *wlr_xdg_surface;
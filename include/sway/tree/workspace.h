@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include "sway/tree/container.h"
+#include "sway/tree/hit_index.h"
 #include "sway/tree/node.h"
 
 struct sway_view;
@@ -43,6 +44,7 @@ struct sway_workspace {
 	bool urgent;
 
 	struct sway_workspace_state current;
+	struct sway_hit_index hit_index; // of the pending tiling layer
 };
 
 struct workspace_config *workspace_find_config(const char *ws_name);
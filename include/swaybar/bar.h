@@ -39,6 +39,7 @@ struct swaybar {
 
 	int ipc_event_socketfd;
 	int ipc_socketfd;
+	bool ipc_msgpack; // both sockets negotiated MessagePack
 
 	struct wl_list outputs; // swaybar_output::link
 	struct wl_list unused_outputs; // swaybar_output::link
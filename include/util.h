@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <time.h>
 #include <wayland-server-protocol.h>
 
 enum movement_unit {
@@ -35,6 +36,11 @@ int parse_movement_amount(int argc, char **argv,
 
 uint32_t get_current_time_msec(void);
 
+/**
+ * Get the difference between two timestamps (a - b), in nanoseconds.
+ */
+int64_t timespec_sub_nsec(const struct timespec *a, const struct timespec *b);
+
 /**
  * Wrap i into the range [0, max]
  */
@@ -134,6 +134,7 @@ static struct cmd_handler command_handlers[] = {
 	{ "sticky", cmd_sticky },
 	{ "swap", cmd_swap },
 	{ "title_format", cmd_title_format },
+	{ "trace", cmd_trace },
 	{ "unmark", cmd_unmark },
 	{ "urgent", cmd_urgent },
 };
@@ -197,6 +198,57 @@ static void set_config_node(struct sway_node *node) {
 	}
 }
 
+// Runs a single command on the matched containers, or on con or the focus if
+// there are no criteria. Returns false if the rest of the command list has to
+// be skipped.
+static bool run_command(struct cmd_handler *handler, int argc, char **argv,
+		list_t *containers, struct sway_seat *seat,
+		struct sway_container *con, list_t *res_list) {
+	if (!config->handler_context.using_criteria) {
+		// The container or workspace which this command will run on.
+		struct sway_node *node = con ? &con->node :
+				seat_get_focus_inactive(seat, &root->node);
+		set_config_node(node);
+		struct cmd_results *res = handler->handle(argc-1, argv+1);
+		list_add(res_list, res);
+		return res->status != CMD_INVALID;
+	} else if (containers->length == 0) {
+		list_add(res_list,
+				cmd_results_new(CMD_FAILURE, "No matching node."));
+		return true;
+	}
+
+	struct cmd_results *fail_res = NULL;
+	for (int i = 0; i < containers->length; ++i) {
+		struct sway_container *container = containers->items[i];
+		set_config_node(&container->node);
+		struct cmd_results *res = handler->handle(argc-1, argv+1);
+		if (res->status == CMD_SUCCESS) {
+			free_cmd_results(res);
+		} else {
+			// last failure will take precedence
+			if (fail_res) {
+				free_cmd_results(fail_res);
+			}
+			fail_res = res;
+			if (res->status == CMD_INVALID) {
+				list_add(res_list, fail_res);
+				return false;
+			}
+		}
+	}
+	list_add(res_list,
+			fail_res ? fail_res : cmd_results_new(CMD_SUCCESS, NULL));
+	return true;
+}
+
+// Whether the arguments of the command are taken verbatim
+static bool command_keeps_quotes(const char *name) {
+	return strcmp(name, "exec") == 0 ||
+		strcmp(name, "exec_always") == 0 ||
+		strcmp(name, "mode") == 0;
+}
+
 list_t *execute_command(char *_exec, struct sway_seat *seat,
 		struct sway_container *con) {
 	char *cmd;
@@ -256,9 +308,7 @@ list_t *execute_command(char *_exec, struct sway_seat *seat,
 		//TODO better handling of argv
 		int argc;
 		char **argv = split_args(cmd, &argc);
-		if (strcmp(argv[0], "exec") != 0 &&
-				strcmp(argv[0], "exec_always") != 0 &&
-				strcmp(argv[0], "mode") != 0) {
+		if (!command_keeps_quotes(argv[0])) {
 			for (int i = 1; i < argc; ++i) {
 				if (*argv[i] == '\"' || *argv[i] == '\'') {
 					strip_quotes(argv[i]);
@@ -278,52 +328,312 @@ list_t *execute_command(char *_exec, struct sway_seat *seat,
 			argv[i] = do_var_replacement(argv[i]);
 		}
 
-		if (!config->handler_context.using_criteria) {
-			// The container or workspace which this command will run on.
-			struct sway_node *node = con ? &con->node :
-					seat_get_focus_inactive(seat, &root->node);
-			set_config_node(node);
-			struct cmd_results *res = handler->handle(argc-1, argv+1);
-			list_add(res_list, res);
-			if (res->status == CMD_INVALID) {
-				free_argv(argc, argv);
-				goto cleanup;
+		bool proceed = run_command(handler, argc, argv, containers, seat, con,
+				res_list);
+		free_argv(argc, argv);
+		if (!proceed) {
+			goto cleanup;
+		}
+	} while(head);
+cleanup:
+	free(exec);
+	list_free(containers);
+	return res_list;
+}
+
+/**
+ * A command of a compiled command list. The arguments are split, unquoted
+ * and stored back to back; only variables are expanded on each run, as they
+ * may change at runtime.
+ */
+struct cmd_program_command {
+	char *text; // for logging
+	struct cmd_handler *handler;
+	bool new_list; // the first command after a ';', which resets the criteria
+	struct criteria *criteria; // criteria of a new list, if any
+	char *criteria_raw; // criteria which have to be parsed on each run
+	int argc;
+	char *args;
+	size_t args_len;
+	bool expand; // whether an argument refers to a variable
+};
+
+struct cmd_program {
+	int refs;
+	bool fallback; // could not be compiled, run through execute_command
+	list_t *commands; // struct cmd_program_command
+};
+
+static void cmd_program_command_destroy(struct cmd_program_command *command) {
+	if (command->criteria) {
+		criteria_destroy(command->criteria);
+	}
+	free(command->criteria_raw);
+	free(command->text);
+	free(command->args);
+	free(command);
+}
+
+static void cmd_program_clear(struct cmd_program *program) {
+	for (int i = 0; i < program->commands->length; ++i) {
+		cmd_program_command_destroy(program->commands->items[i]);
+	}
+	program->commands->length = 0;
+}
+
+void cmd_program_unref(struct cmd_program *program) {
+	if (!program || --program->refs > 0) {
+		return;
+	}
+	cmd_program_clear(program);
+	list_free(program->commands);
+	free(program);
+}
+
+static bool compile_command(struct cmd_program_command *command, char *cmd) {
+	if (!(command->text = strdup(cmd))) {
+		return false;
+	}
+	int argc;
+	char **argv = split_args(cmd, &argc);
+	if (!command_keeps_quotes(argv[0])) {
+		for (int i = 1; i < argc; ++i) {
+			if (*argv[i] == '\"' || *argv[i] == '\'') {
+				strip_quotes(argv[i]);
 			}
-		} else if (containers->length == 0) {
-			list_add(res_list,
-					cmd_results_new(CMD_FAILURE, "No matching node."));
-		} else {
-			struct cmd_results *fail_res = NULL;
-			for (int i = 0; i < containers->length; ++i) {
-				struct sway_container *container = containers->items[i];
-				set_config_node(&container->node);
-				struct cmd_results *res = handler->handle(argc-1, argv+1);
-				if (res->status == CMD_SUCCESS) {
-					free_cmd_results(res);
-				} else {
-					// last failure will take precedence
-					if (fail_res) {
-						free_cmd_results(fail_res);
-					}
-					fail_res = res;
-					if (res->status == CMD_INVALID) {
-						list_add(res_list, fail_res);
-						free_argv(argc, argv);
-						goto cleanup;
+		}
+	}
+	command->handler = find_core_handler(argv[0]);
+	if (!command->handler) {
+		free_argv(argc, argv);
+		return false;
+	}
+
+	size_t len = 0;
+	for (int i = 0; i < argc; ++i) {
+		len += strlen(argv[i]) + 1;
+	}
+	command->args = malloc(len);
+	if (!command->args) {
+		free_argv(argc, argv);
+		return false;
+	}
+	char *p = command->args;
+	for (int i = 0; i < argc; ++i) {
+		size_t arg_len = strlen(argv[i]) + 1;
+		memcpy(p, argv[i], arg_len);
+		p += arg_len;
+	}
+	command->argc = argc;
+	command->args_len = len;
+	for (int i = command->handler->handle == cmd_set ? 2 : 1; i < argc; ++i) {
+		command->expand |= strchr(argv[i], '$') != NULL;
+	}
+	free_argv(argc, argv);
+	return true;
+}
+
+/**
+ * Parse the command list the way execute_command does. If something can only
+ * be reported at runtime, such as invalid criteria or an unknown command, the
+ * program falls back to execute_command.
+ */
+static struct cmd_program *cmd_program_compile(const char *exec) {
+	struct cmd_program *program = calloc(1, sizeof(struct cmd_program));
+	if (!program) {
+		return NULL;
+	}
+	program->refs = 1;
+	program->commands = create_list();
+	char *copy = strdup(exec);
+	if (!program->commands || !copy) {
+		free(copy);
+		list_free(program->commands);
+		free(program);
+		return NULL;
+	}
+
+	char *head = copy;
+	char matched_delim = ';';
+	bool new_list = false;
+	struct criteria *criteria = NULL;
+	char *criteria_raw = NULL;
+	do {
+		for (; isspace(*head); ++head) {}
+		if (matched_delim == ';') {
+			new_list = true;
+			if (criteria) {
+				criteria_destroy(criteria);
+				criteria = NULL;
+			}
+			free(criteria_raw);
+			criteria_raw = NULL;
+			if (*head == '[') {
+				char *error = NULL;
+				criteria = criteria_parse(head, &error);
+				if (!criteria) {
+					free(error);
+					goto fallback;
+				}
+				head += strlen(criteria->raw);
+				// con_id=__focused__ is resolved when parsing
+				if (strstr(criteria->raw, "__focused__")) {
+					criteria_raw = strdup(criteria->raw);
+					criteria_destroy(criteria);
+					criteria = NULL;
+					if (!criteria_raw) {
+						goto fallback;
 					}
 				}
+				for (; isspace(*head); ++head) {}
 			}
-			list_add(res_list,
-					fail_res ? fail_res : cmd_results_new(CMD_SUCCESS, NULL));
 		}
-		free_argv(argc, argv);
-	} while(head);
-cleanup:
-	free(exec);
+		char *cmd = argsep(&head, ";,", &matched_delim);
+		for (; isspace(*cmd); ++cmd) {}
+		if (strcmp(cmd, "") == 0) {
+			// Any criteria carry over to the next command
+			continue;
+		}
+
+		struct cmd_program_command *command =
+			calloc(1, sizeof(struct cmd_program_command));
+		if (!command) {
+			goto fallback;
+		}
+		command->new_list = new_list;
+		command->criteria = criteria;
+		command->criteria_raw = criteria_raw;
+		new_list = false;
+		criteria = NULL;
+		criteria_raw = NULL;
+		list_add(program->commands, command);
+		if (!compile_command(command, cmd)) {
+			goto fallback;
+		}
+	} while (head);
+	free(copy);
+	return program;
+
+fallback:
+	if (criteria) {
+		criteria_destroy(criteria);
+	}
+	free(criteria_raw);
+	free(copy);
+	cmd_program_clear(program);
+	program->fallback = true;
+	return program;
+}
+
+static list_t *cmd_program_run(struct cmd_program *program,
+		struct sway_seat *seat, struct sway_container *con) {
+	list_t *res_list = create_list();
+	if (!res_list) {
+		return NULL;
+	}
+	config->handler_context.seat = seat;
+
+	list_t *containers = NULL;
+	for (int i = 0; i < program->commands->length; ++i) {
+		struct cmd_program_command *command = program->commands->items[i];
+		if (command->new_list) {
+			config->handler_context.using_criteria = false;
+			struct criteria *criteria = command->criteria;
+			if (command->criteria_raw) {
+				char *error = NULL;
+				criteria = criteria_parse(command->criteria_raw, &error);
+				if (!criteria) {
+					list_add(res_list,
+							cmd_results_new(CMD_INVALID, "%s", error));
+					free(error);
+					break;
+				}
+			}
+			if (criteria) {
+				list_free(containers);
+				containers = criteria_get_containers(criteria);
+				config->handler_context.using_criteria = true;
+				if (criteria != command->criteria) {
+					criteria_destroy(criteria);
+				}
+			}
+		}
+		sway_log(SWAY_INFO, "Handling command '%s'", command->text);
+
+		// Handlers may modify their arguments, so they get a copy
+		int argc = command->argc;
+		char **argv = malloc(argc * sizeof(char *) + command->args_len);
+		if (!argv) {
+			list_add(res_list, cmd_results_new(CMD_FAILURE,
+					"Unable to allocate command arguments"));
+			break;
+		}
+		char *args = (char *)(argv + argc);
+		memcpy(args, command->args, command->args_len);
+		for (size_t j = 0, offset = 0; j < (size_t)argc; ++j) {
+			argv[j] = args + offset;
+			offset += strlen(args + offset) + 1;
+		}
+		int first = command->handler->handle == cmd_set ? 2 : 1;
+		if (command->expand) {
+			for (int j = first; j < argc; ++j) {
+				char *arg = strchr(argv[j], '$') ? strdup(argv[j]) : NULL;
+				if (arg) {
+					argv[j] = do_var_replacement(arg);
+				}
+			}
+		}
+
+		bool proceed = run_command(command->handler, argc, argv, containers,
+				seat, con, res_list);
+		// Free the expanded arguments, which no longer point into args. The
+		// offsets come from the pristine copy, the handler may have shortened
+		// the arguments.
+		for (size_t j = 0, offset = 0; j < (size_t)argc; ++j) {
+			if (argv[j] != args + offset) {
+				free(argv[j]);
+			}
+			offset += strlen(command->args + offset) + 1;
+		}
+		free(argv);
+		if (!proceed) {
+			break;
+		}
+	}
 	list_free(containers);
 	return res_list;
 }
 
+list_t *execute_compiled_command(struct cmd_program **program, char *exec,
+		struct sway_seat *seat, struct sway_container *con) {
+	// Which handlers are available depends on whether the config is being
+	// read, so only the runtime case is compiled
+	if (config->reading || !config->active) {
+		return execute_command(exec, seat, con);
+	}
+	if (!*program && !(*program = cmd_program_compile(exec))) {
+		return execute_command(exec, seat, con);
+	}
+	if ((*program)->fallback) {
+		return execute_command(exec, seat, con);
+	}
+
+	if (seat == NULL) {
+		seat = input_manager_get_default_seat();
+		if (!sway_assert(seat, "could not find a seat to run the command on")) {
+			return NULL;
+		}
+	}
+
+	// The command may free its own binding or criteria, and the program along
+	// with it
+	struct cmd_program *running = *program;
+	++running->refs;
+	list_t *res_list = cmd_program_run(running, seat, con);
+	cmd_program_unref(running);
+	return res_list;
+}
+
 // this is like execute_command above, except:
 // 1) it ignores empty commands (empty lines)
 // 2) it does variable substitution
@@ -3,8 +3,10 @@
 #include "sway/commands.h"
 #include "sway/config.h"
 #include "sway/ipc-server.h"
+#include "sway/output.h"
 #include "sway/server.h"
 #include "sway/tree/arrange.h"
+#include "sway/tree/root.h"
 #include "sway/tree/view.h"
 #include "list.h"
 #include "log.h"
@@ -35,10 +37,13 @@ static void do_reload(void *data) {
 
 	ipc_event_workspace(NULL, NULL, "reload");
 
-	load_swaybars();
-
+	// Bars which did not change kept their swaybar, see config_diff
 	for (int i = 0; i < config->bars->length; ++i) {
 		struct bar_config *bar = config->bars->items[i];
+		if (bar->client) {
+			continue;
+		}
+		load_swaybar(bar);
 		for (int j = 0; j < bar_ids->length; ++j) {
 			if (strcmp(bar->id, bar_ids->items[j]) == 0) {
 				ipc_event_barconfig_update(bar);
@@ -48,10 +53,20 @@ static void do_reload(void *data) {
 	}
 	list_free_items_and_destroy(bar_ids);
 
-	config_update_font_height(true);
-	root_for_each_container(rebuild_textures_iterator, NULL);
-
-	arrange_root();
+	uint32_t changes = config->reload_changes;
+	if (changes & CONFIG_CHANGE_FONT) {
+		config_update_font_height(true);
+	}
+	if (changes & (CONFIG_CHANGE_FONT | CONFIG_CHANGE_COLORS)) {
+		root_for_each_container(rebuild_textures_iterator, NULL);
+	}
+	if (changes & (CONFIG_CHANGE_FONT | CONFIG_CHANGE_GAPS)) {
+		arrange_root();
+	} else if (changes & CONFIG_CHANGE_COLORS) {
+		for (int i = 0; i < root->outputs->length; ++i) {
+			output_damage_whole(root->outputs->items[i]);
+		}
+	}
 }
 
 struct cmd_results *cmd_reload(int argc, char **argv) {
@@ -98,6 +98,12 @@ struct cmd_results *cmd_rename(int argc, char **argv) {
 
 	output_sort_workspaces(workspace->output);
 	ipc_event_workspace(NULL, workspace, "rename");
+	ipc_event_tree_property(&workspace->node, "name");
+	if (workspace->output &&
+			workspace->output->current.active_workspace == workspace) {
+		ipc_event_tree_property(&workspace->output->node,
+				"current_workspace");
+	}
 
 	return cmd_results_new(CMD_SUCCESS, NULL);
 }
@@ -0,0 +1,33 @@
+#include <stdlib.h>
+#include <string.h>
+#include "sway/commands.h"
+#include "sway/trace.h"
+#include "stringop.h"
+
+// trace start <file> | trace stop
+struct cmd_results *cmd_trace(int argc, char **argv) {
+	struct cmd_results *error = NULL;
+	if ((error = checkarg(argc, "trace", EXPECTED_AT_LEAST, 1))) {
+		return error;
+	}
+
+	if (strcmp(argv[0], "stop") == 0) {
+		if (argc != 1) {
+			return cmd_results_new(CMD_INVALID, "Expected 'trace stop'");
+		}
+		trace_stop();
+		return cmd_results_new(CMD_SUCCESS, NULL);
+	}
+	if (strcmp(argv[0], "start") != 0 || argc < 2) {
+		return cmd_results_new(CMD_INVALID,
+				"Expected 'trace start <file>' or 'trace stop'");
+	}
+
+	char *path = join_args(argv + 1, argc - 1);
+	bool started = trace_start(path);
+	free(path);
+	if (!started) {
+		return cmd_results_new(CMD_FAILURE, "Unable to open trace file");
+	}
+	return cmd_results_new(CMD_SUCCESS, NULL);
+}
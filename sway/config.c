@@ -58,6 +58,8 @@ static void free_mode(struct sway_mode *mode) {
 		return;
 	}
 	free(mode->name);
+	binding_index_invalidate(&mode->keysym_index);
+	binding_index_invalidate(&mode->keycode_index);
 	if (mode->keysym_bindings) {
 		for (int i = 0; i < mode->keysym_bindings->length; i++) {
 			free_sway_binding(mode->keysym_bindings->items[i]);
@@ -99,6 +101,7 @@ void free_config(struct sway_config *config) {
 		}
 		list_free(config->symbols);
 	}
+	variable_trie_destroy(config->symbol_trie);
 	if (config->modes) {
 		for (int i = 0; i < config->modes->length; ++i) {
 			free_mode(config->modes->items[i]);
@@ -146,6 +149,7 @@ void free_config(struct sway_config *config) {
 		list_free(config->seat_configs);
 	}
 	if (config->criteria) {
+		criteria_list_destroyed(config->criteria);
 		for (int i = 0; i < config->criteria->length; ++i) {
 			criteria_destroy(config->criteria->items[i]);
 		}
@@ -214,7 +218,7 @@ static void config_defaults(struct sway_config *config) {
 
 	if (!(config->cmd_queue = create_list())) goto cleanup;
 
-	if (!(config->current_mode = malloc(sizeof(struct sway_mode))))
+	if (!(config->current_mode = calloc(1, sizeof(struct sway_mode))))
 		goto cleanup;
 	if (!(config->current_mode->name = malloc(sizeof("default")))) goto cleanup;
 	strcpy(config->current_mode->name, "default");
@@ -435,15 +439,9 @@ bool load_main_config(const char *file, bool is_active, bool validating) {
 		config->xwayland = old_config->xwayland;
 
 		if (!config->validating) {
-			if (old_config->swaybg_client != NULL) {
-				wl_client_destroy(old_config->swaybg_client);
-			}
-
 			if (old_config->swaynag_config_errors.client != NULL) {
 				wl_client_destroy(old_config->swaynag_config_errors.client);
 			}
-
-			input_manager_reset_all_inputs();
 		}
 	}
 
@@ -511,15 +509,33 @@ bool load_main_config(const char *file, bool is_active, bool validating) {
 	}
 
 	if (is_active && !validating) {
-		input_manager_verify_fallback_seat();
+		// Only touch the parts of the running session which changed
+		config->reload_changes = config_diff(old_config, config);
+
+		// The font height is only measured again if the font changed, see
+		// do_reload
+		if (!(config->reload_changes & CONFIG_CHANGE_FONT)) {
+			config->font_height = old_config->font_height;
+			config->font_baseline = old_config->font_baseline;
+		}
 
-		for (int i = 0; i < config->input_configs->length; i++) {
-			input_manager_apply_input_config(config->input_configs->items[i]);
+		// Bindings kept by the keyboards belong to the old config
+		input_manager_forget_bindings();
+		if (config->reload_changes & CONFIG_CHANGE_INPUTS) {
+			input_manager_reset_all_inputs();
 		}
+		input_manager_verify_fallback_seat();
 
-		for (int i = 0; i < config->input_type_configs->length; i++) {
-			input_manager_apply_input_config(
-					config->input_type_configs->items[i]);
+		if (config->reload_changes & CONFIG_CHANGE_INPUTS) {
+			for (int i = 0; i < config->input_configs->length; i++) {
+				input_manager_apply_input_config(
+						config->input_configs->items[i]);
+			}
+
+			for (int i = 0; i < config->input_type_configs->length; i++) {
+				input_manager_apply_input_config(
+						config->input_type_configs->items[i]);
+			}
 		}
 
 		for (int i = 0; i < config->seat_configs->length; i++) {
@@ -527,8 +543,15 @@ bool load_main_config(const char *file, bool is_active, bool validating) {
 		}
 		sway_switch_retrigger_bindings_for_all();
 
-		reset_outputs();
-		spawn_swaybg();
+		if (config->reload_changes & CONFIG_CHANGE_OUTPUTS) {
+			if (old_config->swaybg_client != NULL) {
+				wl_client_destroy(old_config->swaybg_client);
+			}
+			reset_outputs();
+			spawn_swaybg();
+		} else {
+			swaybg_reuse_client(config, old_config);
+		}
 
 		config->reloading = false;
 		if (config->swaynag_config_errors.client != NULL) {
@@ -900,56 +923,85 @@ void config_add_swaynag_warning(char *fmt, ...) {
 	}
 }
 
+struct var_buffer {
+	char *data;
+	size_t len, cap;
+};
+
+static bool var_buffer_append(struct var_buffer *buffer, const char *str,
+		size_t len) {
+	if (buffer->len + len > buffer->cap) {
+		size_t cap = buffer->cap * 2;
+		while (buffer->len + len > cap) {
+			cap *= 2;
+		}
+		char *data = realloc(buffer->data, cap);
+		if (!data) {
+			return false;
+		}
+		buffer->data = data;
+		buffer->cap = cap;
+	}
+	memcpy(buffer->data + buffer->len, str, len);
+	buffer->len += len;
+	return true;
+}
+
 char *do_var_replacement(char *str) {
-	int i;
-	char *find = str;
-	while ((find = strchr(find, '$'))) {
+	char *find = strchr(str, '$');
+	if (!find) {
+		return str;
+	}
+	size_t len = strlen(str);
+	struct var_buffer out = {
+		.data = malloc(len + 1),
+		.cap = len + 1,
+	};
+	if (!out.data) {
+		sway_log(SWAY_ERROR, "Unable to allocate variable expansion buffer");
+		return str;
+	}
+
+	// The expansion is written to out in a single pass, escapes are checked
+	// against what has been written so far
+	const char *rest = str;
+	bool success = true;
+	for (; success && find; find = strchr(rest, '$')) {
+		success = var_buffer_append(&out, rest, find - rest);
 		// Skip if escaped.
-		if (find > str && find[-1] == '\\') {
-			if (find == str + 1 || !(find > str + 1 && find[-2] == '\\')) {
-				++find;
-				continue;
-			}
+		if (out.len > 0 && out.data[out.len - 1] == '\\' &&
+				!(out.len > 1 && out.data[out.len - 2] == '\\')) {
+			success = success && var_buffer_append(&out, "$", 1);
+			rest = find + 1;
+			continue;
 		}
 		// Unescape double $ and move on
 		if (find[1] == '$') {
-			size_t length = strlen(find + 1);
-			memmove(find, find + 1, length);
-			find[length] = '\0';
-			++find;
+			success = success && var_buffer_append(&out, "$", 1);
+			rest = find + 2;
 			continue;
 		}
-		// Find matching variable
-		for (i = 0; i < config->symbols->length; ++i) {
-			struct sway_variable *var = config->symbols->items[i];
-			int vnlen = strlen(var->name);
-			if (strncmp(find, var->name, vnlen) == 0) {
-				int vvlen = strlen(var->value);
-				char *newstr = malloc(strlen(str) - vnlen + vvlen + 1);
-				if (!newstr) {
-					sway_log(SWAY_ERROR,
-						"Unable to allocate replacement "
-						"during variable expansion");
-					break;
-				}
-				char *newptr = newstr;
-				int offset = find - str;
-				strncpy(newptr, str, offset);
-				newptr += offset;
-				strncpy(newptr, var->value, vvlen);
-				newptr += vvlen;
-				strcpy(newptr, find + vnlen);
-				free(str);
-				str = newstr;
-				find = str + offset + vvlen;
-				break;
-			}
-		}
-		if (i == config->symbols->length) {
-			++find;
+		// Find the longest matching variable
+		struct sway_variable *var =
+			variable_trie_match(config->symbol_trie, find);
+		if (var) {
+			success = success &&
+				var_buffer_append(&out, var->value, strlen(var->value));
+			rest = find + strlen(var->name);
+		} else {
+			success = success && var_buffer_append(&out, "$", 1);
+			rest = find + 1;
 		}
 	}
-	return str;
+	success = success && var_buffer_append(&out, rest, strlen(rest) + 1);
+	if (!success) {
+		sway_log(SWAY_ERROR,
+			"Unable to allocate replacement during variable expansion");
+		free(out.data);
+		return str;
+	}
+	free(str);
+	return out.data;
 }
 
 // the naming is intentional (albeit long): a workspace_output_cmp function
@@ -1032,6 +1084,8 @@ void translate_keysyms(struct input_config *input_config) {
 
 		list_free(mode->keysym_bindings);
 		list_free(mode->keycode_bindings);
+		binding_index_invalidate(&mode->keysym_index);
+		binding_index_invalidate(&mode->keycode_index);
 
 		mode->keysym_bindings = bindsyms;
 		mode->keycode_bindings = bindcodes;
@@ -269,3 +269,15 @@ void load_swaybars(void) {
 		load_swaybar(bar);
 	}
 }
+
+void bar_config_reuse_client(struct bar_config *bar, struct bar_config *old) {
+	if (!old->client) {
+		return;
+	}
+	bar->client = old->client;
+	old->client = NULL;
+	wl_list_remove(&old->client_destroy.link);
+	wl_list_init(&old->client_destroy.link);
+	bar->client_destroy.notify = handle_swaybar_client_destroy;
+	wl_client_add_destroy_listener(bar->client, &bar->client_destroy);
+}
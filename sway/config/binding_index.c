@@ -0,0 +1,155 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "sway/config.h"
+#include "list.h"
+#include "log.h"
+
+static uint32_t hash_begin(uint32_t modifiers, bool release) {
+	uint32_t hash = 2166136261u; // FNV-1a
+	hash = (hash ^ modifiers) * 16777619u;
+	return (hash ^ release) * 16777619u;
+}
+
+static uint32_t hash_add(uint32_t hash, uint32_t key) {
+	return (hash ^ key) * 16777619u;
+}
+
+static uint32_t hash_key(uint32_t modifiers, bool release,
+		const uint32_t *keys, size_t nkeys) {
+	uint32_t hash = hash_begin(modifiers, release);
+	for (size_t i = 0; i < nkeys; ++i) {
+		hash = hash_add(hash, keys[i]);
+	}
+	return hash;
+}
+
+static bool slot_matches(const struct binding_index_slot *slot,
+		uint32_t hash, uint32_t modifiers, bool release,
+		const uint32_t *keys, size_t nkeys) {
+	if (slot->hash != hash || slot->modifiers != modifiers ||
+			slot->release != release ||
+			(size_t)slot->keys->length != nkeys) {
+		return false;
+	}
+	for (size_t i = 0; i < nkeys; ++i) {
+		if (*(uint32_t *)slot->keys->items[i] != keys[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static struct binding_index_slot *find_slot(struct sway_binding_index *index,
+		uint32_t hash, uint32_t modifiers, bool release,
+		const uint32_t *keys, size_t nkeys) {
+	struct binding_index_slot *slot =
+		index->buckets[hash & (index->nbuckets - 1)];
+	for (; slot; slot = slot->next) {
+		if (slot_matches(slot, hash, modifiers, release, keys, nkeys)) {
+			return slot;
+		}
+	}
+	return NULL;
+}
+
+static bool index_binding(struct sway_binding_index *index,
+		struct sway_binding *binding, int position) {
+	bool release = binding->flags & BINDING_RELEASE;
+	// Look the binding up the same way as pressed keys are
+	size_t nkeys = binding->keys->length;
+	uint32_t *keys = malloc((nkeys ? nkeys : 1) * sizeof(uint32_t));
+	if (!keys) {
+		return false;
+	}
+	for (size_t i = 0; i < nkeys; ++i) {
+		keys[i] = *(uint32_t *)binding->keys->items[i];
+	}
+	uint32_t hash = hash_key(binding->modifiers, release, keys, nkeys);
+	struct binding_index_slot *slot = find_slot(index, hash,
+			binding->modifiers, release, keys, nkeys);
+	free(keys);
+
+	if (!slot) {
+		size_t bucket = hash & (index->nbuckets - 1);
+		slot = calloc(1, sizeof(struct binding_index_slot));
+		if (!slot) {
+			return false;
+		}
+		slot->hash = hash;
+		slot->modifiers = binding->modifiers;
+		slot->release = release;
+		slot->keys = binding->keys;
+		slot->next = index->buckets[bucket];
+		index->buckets[bucket] = slot;
+	}
+
+	if (slot->len == slot->cap) {
+		int cap = slot->cap ? slot->cap * 2 : 2;
+		struct binding_index_match *matches = realloc(slot->matches,
+				cap * sizeof(struct binding_index_match));
+		if (!matches) {
+			return false;
+		}
+		slot->matches = matches;
+		slot->cap = cap;
+	}
+	slot->matches[slot->len++] = (struct binding_index_match){
+		.binding = binding,
+		.position = position,
+	};
+	return true;
+}
+
+static bool binding_index_build(struct sway_binding_index *index,
+		list_t *bindings) {
+	size_t nbuckets = 16;
+	while (nbuckets < (size_t)bindings->length) {
+		nbuckets *= 2;
+	}
+	index->buckets = calloc(nbuckets, sizeof(struct binding_index_slot *));
+	if (!index->buckets) {
+		return false;
+	}
+	index->nbuckets = nbuckets;
+	index->bindings = bindings;
+
+	for (int i = 0; i < bindings->length; ++i) {
+		if (!index_binding(index, bindings->items[i], i)) {
+			binding_index_invalidate(index);
+			return false;
+		}
+	}
+	return true;
+}
+
+void binding_index_invalidate(struct sway_binding_index *index) {
+	for (size_t i = 0; i < index->nbuckets; ++i) {
+		struct binding_index_slot *slot = index->buckets[i];
+		while (slot) {
+			struct binding_index_slot *next = slot->next;
+			free(slot->matches);
+			free(slot);
+			slot = next;
+		}
+	}
+	free(index->buckets);
+	index->buckets = NULL;
+	index->nbuckets = 0;
+	index->bindings = NULL;
+}
+
+const struct binding_index_slot *binding_index_find(
+		struct sway_binding_index *index, list_t *bindings,
+		uint32_t modifiers, bool release, const uint32_t *keys, size_t nkeys) {
+	if (index->bindings != bindings) {
+		binding_index_invalidate(index);
+		if (!binding_index_build(index, bindings)) {
+			sway_log(SWAY_ERROR, "Unable to allocate binding index");
+			return NULL;
+		}
+	}
+	uint32_t hash = hash_key(modifiers, release, keys, nkeys);
+	return find_slot(index, hash, modifiers, release, keys, nkeys);
+}
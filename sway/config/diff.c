@@ -0,0 +1,306 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdbool.h>
+#include <string.h>
+#include <json.h>
+#include "sway/config.h"
+#include "sway/ipc-json.h"
+#include "list.h"
+#include "log.h"
+
+static bool str_equal(const char *a, const char *b) {
+	return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+static bool str_list_equal(list_t *a, list_t *b) {
+	int a_len = a ? a->length : 0;
+	int b_len = b ? b->length : 0;
+	if (a_len != b_len) {
+		return false;
+	}
+	for (int i = 0; i < a_len; ++i) {
+		if (!str_equal(a->items[i], b->items[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool fonts_equal(struct sway_config *old, struct sway_config *new) {
+	return str_equal(old->font, new->font)
+		&& old->pango_markup == new->pango_markup
+		&& old->titlebar_border_thickness == new->titlebar_border_thickness
+		&& old->titlebar_h_padding == new->titlebar_h_padding
+		&& old->titlebar_v_padding == new->titlebar_v_padding;
+}
+
+static bool colors_equal(struct sway_config *old, struct sway_config *new) {
+	return memcmp(&old->border_colors, &new->border_colors,
+			sizeof(old->border_colors)) == 0
+		&& old->show_marks == new->show_marks
+		&& old->title_align == new->title_align;
+}
+
+static bool workspace_config_equal(struct workspace_config *a,
+		struct workspace_config *b) {
+	return str_equal(a->workspace, b->workspace)
+		&& a->gaps_inner == b->gaps_inner
+		&& memcmp(&a->gaps_outer, &b->gaps_outer, sizeof(a->gaps_outer)) == 0
+		&& str_list_equal(a->outputs, b->outputs);
+}
+
+static bool gaps_equal(struct sway_config *old, struct sway_config *new) {
+	if (old->smart_gaps != new->smart_gaps
+			|| old->gaps_inner != new->gaps_inner
+			|| memcmp(&old->gaps_outer, &new->gaps_outer,
+				sizeof(old->gaps_outer)) != 0
+			|| old->hide_edge_borders != new->hide_edge_borders
+			|| old->hide_edge_borders_smart != new->hide_edge_borders_smart
+			|| old->hide_lone_tab != new->hide_lone_tab
+			|| old->workspace_configs->length !=
+				new->workspace_configs->length) {
+		return false;
+	}
+	for (int i = 0; i < old->workspace_configs->length; ++i) {
+		if (!workspace_config_equal(old->workspace_configs->items[i],
+					new->workspace_configs->items[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool binding_equal(struct sway_binding *a, struct sway_binding *b) {
+	if (a->type != b->type || a->flags != b->flags
+			|| a->modifiers != b->modifiers || a->group != b->group
+			|| a->input != b->input // interned
+			|| a->keys->length != b->keys->length
+			|| !str_equal(a->command, b->command)) {
+		return false;
+	}
+	for (int i = 0; i < a->keys->length; ++i) {
+		if (*(uint32_t *)a->keys->items[i] != *(uint32_t *)b->keys->items[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool binding_list_equal(list_t *a, list_t *b) {
+	if (a->length != b->length) {
+		return false;
+	}
+	for (int i = 0; i < a->length; ++i) {
+		if (!binding_equal(a->items[i], b->items[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool switch_binding_list_equal(list_t *a, list_t *b) {
+	if (a->length != b->length) {
+		return false;
+	}
+	for (int i = 0; i < a->length; ++i) {
+		struct sway_switch_binding *x = a->items[i], *y = b->items[i];
+		if (x->type != y->type || x->state != y->state
+				|| x->flags != y->flags || !str_equal(x->command, y->command)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool bindings_equal(struct sway_config *old, struct sway_config *new) {
+	if (old->modes->length != new->modes->length
+			|| old->floating_mod != new->floating_mod
+			|| old->floating_mod_inverse != new->floating_mod_inverse) {
+		return false;
+	}
+	for (int i = 0; i < old->modes->length; ++i) {
+		struct sway_mode *a = old->modes->items[i], *b = new->modes->items[i];
+		if (!str_equal(a->name, b->name) || a->pango != b->pango
+				|| !binding_list_equal(a->keysym_bindings, b->keysym_bindings)
+				|| !binding_list_equal(a->keycode_bindings, b->keycode_bindings)
+				|| !binding_list_equal(a->mouse_bindings, b->mouse_bindings)
+				|| !switch_binding_list_equal(a->switch_bindings,
+					b->switch_bindings)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool box_equal(const struct wlr_box *a, const struct wlr_box *b) {
+	return a == b || (a && b && memcmp(a, b, sizeof(*a)) == 0);
+}
+
+static bool input_config_equal(struct input_config *a, struct input_config *b) {
+	bool regions_equal = a->mapped_from_region == b->mapped_from_region ||
+		(a->mapped_from_region && b->mapped_from_region &&
+		 memcmp(a->mapped_from_region, b->mapped_from_region,
+			 sizeof(*a->mapped_from_region)) == 0);
+	return str_equal(a->identifier, b->identifier)
+		&& str_equal(a->input_type, b->input_type)
+		&& a->accel_profile == b->accel_profile
+		&& memcmp(&a->calibration_matrix, &b->calibration_matrix,
+			sizeof(a->calibration_matrix)) == 0
+		&& a->click_method == b->click_method
+		&& a->drag == b->drag
+		&& a->drag_lock == b->drag_lock
+		&& a->dwt == b->dwt
+		&& a->left_handed == b->left_handed
+		&& a->middle_emulation == b->middle_emulation
+		&& a->natural_scroll == b->natural_scroll
+		&& a->pointer_accel == b->pointer_accel
+		&& a->scroll_factor == b->scroll_factor
+		&& a->repeat_delay == b->repeat_delay
+		&& a->repeat_rate == b->repeat_rate
+		&& a->scroll_button == b->scroll_button
+		&& a->scroll_method == b->scroll_method
+		&& a->send_events == b->send_events
+		&& a->tap == b->tap
+		&& a->tap_button_map == b->tap_button_map
+		&& str_equal(a->xkb_layout, b->xkb_layout)
+		&& str_equal(a->xkb_model, b->xkb_model)
+		&& str_equal(a->xkb_options, b->xkb_options)
+		&& str_equal(a->xkb_rules, b->xkb_rules)
+		&& str_equal(a->xkb_variant, b->xkb_variant)
+		&& str_equal(a->xkb_file, b->xkb_file)
+		&& a->xkb_file_is_set == b->xkb_file_is_set
+		&& a->xkb_numlock == b->xkb_numlock
+		&& a->xkb_capslock == b->xkb_capslock
+		&& regions_equal
+		&& a->mapped_to == b->mapped_to
+		&& str_equal(a->mapped_to_output, b->mapped_to_output)
+		&& box_equal(a->mapped_to_region, b->mapped_to_region)
+		&& a->capturable == b->capturable
+		&& box_equal(&a->region, &b->region);
+}
+
+static bool input_config_list_equal(list_t *a, list_t *b) {
+	if (a->length != b->length) {
+		return false;
+	}
+	for (int i = 0; i < a->length; ++i) {
+		if (!input_config_equal(a->items[i], b->items[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool output_config_equal(struct output_config *a,
+		struct output_config *b) {
+	return str_equal(a->name, b->name)
+		&& a->enabled == b->enabled
+		&& a->width == b->width
+		&& a->height == b->height
+		&& a->refresh_rate == b->refresh_rate
+		&& a->custom_mode == b->custom_mode
+		&& a->x == b->x
+		&& a->y == b->y
+		&& a->scale == b->scale
+		&& a->scale_filter == b->scale_filter
+		&& a->transform == b->transform
+		&& a->subpixel == b->subpixel
+		&& a->max_render_time == b->max_render_time
+		&& a->adaptive_sync == b->adaptive_sync
+		&& str_equal(a->background, b->background)
+		&& str_equal(a->background_option, b->background_option)
+		&& str_equal(a->background_fallback, b->background_fallback)
+		&& a->dpms_state == b->dpms_state;
+}
+
+static bool outputs_equal(struct sway_config *old, struct sway_config *new) {
+	if (old->output_configs->length != new->output_configs->length) {
+		return false;
+	}
+	for (int i = 0; i < old->output_configs->length; ++i) {
+		if (!output_config_equal(old->output_configs->items[i],
+					new->output_configs->items[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static struct bar_config *find_bar(struct sway_config *config, const char *id) {
+	for (int i = 0; i < config->bars->length; ++i) {
+		struct bar_config *bar = config->bars->items[i];
+		if (strcmp(bar->id, id) == 0) {
+			return bar;
+		}
+	}
+	return NULL;
+}
+
+static bool bar_config_equal(struct bar_config *a, struct bar_config *b) {
+	if (!str_equal(a->swaybar_command, b->swaybar_command)) {
+		return false;
+	}
+	// The IPC description has everything swaybar gets to know
+	json_object *a_json = ipc_json_describe_bar_config(a);
+	json_object *b_json = ipc_json_describe_bar_config(b);
+	bool equal = json_object_equal(a_json, b_json);
+	json_object_put(a_json);
+	json_object_put(b_json);
+	return equal;
+}
+
+/**
+ * Keep the swaybars of unchanged bars running. Returns whether any bar was
+ * added, removed or changed.
+ */
+static bool diff_bars(struct sway_config *old, struct sway_config *new) {
+	bool changed = old->bars->length != new->bars->length;
+	for (int i = 0; i < new->bars->length; ++i) {
+		struct bar_config *bar = new->bars->items[i];
+		struct bar_config *old_bar = find_bar(old, bar->id);
+		if (old_bar && old_bar->client && bar_config_equal(old_bar, bar)) {
+			bar_config_reuse_client(bar, old_bar);
+		} else {
+			changed = true;
+		}
+	}
+	return changed;
+}
+
+uint32_t config_diff(struct sway_config *old, struct sway_config *new) {
+	uint32_t changes = 0;
+	if (!fonts_equal(old, new)) {
+		changes |= CONFIG_CHANGE_FONT;
+	}
+	if (!colors_equal(old, new)) {
+		changes |= CONFIG_CHANGE_COLORS;
+	}
+	if (!gaps_equal(old, new)) {
+		changes |= CONFIG_CHANGE_GAPS;
+	}
+	if (!bindings_equal(old, new)) {
+		changes |= CONFIG_CHANGE_BINDINGS;
+	}
+	if (!input_config_list_equal(old->input_configs, new->input_configs) ||
+			!input_config_list_equal(old->input_type_configs,
+				new->input_type_configs)) {
+		changes |= CONFIG_CHANGE_INPUTS;
+	}
+	if (!outputs_equal(old, new) ||
+			!str_equal(old->swaybg_command, new->swaybg_command)) {
+		changes |= CONFIG_CHANGE_OUTPUTS;
+	}
+	if (diff_bars(old, new)) {
+		changes |= CONFIG_CHANGE_BARS;
+	}
+
+	sway_log(SWAY_DEBUG, "Config changes:%s%s%s%s%s%s%s%s",
+			changes & CONFIG_CHANGE_FONT ? " font" : "",
+			changes & CONFIG_CHANGE_COLORS ? " colors" : "",
+			changes & CONFIG_CHANGE_GAPS ? " gaps" : "",
+			changes & CONFIG_CHANGE_BINDINGS ? " bindings" : "",
+			changes & CONFIG_CHANGE_INPUTS ? " inputs" : "",
+			changes & CONFIG_CHANGE_OUTPUTS ? " outputs" : "",
+			changes & CONFIG_CHANGE_BARS ? " bars" : "",
+			changes ? "" : " none");
+	return changes;
+}
@@ -470,9 +470,15 @@ bool apply_output_config(struct output_config *oc, struct sway_output *output) {
 		output_enable(output);
 	}
 
-	if (oc && oc->max_render_time >= 0) {
+	if (oc && oc->max_render_time == MAX_RENDER_TIME_AUTO) {
+		sway_log(SWAY_DEBUG, "Set %s max render time to auto", oc->name);
+		output->max_render_time_auto = true;
+		output->max_render_time = 0;
+		output->max_render_time_backoff = 0;
+	} else if (oc && oc->max_render_time >= 0) {
 		sway_log(SWAY_DEBUG, "Set %s max render time to %d",
 			oc->name, oc->max_render_time);
+		output->max_render_time_auto = false;
 		output->max_render_time = oc->max_render_time;
 	}
 
@@ -732,6 +738,19 @@ static bool _spawn_swaybg(char **command) {
 	return true;
 }
 
+void swaybg_reuse_client(struct sway_config *new, struct sway_config *old) {
+	if (!old->swaybg_client) {
+		return;
+	}
+	new->swaybg_client = old->swaybg_client;
+	old->swaybg_client = NULL;
+	wl_list_remove(&old->swaybg_client_destroy.link);
+	wl_list_init(&old->swaybg_client_destroy.link);
+	new->swaybg_client_destroy.notify = handle_swaybg_client_destroy;
+	wl_client_add_destroy_listener(new->swaybg_client,
+		&new->swaybg_client_destroy);
+}
+
 bool spawn_swaybg(void) {
 	if (!config->swaybg_command) {
 		return true;
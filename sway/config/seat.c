@@ -31,6 +31,7 @@ struct seat_config *new_seat_config(const char* name) {
 	seat->hide_cursor_timeout = -1;
 	seat->allow_constrain = CONSTRAIN_DEFAULT;
 	seat->shortcuts_inhibit = SHORTCUTS_INHIBIT_DEFAULT;
+	seat->coalesce_motion = COALESCE_MOTION_DEFAULT;
 	seat->keyboard_grouping = KEYBOARD_GROUP_DEFAULT;
 	seat->xcursor_theme.name = NULL;
 	seat->xcursor_theme.size = 24;
@@ -159,6 +160,10 @@ void merge_seat_config(struct seat_config *dest, struct seat_config *source) {
 		dest->shortcuts_inhibit = source->shortcuts_inhibit;
 	}
 
+	if (source->coalesce_motion != COALESCE_MOTION_DEFAULT) {
+		dest->coalesce_motion = source->coalesce_motion;
+	}
+
 	if (source->keyboard_grouping != KEYBOARD_GROUP_DEFAULT) {
 		dest->keyboard_grouping = source->keyboard_grouping;
 	}
@@ -0,0 +1,71 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdbool.h>
+#include <stdlib.h>
+#include "sway/config.h"
+
+static struct sway_variable_trie *find_child(struct sway_variable_trie *node,
+		char c) {
+	struct sway_variable_trie *child = node->child;
+	for (; child && child->c < c; child = child->next) {
+		// siblings are sorted
+	}
+	return child && child->c == c ? child : NULL;
+}
+
+bool variable_trie_insert(struct sway_variable_trie **trie,
+		struct sway_variable *var) {
+	if (!*trie && !(*trie = calloc(1, sizeof(struct sway_variable_trie)))) {
+		return false;
+	}
+	struct sway_variable_trie *node = *trie;
+	for (const char *p = var->name; *p; ++p) {
+		struct sway_variable_trie **link = &node->child;
+		while (*link && (*link)->c < *p) {
+			link = &(*link)->next;
+		}
+		if (!*link || (*link)->c != *p) {
+			struct sway_variable_trie *child =
+				calloc(1, sizeof(struct sway_variable_trie));
+			if (!child) {
+				return false;
+			}
+			child->c = *p;
+			child->next = *link;
+			*link = child;
+		}
+		node = *link;
+	}
+	node->var = var;
+	return true;
+}
+
+struct sway_variable *variable_trie_find(struct sway_variable_trie *trie,
+		const char *name) {
+	struct sway_variable_trie *node = trie;
+	for (const char *p = name; node && *p; ++p) {
+		node = find_child(node, *p);
+	}
+	return node ? node->var : NULL;
+}
+
+struct sway_variable *variable_trie_match(struct sway_variable_trie *trie,
+		const char *str) {
+	struct sway_variable *match = NULL;
+	struct sway_variable_trie *node = trie;
+	for (const char *p = str; node && *p; ++p) {
+		node = find_child(node, *p);
+		if (node && node->var) {
+			match = node->var;
+		}
+	}
+	return match;
+}
+
+void variable_trie_destroy(struct sway_variable_trie *trie) {
+	while (trie) {
+		struct sway_variable_trie *next = trie->next;
+		variable_trie_destroy(trie->child);
+		free(trie);
+		trie = next;
+	}
+}
@@ -2,8 +2,10 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
 #include <strings.h>
 #include <pcre.h>
+#include "sway/commands.h"
 #include "sway/criteria.h"
 #include "sway/tree/container.h"
 #include "sway/config.h"
@@ -40,7 +42,7 @@ bool criteria_is_empty(struct criteria *criteria) {
 char *error = NULL;
 
 // Returns error string on failure or NULL otherwise.
-static bool generate_regex(pcre **regex, char *value) {
+static bool generate_regex(pcre **regex, pcre_extra **extra, char *value) {
 	const char *reg_err;
 	int offset;
 
@@ -54,9 +56,34 @@ static bool generate_regex(pcre **regex, char *value) {
 		return false;
 	}
 
+	// Failing to study only loses the speedup
+	*extra = pcre_study(*regex, PCRE_STUDY_JIT_COMPILE, &reg_err);
+	if (reg_err) {
+		sway_log(SWAY_DEBUG, "Unable to study regex '%s': %s", value, reg_err);
+	}
 	return true;
 }
 
+/**
+ * Return the text matched by a regex without special characters, or NULL if
+ * it has any. A leading ^ together with a trailing $ is allowed and makes the
+ * literal anchored.
+ */
+static char *regex_literal(const char *value, bool *anchored) {
+	size_t len = strlen(value);
+	*anchored = len >= 2 && value[0] == '^' && value[len - 1] == '$';
+	if (*anchored) {
+		++value;
+		len -= 2;
+	}
+	for (size_t i = 0; i < len; ++i) {
+		if (strchr("\\^$.[|()?*+{", value[i])) {
+			return NULL;
+		}
+	}
+	return strndup(value, len);
+}
+
 static bool pattern_create(struct pattern **pattern, char *value) {
 	*pattern = calloc(1, sizeof(struct pattern));
 	if (!*pattern) {
@@ -67,7 +94,9 @@ static bool pattern_create(struct pattern **pattern, char *value) {
 		(*pattern)->match_type = PATTERN_FOCUSED;
 	} else {
 		(*pattern)->match_type = PATTERN_PCRE;
-		if (!generate_regex(&(*pattern)->regex, value)) {
+		(*pattern)->literal = regex_literal(value, &(*pattern)->anchored);
+		if (!(*pattern)->literal && !generate_regex(&(*pattern)->regex,
+					&(*pattern)->regex_extra, value)) {
 			return false;
 		};
 	}
@@ -76,9 +105,13 @@ static bool pattern_create(struct pattern **pattern, char *value) {
 
 static void pattern_destroy(struct pattern *pattern) {
 	if (pattern) {
+		if (pattern->regex_extra) {
+			pcre_free_study(pattern->regex_extra);
+		}
 		if (pattern->regex) {
 			pcre_free(pattern->regex);
 		}
+		free(pattern->literal);
 		free(pattern);
 	}
 }
@@ -93,14 +126,92 @@ void criteria_destroy(struct criteria *criteria) {
 	pattern_destroy(criteria->window_role);
 #endif
 	pattern_destroy(criteria->con_mark);
-	free(criteria->workspace);
+	pattern_destroy(criteria->workspace);
 	free(criteria->cmdlist);
+	cmd_program_unref(criteria->program);
 	free(criteria->raw);
 	free(criteria);
 }
 
-static int regex_cmp(const char *item, const pcre *regex) {
-	return pcre_exec(regex, NULL, item, strlen(item), 0, 0, NULL, 0);
+// Like $ in a regex, anchored literals may be followed by a final newline
+static bool anchored_len(const char *item, size_t len, size_t literal_len) {
+	return len == literal_len ||
+		(len == literal_len + 1 && item[literal_len] == '\n');
+}
+
+static bool pattern_matches(const struct pattern *pattern, const char *item) {
+	if (pattern->literal) {
+		if (!pattern->anchored) {
+			return strstr(item, pattern->literal) != NULL;
+		}
+		size_t literal_len = strlen(pattern->literal);
+		return strncmp(item, pattern->literal, literal_len) == 0 &&
+			anchored_len(item, strlen(item), literal_len);
+	}
+	return pcre_exec(pattern->regex, pattern->regex_extra,
+			item, strlen(item), 0, 0, NULL, 0) >= 0;
+}
+
+/**
+ * The string attributes of a view which criteria can match. These only change
+ * together with a call to criteria_invalidate_view.
+ */
+enum criteria_attribute {
+	CA_APP_ID,
+#if HAVE_XWAYLAND
+	CA_CLASS,
+	CA_INSTANCE,
+	CA_WINDOW_ROLE,
+#endif
+	CA_SHELL,
+	CA_TITLE,
+	CA_COUNT,
+};
+
+static struct pattern *criteria_attribute_pattern(struct criteria *criteria,
+		enum criteria_attribute attr) {
+	switch (attr) {
+	case CA_APP_ID:
+		return criteria->app_id;
+#if HAVE_XWAYLAND
+	case CA_CLASS:
+		return criteria->class;
+	case CA_INSTANCE:
+		return criteria->instance;
+	case CA_WINDOW_ROLE:
+		return criteria->window_role;
+#endif
+	case CA_SHELL:
+		return criteria->shell;
+	case CA_TITLE:
+		return criteria->title;
+	case CA_COUNT:
+		break;
+	}
+	return NULL;
+}
+
+static const char *view_attribute(struct sway_view *view,
+		enum criteria_attribute attr) {
+	switch (attr) {
+	case CA_APP_ID:
+		return view_get_app_id(view);
+#if HAVE_XWAYLAND
+	case CA_CLASS:
+		return view_get_class(view);
+	case CA_INSTANCE:
+		return view_get_instance(view);
+	case CA_WINDOW_ROLE:
+		return view_get_window_role(view);
+#endif
+	case CA_SHELL:
+		return view_get_shell(view);
+	case CA_TITLE:
+		return view_get_title(view);
+	case CA_COUNT:
+		break;
+	}
+	return NULL;
 }
 
 #if HAVE_XWAYLAND
@@ -151,11 +262,17 @@ static bool has_container_criteria(struct criteria *criteria) {
 
 static bool criteria_matches_container(struct criteria *criteria,
 		struct sway_container *container) {
+	if (criteria->con_id) { // Internal ID
+		if (container->node.id != criteria->con_id) {
+			return false;
+		}
+	}
+
 	if (criteria->con_mark) {
 		bool exists = false;
 		struct sway_container *con = container;
 		for (int i = 0; i < con->marks->length; ++i) {
-			if (regex_cmp(con->marks->items[i], criteria->con_mark->regex) == 0) {
+			if (pattern_matches(criteria->con_mark, con->marks->items[i])) {
 				exists = true;
 				break;
 			}
@@ -165,172 +282,113 @@ static bool criteria_matches_container(struct criteria *criteria,
 		}
 	}
 
-	if (criteria->con_id) { // Internal ID
-		if (container->node.id != criteria->con_id) {
-			return false;
-		}
-	}
-
 	return true;
 }
 
-static bool criteria_matches_view(struct criteria *criteria,
+/**
+ * Match the parts of the criteria which only depend on the view's attributes,
+ * so that the result can be cached until they change. Patterns which compare
+ * with the focused view are left to criteria_matches_view_state.
+ */
+static bool criteria_matches_view_attributes(struct criteria *criteria,
 		struct sway_view *view) {
-	struct sway_seat *seat = input_manager_current_seat();
-	struct sway_container *focus = seat_get_focused_container(seat);
-	struct sway_view *focused = focus ? focus->view : NULL;
-
-	if (criteria->title) {
-		const char *title = view_get_title(view);
-		if (!title) {
+	if (criteria->pid) {
+		if (criteria->pid != view->pid) {
 			return false;
 		}
-
-		switch (criteria->title->match_type) {
-		case PATTERN_FOCUSED:
-			if (focused && strcmp(title, view_get_title(focused))) {
-				return false;
-			}
-			break;
-		case PATTERN_PCRE:
-			if (regex_cmp(title, criteria->title->regex) != 0) {
-				return false;
-			}
-			break;
-		}
 	}
 
-	if (criteria->shell) {
-		const char *shell = view_get_shell(view);
-		if (!shell) {
+#if HAVE_XWAYLAND
+	if (criteria->id) { // X11 window ID
+		uint32_t x11_window_id = view_get_x11_window_id(view);
+		if (!x11_window_id || x11_window_id != criteria->id) {
 			return false;
 		}
+	}
 
-		switch (criteria->shell->match_type) {
-		case PATTERN_FOCUSED:
-			if (focused && strcmp(shell, view_get_shell(focused))) {
-				return false;
-			}
-			break;
-		case PATTERN_PCRE:
-			if (regex_cmp(shell, criteria->shell->regex) != 0) {
-				return false;
-			}
-			break;
+	if (criteria->window_type != ATOM_LAST) {
+		if (!view_has_window_type(view, criteria->window_type)) {
+			return false;
 		}
 	}
+#endif
 
-	if (criteria->app_id) {
-		const char *app_id = view_get_app_id(view);
-		if (!app_id) {
+	for (enum criteria_attribute attr = 0; attr < CA_COUNT; ++attr) {
+		struct pattern *pattern = criteria_attribute_pattern(criteria, attr);
+		if (!pattern) {
+			continue;
+		}
+		const char *value = view_attribute(view, attr);
+		if (!value) {
 			return false;
 		}
-
-		switch (criteria->app_id->match_type) {
-		case PATTERN_FOCUSED:
-			if (focused && strcmp(app_id, view_get_app_id(focused))) {
-				return false;
-			}
-			break;
-		case PATTERN_PCRE:
-			if (regex_cmp(app_id, criteria->app_id->regex) != 0) {
-				return false;
-			}
-			break;
+		if (pattern->match_type == PATTERN_PCRE &&
+				!pattern_matches(pattern, value)) {
+			return false;
 		}
 	}
 
+	return true;
+}
+
+static bool criteria_matches_view_state(struct criteria *criteria,
+		struct sway_view *view) {
 	if (!criteria_matches_container(criteria, view->container)) {
 		return false;
 	}
 
-#if HAVE_XWAYLAND
-	if (criteria->id) { // X11 window ID
-		uint32_t x11_window_id = view_get_x11_window_id(view);
-		if (!x11_window_id || x11_window_id != criteria->id) {
+	if (criteria->floating) {
+		if (!container_is_floating(view->container)) {
 			return false;
 		}
 	}
 
-	if (criteria->class) {
-		const char *class = view_get_class(view);
-		if (!class) {
+	if (criteria->tiling) {
+		if (container_is_floating(view->container)) {
 			return false;
 		}
-
-		switch (criteria->class->match_type) {
-		case PATTERN_FOCUSED:
-			if (focused && strcmp(class, view_get_class(focused))) {
-				return false;
-			}
-			break;
-		case PATTERN_PCRE:
-			if (regex_cmp(class, criteria->class->regex) != 0) {
-				return false;
-			}
-			break;
-		}
 	}
 
-	if (criteria->instance) {
-		const char *instance = view_get_instance(view);
-		if (!instance) {
-			return false;
-		}
+	struct sway_seat *seat = input_manager_current_seat();
+	struct sway_container *focus = seat_get_focused_container(seat);
+	struct sway_view *focused = focus ? focus->view : NULL;
 
-		switch (criteria->instance->match_type) {
-		case PATTERN_FOCUSED:
-			if (focused && strcmp(instance, view_get_instance(focused))) {
-				return false;
+	if (focused) {
+		for (enum criteria_attribute attr = 0; attr < CA_COUNT; ++attr) {
+			struct pattern *pattern =
+				criteria_attribute_pattern(criteria, attr);
+			if (!pattern || pattern->match_type != PATTERN_FOCUSED) {
+				continue;
 			}
-			break;
-		case PATTERN_PCRE:
-			if (regex_cmp(instance, criteria->instance->regex) != 0) {
+			const char *focused_value = view_attribute(focused, attr);
+			if (!focused_value ||
+					strcmp(view_attribute(view, attr), focused_value)) {
 				return false;
 			}
-			break;
 		}
 	}
 
-	if (criteria->window_role) {
-		const char *window_role = view_get_window_role(view);
-		if (!window_role) {
+	if (criteria->workspace) {
+		struct sway_workspace *ws = view->container->workspace;
+		if (!ws) {
 			return false;
 		}
 
-		switch (criteria->window_role->match_type) {
+		switch (criteria->workspace->match_type) {
 		case PATTERN_FOCUSED:
-			if (focused && strcmp(window_role, view_get_window_role(focused))) {
+			if (focused &&
+					strcmp(ws->name, focused->container->workspace->name)) {
 				return false;
 			}
 			break;
 		case PATTERN_PCRE:
-			if (regex_cmp(window_role, criteria->window_role->regex) != 0) {
+			if (!pattern_matches(criteria->workspace, ws->name)) {
 				return false;
 			}
 			break;
 		}
 	}
 
-	if (criteria->window_type != ATOM_LAST) {
-		if (!view_has_window_type(view, criteria->window_type)) {
-			return false;
-		}
-	}
-#endif
-
-	if (criteria->floating) {
-		if (!container_is_floating(view->container)) {
-			return false;
-		}
-	}
-
-	if (criteria->tiling) {
-		if (container_is_floating(view->container)) {
-			return false;
-		}
-	}
-
 	if (criteria->urgent) {
 		if (!view_is_urgent(view)) {
 			return false;
@@ -350,42 +408,230 @@ static bool criteria_matches_view(struct criteria *criteria,
 		}
 	}
 
-	if (criteria->workspace) {
-		struct sway_workspace *ws = view->container->workspace;
-		if (!ws) {
-			return false;
-		}
+	return true;
+}
 
-		switch (criteria->workspace->match_type) {
-		case PATTERN_FOCUSED:
-			if (focused &&
-					strcmp(ws->name, focused->container->workspace->name)) {
-				return false;
-			}
-			break;
-		case PATTERN_PCRE:
-			if (regex_cmp(ws->name, criteria->workspace->regex) != 0) {
-				return false;
+static bool criteria_matches_view(struct criteria *criteria,
+		struct sway_view *view) {
+	return criteria_matches_view_attributes(criteria, view) &&
+		criteria_matches_view_state(criteria, view);
+}
+
+/**
+ * An index of config->criteria by the attribute values they require. Criteria
+ * with an anchored literal pattern such as app_id="^firefox$" are only
+ * candidates for views with exactly that value, the others are always
+ * candidates.
+ *
+ * Criteria are only ever appended to the list until the config is freed, so
+ * the index is rebuilt whenever the length differs.
+ */
+struct criteria_index_entry {
+	uint32_t hash;
+	enum criteria_attribute attr;
+	const char *literal;
+	size_t literal_len;
+	int position; // in the criteria list
+	struct criteria_index_entry *next;
+};
+
+static struct {
+	list_t *criteria; // NULL if the index is invalid
+	int length;
+	uint32_t generation; // incremented on every rebuild
+	struct criteria_index_entry **buckets;
+	size_t nbuckets;
+	struct criteria_index_entry *entries;
+	int *unindexed;
+	int unindexed_len;
+	bool indexed[CA_COUNT]; // attributes with at least one entry
+} criteria_index;
+
+static uint32_t hash_attribute(enum criteria_attribute attr,
+		const char *value, size_t len) {
+	uint32_t hash = 2166136261u; // FNV-1a
+	hash = (hash ^ attr) * 16777619u;
+	for (size_t i = 0; i < len; ++i) {
+		hash = (hash ^ (unsigned char)value[i]) * 16777619u;
+	}
+	return hash;
+}
+
+static void criteria_index_invalidate(void) {
+	free(criteria_index.buckets);
+	free(criteria_index.entries);
+	free(criteria_index.unindexed);
+	criteria_index.buckets = NULL;
+	criteria_index.entries = NULL;
+	criteria_index.unindexed = NULL;
+	criteria_index.nbuckets = 0;
+	criteria_index.unindexed_len = 0;
+	criteria_index.criteria = NULL;
+	criteria_index.length = 0;
+	memset(criteria_index.indexed, 0, sizeof(criteria_index.indexed));
+}
+
+void criteria_list_destroyed(list_t *criteria) {
+	if (criteria_index.criteria == criteria) {
+		criteria_index_invalidate();
+	}
+}
+
+static bool criteria_index_build(list_t *criteria) {
+	size_t nbuckets = 16;
+	while (nbuckets < (size_t)criteria->length) {
+		nbuckets *= 2;
+	}
+	size_t length = criteria->length ? criteria->length : 1;
+	criteria_index.buckets =
+		calloc(nbuckets, sizeof(struct criteria_index_entry *));
+	criteria_index.entries =
+		calloc(length, sizeof(struct criteria_index_entry));
+	criteria_index.unindexed = calloc(length, sizeof(int));
+	if (!criteria_index.buckets || !criteria_index.entries ||
+			!criteria_index.unindexed) {
+		criteria_index_invalidate();
+		return false;
+	}
+	criteria_index.nbuckets = nbuckets;
+	criteria_index.criteria = criteria;
+	criteria_index.length = criteria->length;
+	++criteria_index.generation;
+
+	for (int i = 0; i < criteria->length; ++i) {
+		struct criteria *item = criteria->items[i];
+		struct pattern *pattern = NULL;
+		enum criteria_attribute attr;
+		for (attr = 0; attr < CA_COUNT; ++attr) {
+			pattern = criteria_attribute_pattern(item, attr);
+			if (pattern && pattern->literal && pattern->anchored) {
+				break;
 			}
-			break;
 		}
+		if (attr == CA_COUNT) {
+			criteria_index.unindexed[criteria_index.unindexed_len++] = i;
+			continue;
+		}
+		struct criteria_index_entry *entry = &criteria_index.entries[i];
+		entry->attr = attr;
+		entry->literal = pattern->literal;
+		entry->literal_len = strlen(pattern->literal);
+		entry->hash = hash_attribute(attr, entry->literal, entry->literal_len);
+		entry->position = i;
+		size_t bucket = entry->hash & (nbuckets - 1);
+		entry->next = criteria_index.buckets[bucket];
+		criteria_index.buckets[bucket] = entry;
+		criteria_index.indexed[attr] = true;
 	}
+	return true;
+}
 
-	if (criteria->pid) {
-		if (criteria->pid != view->pid) {
-			return false;
+static bool criteria_index_update(void) {
+	list_t *criteria = config->criteria;
+	if (criteria_index.criteria == criteria &&
+			criteria_index.length == criteria->length) {
+		return true;
+	}
+	criteria_index_invalidate();
+	if (!criteria_index_build(criteria)) {
+		sway_log(SWAY_ERROR, "Unable to allocate criteria index");
+		return false;
+	}
+	return true;
+}
+
+static void criteria_index_lookup(enum criteria_attribute attr,
+		const char *value, size_t len, int *positions, int *npositions) {
+	uint32_t hash = hash_attribute(attr, value, len);
+	struct criteria_index_entry *entry =
+		criteria_index.buckets[hash & (criteria_index.nbuckets - 1)];
+	for (; entry; entry = entry->next) {
+		if (entry->hash == hash && entry->attr == attr &&
+				entry->literal_len == len &&
+				memcmp(entry->literal, value, len) == 0) {
+			positions[(*npositions)++] = entry->position;
 		}
 	}
+}
+
+static int cmp_int(const void *a, const void *b) {
+	return *(const int *)a - *(const int *)b;
+}
 
+/**
+ * Update the view's list of criteria whose attribute part matches.
+ */
+static bool criteria_update_view(struct sway_view *view) {
+	view->attribute_criteria_generation = 0;
+	if (!view->attribute_criteria) {
+		view->attribute_criteria = create_list();
+	}
+	list_t *matches = view->attribute_criteria;
+	int length = criteria_index.length;
+	int *positions = malloc((length ? length : 1) * sizeof(int));
+	if (!matches || !positions) {
+		sway_log(SWAY_ERROR, "Unable to allocate criteria candidates");
+		free(positions);
+		return false;
+	}
+	matches->length = 0;
+	memcpy(positions, criteria_index.unindexed,
+			criteria_index.unindexed_len * sizeof(int));
+	int npositions = criteria_index.unindexed_len;
+	for (enum criteria_attribute attr = 0; attr < CA_COUNT; ++attr) {
+		const char *value;
+		if (!criteria_index.indexed[attr] ||
+				!(value = view_attribute(view, attr))) {
+			continue;
+		}
+		size_t len = strlen(value);
+		criteria_index_lookup(attr, value, len, positions, &npositions);
+		if (len > 0 && value[len - 1] == '\n') {
+			criteria_index_lookup(attr, value, len - 1,
+					positions, &npositions);
+		}
+	}
+	// Criteria have to be applied in config order
+	qsort(positions, npositions, sizeof(int), cmp_int);
+
+	list_t *criterias = criteria_index.criteria;
+	for (int i = 0; i < npositions; ++i) {
+		struct criteria *criteria = criterias->items[positions[i]];
+		if (criteria_matches_view_attributes(criteria, view)) {
+			list_add(matches, criteria);
+		}
+	}
+	free(positions);
+	view->attribute_criteria_generation = criteria_index.generation;
 	return true;
 }
 
+void criteria_invalidate_view(struct sway_view *view) {
+	view->attribute_criteria_generation = 0;
+}
+
 list_t *criteria_for_view(struct sway_view *view, enum criteria_type types) {
-	list_t *criterias = config->criteria;
 	list_t *matches = create_list();
-	for (int i = 0; i < criterias->length; ++i) {
-		struct criteria *criteria = criterias->items[i];
-		if ((criteria->type & types) && criteria_matches_view(criteria, view)) {
+	if (!criteria_index_update() ||
+			(view->attribute_criteria_generation != criteria_index.generation &&
+			 !criteria_update_view(view))) {
+		// Fall back to checking every criteria
+		list_t *criterias = config->criteria;
+		for (int i = 0; i < criterias->length; ++i) {
+			struct criteria *criteria = criterias->items[i];
+			if ((criteria->type & types) &&
+					criteria_matches_view(criteria, view)) {
+				list_add(matches, criteria);
+			}
+		}
+		return matches;
+	}
+
+	list_t *candidates = view->attribute_criteria;
+	for (int i = 0; i < candidates->length; ++i) {
+		struct criteria *criteria = candidates->items[i];
+		if ((criteria->type & types) &&
+				criteria_matches_view_state(criteria, view)) {
 			list_add(matches, criteria);
 		}
 	}
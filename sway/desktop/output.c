@@ -1,6 +1,8 @@
 #define _POSIX_C_SOURCE 200809L
 #include <assert.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <strings.h>
 #include <time.h>
 #include <wayland-server-core.h>
@@ -24,11 +26,13 @@
 #include "sway/output.h"
 #include "sway/server.h"
 #include "sway/surface.h"
+#include "sway/trace.h"
 #include "sway/tree/arrange.h"
 #include "sway/tree/container.h"
 #include "sway/tree/root.h"
 #include "sway/tree/view.h"
 #include "sway/tree/workspace.h"
+#include "util.h"
 
 struct sway_output *output_by_name_or_id(const char *name_or_id) {
 	for (int i = 0; i < root->outputs->length; ++i) {
@@ -495,102 +499,516 @@ static void count_surface_iterator(struct sway_output *output, struct sway_view
 	(*n)++;
 }
 
+static bool scan_out_reject(struct sway_output *output,
+		enum sway_scanout_rejection reason) {
+	++output->frame_stats.scanout_rejections[reason];
+	return false;
+}
+
+/**
+ * Commit the surface's buffer directly, n_surfaces being the number of
+ * surfaces which would have been rendered along with it.
+ */
+static bool scan_out_surface(struct sway_output *output,
+		struct wlr_surface *surface, size_t n_surfaces) {
+	struct wlr_output *wlr_output = output->wlr_output;
+
+	if (!wl_list_empty(&root->drag_icons)) {
+		return scan_out_reject(output, SCANOUT_REJECT_DRAG_ICONS);
+	}
+	if (n_surfaces != 1) {
+		return scan_out_reject(output, SCANOUT_REJECT_SURFACES);
+	}
+	if (surface->buffer == NULL) {
+		return scan_out_reject(output, SCANOUT_REJECT_NO_BUFFER);
+	}
+	if ((float)surface->current.scale != wlr_output->scale) {
+		return scan_out_reject(output, SCANOUT_REJECT_SCALE);
+	}
+	if (surface->current.transform != wlr_output->transform) {
+		return scan_out_reject(output, SCANOUT_REJECT_TRANSFORM);
+	}
+
+	wlr_presentation_surface_sampled_on_output(server.presentation, surface,
+		wlr_output);
+
+	wlr_output_attach_buffer(wlr_output, &surface->buffer->base);
+	if (!wlr_output_commit(wlr_output)) {
+		return scan_out_reject(output, SCANOUT_REJECT_COMMIT);
+	}
+	return true;
+}
+
+static bool seatop_renders(void) {
+	struct sway_seat *seat;
+	wl_list_for_each(seat, &server.input->seats, link) {
+		if (seat->seatop_impl->render) {
+			return true;
+		}
+	}
+	return false;
+}
+
 static bool scan_out_fullscreen_view(struct sway_output *output,
 		struct sway_view *view) {
-	struct wlr_output *wlr_output = output->wlr_output;
 	struct sway_workspace *workspace = output->current.active_workspace;
 	if (!sway_assert(workspace, "Expected an active workspace")) {
 		return false;
 	}
 
 	if (!wl_list_empty(&view->saved_buffers)) {
-		return false;
+		return scan_out_reject(output, SCANOUT_REJECT_SAVED_BUFFERS);
 	}
 
 	for (int i = 0; i < workspace->current.floating->length; ++i) {
 		struct sway_container *floater =
 			workspace->current.floating->items[i];
 		if (container_is_transient_for(floater, view->container)) {
-			return false;
+			return scan_out_reject(output, SCANOUT_REJECT_FLOATING);
 		}
 	}
 
 #if HAVE_XWAYLAND
 	if (!wl_list_empty(&root->xwayland_unmanaged)) {
-		return false;
+		return scan_out_reject(output, SCANOUT_REJECT_UNMANAGED);
 	}
 #endif
 
 	if (!wl_list_empty(&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_OVERLAY])) {
-		return false;
-	}
-	if (!wl_list_empty(&root->drag_icons)) {
-		return false;
+		return scan_out_reject(output, SCANOUT_REJECT_LAYERS);
 	}
 
 	struct wlr_surface *surface = view->surface;
 	if (surface == NULL) {
-		return false;
+		return scan_out_reject(output, SCANOUT_REJECT_NO_BUFFER);
 	}
 	size_t n_surfaces = 0;
 	output_view_for_each_surface(output, view,
 		count_surface_iterator, &n_surfaces);
-	if (n_surfaces != 1) {
-		return false;
+	return scan_out_surface(output, surface, n_surfaces);
+}
+
+/**
+ * Return the only tiled view of the workspace, which may be nested in
+ * containers with a single child, or NULL.
+ */
+static struct sway_container *single_tiled_view(
+		struct sway_workspace *workspace) {
+	list_t *children = workspace->current.tiling;
+	while (children->length == 1) {
+		struct sway_container *child = children->items[0];
+		if (child->view) {
+			return child;
+		}
+		children = child->current.children;
 	}
+	return NULL;
+}
 
-	if (surface->buffer == NULL) {
-		return false;
+// Whether the surface at the output-local position covers the whole output
+static bool surface_covers_output(struct sway_output *output,
+		struct wlr_surface *surface, double ox, double oy) {
+	return ox == 0 && oy == 0 &&
+		surface->current.width == output->width &&
+		surface->current.height == output->height;
+}
+
+static bool surface_is_opaque(struct wlr_surface *surface) {
+	pixman_box32_t surface_box = {
+		.x2 = surface->current.width,
+		.y2 = surface->current.height,
+	};
+	return pixman_region32_contains_rectangle(&surface->opaque_region,
+		&surface_box) == PIXMAN_REGION_IN;
+}
+
+/**
+ * Scan out a tiled view which is the only thing visible on the output: it has
+ * no decorations or gaps, and hides the background and bottom layers.
+ */
+static bool scan_out_tiled_view(struct sway_output *output,
+		struct sway_container *con) {
+	struct sway_view *view = con->view;
+	if (!wl_list_empty(&view->saved_buffers)) {
+		return scan_out_reject(output, SCANOUT_REJECT_SAVED_BUFFERS);
 	}
 
-	if ((float)surface->current.scale != wlr_output->scale ||
-			surface->current.transform != wlr_output->transform) {
-		return false;
+	struct wlr_box output_box;
+	output_get_box(output, &output_box);
+	for (int i = 0; i < root->outputs->length; ++i) {
+		struct sway_output *other = root->outputs->items[i];
+		struct sway_workspace *ws = other->current.active_workspace;
+		if (!ws) {
+			continue;
+		}
+		for (int j = 0; j < ws->current.floating->length; ++j) {
+			struct sway_container *floater = ws->current.floating->items[j];
+			struct wlr_box box = {
+				.x = floater->current.x,
+				.y = floater->current.y,
+				.width = floater->current.width,
+				.height = floater->current.height,
+			};
+			struct wlr_box intersection;
+			if (wlr_box_intersection(&intersection, &output_box, &box)) {
+				return scan_out_reject(output, SCANOUT_REJECT_FLOATING);
+			}
+		}
 	}
 
-	wlr_presentation_surface_sampled_on_output(server.presentation, surface,
-		wlr_output);
+#if HAVE_XWAYLAND
+	if (!wl_list_empty(&root->xwayland_unmanaged)) {
+		return scan_out_reject(output, SCANOUT_REJECT_UNMANAGED);
+	}
+#endif
 
-	wlr_output_attach_buffer(wlr_output, &surface->buffer->base);
-	return wlr_output_commit(wlr_output);
+	if (!wl_list_empty(&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_TOP]) ||
+			!wl_list_empty(&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_OVERLAY])) {
+		return scan_out_reject(output, SCANOUT_REJECT_LAYERS);
+	}
+	if (seatop_renders()) {
+		return scan_out_reject(output, SCANOUT_REJECT_SEATOP);
+	}
+
+	struct wlr_surface *surface = view->surface;
+	if (surface == NULL) {
+		return scan_out_reject(output, SCANOUT_REJECT_NO_BUFFER);
+	}
+	// Decorations and gaps leave part of the output uncovered
+	double ox = con->surface_x - output->lx - view->geometry.x;
+	double oy = con->surface_y - output->ly - view->geometry.y;
+	if (!surface_covers_output(output, surface, ox, oy)) {
+		return scan_out_reject(output, SCANOUT_REJECT_GEOMETRY);
+	}
+	if (con->alpha < 1.0f || !surface_is_opaque(surface)) {
+		return scan_out_reject(output, SCANOUT_REJECT_NOT_OPAQUE);
+	}
+
+	size_t n_surfaces = 0;
+	output_view_for_each_surface(output, view,
+		count_surface_iterator, &n_surfaces);
+	return scan_out_surface(output, surface, n_surfaces);
 }
 
-static int output_repaint_timer_handler(void *data) {
-	struct sway_output *output = data;
-	if (output->wlr_output == NULL) {
-		return 0;
+/**
+ * Scan out an opaque overlay layer surface covering the output, such as a
+ * lock screen. Nothing below it is rendered anyway.
+ */
+static bool scan_out_overlay(struct sway_output *output) {
+	struct wl_list *overlays =
+		&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_OVERLAY];
+	if (wl_list_length(overlays) != 1) {
+		return scan_out_reject(output, SCANOUT_REJECT_LAYERS);
 	}
+	struct sway_layer_surface *layer =
+		wl_container_of(overlays->next, layer, link);
+	struct wlr_surface *surface = layer->layer_surface->surface;
 
-	output->wlr_output->frame_pending = false;
+	if (!surface_covers_output(output, surface, layer->geo.x, layer->geo.y)) {
+		return scan_out_reject(output, SCANOUT_REJECT_GEOMETRY);
+	}
 
-	struct sway_workspace *workspace = output->current.active_workspace;
-	if (workspace == NULL) {
+	size_t n_surfaces = 0;
+	output_layer_for_each_surface(output, overlays,
+		count_surface_iterator, &n_surfaces);
+	return scan_out_surface(output, surface, n_surfaces);
+}
+
+void frame_samples_add(struct sway_frame_samples *samples, uint32_t value) {
+	samples->samples[samples->next] = value;
+	samples->next = (samples->next + 1) % OUTPUT_FRAME_SAMPLES;
+	if (samples->len < OUTPUT_FRAME_SAMPLES) {
+		++samples->len;
+	}
+}
+
+static int compare_samples(const void *_a, const void *_b) {
+	uint32_t a = *(const uint32_t *)_a;
+	uint32_t b = *(const uint32_t *)_b;
+	return (a > b) - (a < b);
+}
+
+uint32_t frame_samples_percentile(const struct sway_frame_samples *samples,
+		int percentile) {
+	if (samples->len == 0) {
 		return 0;
 	}
+	uint32_t sorted[OUTPUT_FRAME_SAMPLES];
+	memcpy(sorted, samples->samples, samples->len * sizeof(uint32_t));
+	qsort(sorted, samples->len, sizeof(uint32_t), compare_samples);
+
+	size_t index = (samples->len * percentile + 99) / 100;
+	if (index > 0) {
+		--index;
+	}
+	return sorted[index];
+}
+
+// Tuning for max_render_time auto: the percentile of recent render durations
+// we plan for, the headroom added on top of it, and how many frames in a row
+// have to make it in time before a back-off millisecond is given back
+#define AUTO_RENDER_TIME_PERCENTILE 95
+#define AUTO_RENDER_TIME_MARGIN_USEC 1000
+#define AUTO_RENDER_TIME_MIN_SAMPLES 16
+#define AUTO_RENDER_TIME_DECAY_FRAMES 120
+
+static void update_auto_max_render_time(struct sway_output *output) {
+	if (!output->max_render_time_auto) {
+		return;
+	}
+
+	struct sway_frame_samples *render = &output->frame_stats.render;
+	if (output->refresh_nsec == 0
+			|| render->len < AUTO_RENDER_TIME_MIN_SAMPLES) {
+		output->max_render_time = 0;
+		return;
+	}
+
+	uint32_t usec = frame_samples_percentile(render,
+		AUTO_RENDER_TIME_PERCENTILE) + AUTO_RENDER_TIME_MARGIN_USEC;
+	int msec = (usec + 999) / 1000 + output->max_render_time_backoff;
+
+	// If there isn't any time to gain, render right after the refresh
+	int refresh_msec = output->refresh_nsec / 1000000;
+	if (msec >= refresh_msec) {
+		msec = 0;
+	}
+	output->max_render_time = msec;
+}
+
+static void handle_auto_max_render_time_present(struct sway_output *output,
+		bool missed) {
+	if (!output->max_render_time_auto) {
+		return;
+	}
+
+	if (missed) {
+		int refresh_msec = output->refresh_nsec / 1000000;
+		if (output->max_render_time_backoff < refresh_msec) {
+			++output->max_render_time_backoff;
+		}
+		output->frames_since_miss = 0;
+	} else if (++output->frames_since_miss >= AUTO_RENDER_TIME_DECAY_FRAMES) {
+		if (output->max_render_time_backoff > 0) {
+			--output->max_render_time_backoff;
+		}
+		output->frames_since_miss = 0;
+	}
+	update_auto_max_render_time(output);
+}
+
+static void frame_stats_handle_commit(struct sway_output *output) {
+	struct sway_output_frame_stats *stats = &output->frame_stats;
+	clockid_t presentation_clock =
+		wlr_backend_get_presentation_clock(server.backend);
+	clock_gettime(presentation_clock, &stats->commit_time);
+	stats->commit_pending = true;
+}
+
+static void frame_stats_handle_present(struct sway_output *output,
+		const struct timespec *when) {
+	struct sway_output_frame_stats *stats = &output->frame_stats;
+	if (!stats->commit_pending) {
+		return;
+	}
+	stats->commit_pending = false;
+
+	int64_t latency = timespec_sub_nsec(when, &stats->commit_time);
+	if (latency < 0) {
+		return;
+	}
+	frame_samples_add(&stats->present, latency / 1000);
 
+	if (output->refresh_nsec == 0 || (output->last_presentation.tv_sec == 0
+			&& output->last_presentation.tv_nsec == 0)) {
+		return;
+	}
+
+	// The frame was aiming for the first refresh following its commit. If it
+	// got presented more than half a refresh cycle later, it missed it.
+	int64_t refresh = output->refresh_nsec;
+	int64_t committed = timespec_sub_nsec(&stats->commit_time,
+		&output->last_presentation);
+	int64_t presented = timespec_sub_nsec(when, &output->last_presentation);
+	if (committed < 0) {
+		return;
+	}
+	int64_t target = (committed / refresh + 1) * refresh;
+	bool missed = presented > target + refresh / 2;
+	if (missed) {
+		++stats->frames_missed;
+	}
+	handle_auto_max_render_time_present(output, missed);
+}
+
+/**
+ * Try to commit a client buffer directly instead of rendering. Only the
+ * surfaces which would be the only thing visible on the output qualify.
+ */
+static bool output_try_scan_out(struct sway_output *output,
+		struct sway_workspace *workspace) {
 	struct sway_container *fullscreen_con = root->fullscreen_global;
 	if (!fullscreen_con) {
 		fullscreen_con = workspace->current.fullscreen;
 	}
 
-	if (fullscreen_con && fullscreen_con->view) {
-		// Try to scan-out the fullscreen view
-		static bool last_scanned_out = false;
-		bool scanned_out =
-			scan_out_fullscreen_view(output, fullscreen_con->view);
+	const char *kind;
+	bool scanned_out;
+	struct sway_container *tiled;
+	if (output_has_opaque_overlay_layer_surface(output)) {
+		kind = "overlay layer surface";
+		scanned_out = scan_out_overlay(output);
+	} else if (fullscreen_con && fullscreen_con->view) {
+		kind = "fullscreen view";
+		scanned_out = scan_out_fullscreen_view(output, fullscreen_con->view);
+	} else if (!fullscreen_con && (tiled = single_tiled_view(workspace))) {
+		kind = "tiled view";
+		scanned_out = scan_out_tiled_view(output, tiled);
+	} else {
+		return false;
+	}
+
+	struct sway_output_frame_stats *stats = &output->frame_stats;
+	++stats->scanout_attempts;
+	if (scanned_out) {
+		++stats->scanout_hits;
+		frame_stats_handle_commit(output);
+	}
+
+	if (scanned_out && !stats->scanning_out) {
+		sway_log(SWAY_DEBUG, "Scanning out %s on %s",
+			kind, output->wlr_output->name);
+	}
+	if (stats->scanning_out && !scanned_out) {
+		sway_log(SWAY_DEBUG, "Stopping scan out on %s",
+			output->wlr_output->name);
+	}
+	stats->scanning_out = scanned_out;
+	return scanned_out;
+}
+
+static uint64_t region_area(pixman_region32_t *region) {
+	uint64_t area = 0;
+	int nrects;
+	pixman_box32_t *rects = pixman_region32_rectangles(region, &nrects);
+	for (int i = 0; i < nrects; ++i) {
+		area += (uint64_t)(rects[i].x2 - rects[i].x1) *
+			(rects[i].y2 - rects[i].y1);
+	}
+	return area;
+}
+
+void output_damage_stats_init(struct sway_output *output) {
+	struct sway_output_damage_stats *stats = &output->damage_stats;
+	for (size_t i = 0; i < OUTPUT_DAMAGE_HISTORY; ++i) {
+		pixman_region32_init(&stats->history[i]);
+	}
+}
+
+static void damage_source_clear(struct sway_damage_source *source) {
+	if (source->client) {
+		wl_list_remove(&source->client_destroy.link);
+	}
+	memset(source, 0, sizeof(struct sway_damage_source));
+}
 
-		if (scanned_out && !last_scanned_out) {
-			sway_log(SWAY_DEBUG, "Scanning out fullscreen view");
+void output_damage_stats_finish(struct sway_output *output) {
+	struct sway_output_damage_stats *stats = &output->damage_stats;
+	for (size_t i = 0; i < OUTPUT_DAMAGE_SOURCES; ++i) {
+		damage_source_clear(&stats->sources[i]);
+	}
+	for (size_t i = 0; i < OUTPUT_DAMAGE_HISTORY; ++i) {
+		pixman_region32_fini(&stats->history[i]);
+	}
+}
+
+static void damage_source_handle_client_destroy(struct wl_listener *listener,
+		void *data) {
+	struct sway_damage_source *source =
+		wl_container_of(listener, source, client_destroy);
+	damage_source_clear(source);
+}
+
+static struct sway_damage_source *damage_source_get(
+		struct sway_output *output, struct wl_client *client) {
+	struct sway_damage_source *slot = NULL;
+	for (size_t i = 0; i < OUTPUT_DAMAGE_SOURCES; ++i) {
+		struct sway_damage_source *source = &output->damage_stats.sources[i];
+		if (source->client == client) {
+			return source;
 		}
-		if (last_scanned_out && !scanned_out) {
-			sway_log(SWAY_DEBUG, "Stopping fullscreen view scan out");
+		// Prefer a free slot, then the one with the least area
+		if (!slot || (slot->client &&
+				(!source->client || source->area < slot->area))) {
+			slot = source;
 		}
-		last_scanned_out = scanned_out;
+	}
+	damage_source_clear(slot);
+	slot->client = client;
+	wl_client_get_credentials(client, &slot->pid, NULL, NULL);
+	slot->client_destroy.notify = damage_source_handle_client_destroy;
+	wl_client_add_destroy_listener(client, &slot->client_destroy);
+	return slot;
+}
 
-		if (scanned_out) {
-			return 0;
+static void damage_stats_handle_surface(struct sway_output *output,
+		struct sway_view *view, struct wlr_surface *surface,
+		pixman_region32_t *damage, bool whole) {
+	struct sway_damage_source *source =
+		damage_source_get(output, wl_resource_get_client(surface->resource));
+	++source->commits;
+	if (whole) {
+		++source->whole_commits;
+	}
+	source->area += region_area(damage);
+	if (view) {
+		const char *name = view_get_app_id(view);
+		if (!name) {
+			name = view_get_class(view);
+		}
+		if (name) {
+			snprintf(source->name, sizeof(source->name), "%s", name);
 		}
 	}
+}
+
+static void damage_stats_handle_frame(struct sway_output *output,
+		pixman_region32_t *damage) {
+	struct sway_output_damage_stats *stats = &output->damage_stats;
+	uint64_t area = region_area(damage);
+	frame_samples_add(&stats->area, area > UINT32_MAX ? UINT32_MAX : area);
+	frame_samples_add(&stats->rects, pixman_region32_n_rects(damage));
+
+	int width, height;
+	wlr_output_transformed_resolution(output->wlr_output, &width, &height);
+	pixman_box32_t output_box = { 0, 0, width, height };
+	if (pixman_region32_contains_rectangle(damage, &output_box) ==
+			PIXMAN_REGION_IN) {
+		++stats->frames_full;
+	}
+
+	if (debug.damage == DAMAGE_HEATMAP) {
+		pixman_region32_copy(&stats->history[stats->history_next], damage);
+		stats->history_next = (stats->history_next + 1) % OUTPUT_DAMAGE_HISTORY;
+	}
+}
+
+static int output_repaint_timer_handler(void *data) {
+	struct sway_output *output = data;
+	if (output->wlr_output == NULL) {
+		return 0;
+	}
+
+	output->wlr_output->frame_pending = false;
+
+	struct sway_workspace *workspace = output->current.active_workspace;
+	if (workspace == NULL) {
+		return 0;
+	}
+
+	if (output_try_scan_out(output, workspace)) {
+		return 0;
+	}
 
 	bool needs_frame;
 	pixman_region32_t damage;
@@ -601,11 +1019,30 @@ static int output_repaint_timer_handler(void *data) {
 	}
 
 	if (needs_frame) {
+		// The damage to render also covers what older buffers miss, only
+		// the damage of this frame is counted
+		damage_stats_handle_frame(output, &output->damage->current);
+
 		struct timespec now;
 		clock_gettime(CLOCK_MONOTONIC, &now);
 
-		output_render(output, &now, &damage);
+		if (output_render(output, &now, &damage)) {
+			struct timespec end;
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			frame_samples_add(&output->frame_stats.render,
+				timespec_sub_nsec(&end, &now) / 1000);
+			++output->frame_stats.frames_rendered;
+			if (trace_is_active()) {
+				char track[64];
+				snprintf(track, sizeof(track), "render %s",
+						output->wlr_output->name);
+				trace_span(track, "output_render", &now, &end, NULL);
+			}
+			frame_stats_handle_commit(output);
+			update_auto_max_render_time(output);
+		}
 	} else {
+		++output->damage_stats.frames_skipped;
 		wlr_output_rollback(output->wlr_output);
 	}
 
@@ -621,6 +1058,22 @@ static void damage_handle_frame(struct wl_listener *listener, void *user_data) {
 		return;
 	}
 
+	// Dispatch pointer motion coalesced since the last frame
+	bool flushed_motion = false;
+	struct sway_seat *seat;
+	wl_list_for_each(seat, &server.input->seats, link) {
+		if (seat->coalesced_motion.pending) {
+			seatop_flush_pointer_motion(seat);
+			flushed_motion = true;
+		}
+	}
+	if (flushed_motion) {
+		transaction_commit_dirty();
+	}
+	if (server.txn_batch_frame) {
+		transaction_flush_batch();
+	}
+
 	// Compute predicted milliseconds until the next refresh. It's used for
 	// delaying both output rendering and surface frame callbacks.
 	int msec_until_refresh = 0;
@@ -711,8 +1164,15 @@ static void damage_surface_iterator(struct sway_output *output, struct sway_view
 				ceil(output->wlr_output->scale) - surface->current.scale);
 		}
 		pixman_region32_translate(&damage, box.x, box.y);
+		pixman_box32_t surface_box = {
+			box.x, box.y, box.x + box.width, box.y + box.height,
+		};
+		bool whole_surface = pixman_region32_contains_rectangle(&damage,
+			&surface_box) == PIXMAN_REGION_IN;
 		wlr_region_rotated_bounds(&damage, &damage, rotation,
 			center_x, center_y);
+		damage_stats_handle_surface(output, view, surface, &damage,
+			whole_surface);
 		wlr_output_damage_add(output->damage, &damage);
 		pixman_region32_fini(&damage);
 	}
@@ -900,6 +1360,8 @@ static void handle_present(struct wl_listener *listener, void *data) {
 		return;
 	}
 
+	frame_stats_handle_present(output, output_event->when);
+
 	output->last_presentation = *output_event->when;
 	output->refresh_nsec = output_event->refresh;
 }
@@ -1,6 +1,7 @@
 #define _POSIX_C_SOURCE 200809L
 #include <assert.h>
 #include <GLES2/gl2.h>
+#include <math.h>
 #include <stdlib.h>
 #include <strings.h>
 #include <time.h>
@@ -15,6 +16,7 @@
 #include <wlr/types/wlr_output.h>
 #include <wlr/types/wlr_surface.h>
 #include <wlr/util/region.h>
+#include "list.h"
 #include "log.h"
 #include "config.h"
 #include "sway/config.h"
@@ -50,6 +52,15 @@ static int scale_length(int length, int offset, float scale) {
 	return round((offset + length) * scale) - round(offset * scale);
 }
 
+/**
+ * The draw calls and scissor changes of the frame being rendered, which are
+ * added to the output's frame stats once it's done.
+ */
+static struct {
+	uint32_t draw_calls;
+	uint32_t scissor_changes;
+} frame_counts;
+
 static void scissor_output(struct wlr_output *wlr_output,
 		pixman_box32_t *rect) {
 	struct wlr_renderer *renderer = wlr_backend_get_renderer(wlr_output->backend);
@@ -70,6 +81,7 @@ static void scissor_output(struct wlr_output *wlr_output,
 	wlr_box_transform(&box, &box, transform, ow, oh);
 
 	wlr_renderer_scissor(renderer, &box);
+	++frame_counts.scissor_changes;
 }
 
 static void set_scale_filter(struct wlr_output *wlr_output,
@@ -96,6 +108,95 @@ static void set_scale_filter(struct wlr_output *wlr_output,
 	}
 }
 
+struct batched_rect {
+	struct wlr_box box; // output-buffer-local
+	float color[4];
+};
+
+/**
+ * Decoration rectangles are queued here instead of being drawn right away, so
+ * that the many small rectangles of borders and titlebars are checked against
+ * the damage together and drawn without changing the scissor in between.
+ *
+ * Only one output is rendered at a time, and the batch is flushed before
+ * anything which could overlap the queued rectangles is drawn.
+ */
+static struct {
+	struct batched_rect *rects;
+	size_t len, cap;
+	struct sway_output *output;
+	pixman_region32_t *damage; // which the queued rectangles are clipped to
+} rect_batch;
+
+static void flush_rects(void) {
+	if (rect_batch.len == 0) {
+		return;
+	}
+	struct wlr_output *wlr_output = rect_batch.output->wlr_output;
+	struct wlr_renderer *renderer =
+		wlr_backend_get_renderer(wlr_output->backend);
+	pixman_region32_t *output_damage = rect_batch.damage;
+
+	// Rectangles entirely within the damage don't need to be scissored
+	bool scissored = true;
+	for (size_t i = 0; i < rect_batch.len; ++i) {
+		struct batched_rect *rect = &rect_batch.rects[i];
+		struct wlr_box *box = &rect->box;
+		pixman_box32_t extents = {
+			.x1 = box->x,
+			.y1 = box->y,
+			.x2 = box->x + box->width,
+			.y2 = box->y + box->height,
+		};
+		switch (pixman_region32_contains_rectangle(output_damage, &extents)) {
+		case PIXMAN_REGION_OUT:
+			break;
+		case PIXMAN_REGION_IN:
+			if (scissored) {
+				wlr_renderer_scissor(renderer, NULL);
+				++frame_counts.scissor_changes;
+				scissored = false;
+			}
+			wlr_render_rect(renderer, box, rect->color,
+				wlr_output->transform_matrix);
+			++frame_counts.draw_calls;
+			break;
+		case PIXMAN_REGION_PART: {
+			pixman_region32_t damage;
+			pixman_region32_init_rect(&damage, box->x, box->y,
+				box->width, box->height);
+			pixman_region32_intersect(&damage, &damage, output_damage);
+			int nrects;
+			pixman_box32_t *rects = pixman_region32_rectangles(&damage, &nrects);
+			for (int j = 0; j < nrects; ++j) {
+				scissor_output(wlr_output, &rects[j]);
+				wlr_render_rect(renderer, box, rect->color,
+					wlr_output->transform_matrix);
+				++frame_counts.draw_calls;
+			}
+			pixman_region32_fini(&damage);
+			scissored = true;
+			break;
+		}
+		}
+	}
+	rect_batch.len = 0;
+}
+
+// Flush the batch if any queued rectangle overlaps the box, which is about to
+// be drawn on top of them
+static void flush_rects_under(const struct wlr_box *box) {
+	for (size_t i = 0; i < rect_batch.len; ++i) {
+		struct wlr_box *rect = &rect_batch.rects[i].box;
+		if (rect->x < box->x + box->width && box->x < rect->x + rect->width &&
+				rect->y < box->y + box->height &&
+				box->y < rect->y + rect->height) {
+			flush_rects();
+			return;
+		}
+	}
+}
+
 static void render_texture(struct wlr_output *wlr_output,
 		pixman_region32_t *output_damage, struct wlr_texture *texture,
 		const struct wlr_fbox *src_box, const struct wlr_box *dst_box,
@@ -107,6 +208,8 @@ static void render_texture(struct wlr_output *wlr_output,
 	struct wlr_gles2_texture_attribs attribs;
 	wlr_gles2_texture_get_attribs(texture, &attribs);
 
+	flush_rects_under(dst_box);
+
 	pixman_region32_t damage;
 	pixman_region32_init(&damage);
 	pixman_region32_union_rect(&damage, &damage, dst_box->x, dst_box->y,
@@ -127,6 +230,7 @@ static void render_texture(struct wlr_output *wlr_output,
 		} else {
 			wlr_render_texture_with_matrix(renderer, texture, matrix, alpha);
 		}
+		++frame_counts.draw_calls;
 	}
 
 damage_finish:
@@ -213,34 +317,34 @@ void render_rect(struct sway_output *output,
 		pixman_region32_t *output_damage, const struct wlr_box *_box,
 		float color[static 4]) {
 	struct wlr_output *wlr_output = output->wlr_output;
-	struct wlr_renderer *renderer =
-		wlr_backend_get_renderer(wlr_output->backend);
 
 	struct wlr_box box;
 	memcpy(&box, _box, sizeof(struct wlr_box));
 	box.x -= output->lx * wlr_output->scale;
 	box.y -= output->ly * wlr_output->scale;
-
-	pixman_region32_t damage;
-	pixman_region32_init(&damage);
-	pixman_region32_union_rect(&damage, &damage, box.x, box.y,
-		box.width, box.height);
-	pixman_region32_intersect(&damage, &damage, output_damage);
-	bool damaged = pixman_region32_not_empty(&damage);
-	if (!damaged) {
-		goto damage_finish;
+	if (box.width <= 0 || box.height <= 0) {
+		return;
 	}
 
-	int nrects;
-	pixman_box32_t *rects = pixman_region32_rectangles(&damage, &nrects);
-	for (int i = 0; i < nrects; ++i) {
-		scissor_output(wlr_output, &rects[i]);
-		wlr_render_rect(renderer, &box, color,
-			wlr_output->transform_matrix);
+	if (rect_batch.output != output || rect_batch.damage != output_damage) {
+		flush_rects();
+		rect_batch.output = output;
+		rect_batch.damage = output_damage;
 	}
-
-damage_finish:
-	pixman_region32_fini(&damage);
+	if (rect_batch.len == rect_batch.cap) {
+		size_t cap = rect_batch.cap ? rect_batch.cap * 2 : 64;
+		struct batched_rect *rects =
+			realloc(rect_batch.rects, cap * sizeof(struct batched_rect));
+		if (!rects) {
+			sway_log(SWAY_ERROR, "Unable to allocate rectangle batch");
+			return;
+		}
+		rect_batch.rects = rects;
+		rect_batch.cap = cap;
+	}
+	struct batched_rect *rect = &rect_batch.rects[rect_batch.len++];
+	rect->box = box;
+	memcpy(rect->color, color, sizeof(rect->color));
 }
 
 void premultiply_alpha(float color[4], float opacity) {
@@ -709,23 +813,17 @@ static void render_containers_linear(struct sway_output *output,
 
 			if (view_is_urgent(view)) {
 				colors = &config->border_colors.urgent;
-				title_texture = child->title_urgent;
-				marks_texture = child->marks_urgent;
 			} else if (state->focused || parent->focused) {
 				colors = &config->border_colors.focused;
-				title_texture = child->title_focused;
-				marks_texture = child->marks_focused;
 			} else if (child == parent->active_child) {
 				colors = &config->border_colors.focused_inactive;
-				title_texture = child->title_focused_inactive;
-				marks_texture = child->marks_focused_inactive;
 			} else {
 				colors = &config->border_colors.unfocused;
-				title_texture = child->title_unfocused;
-				marks_texture = child->marks_unfocused;
 			}
 
 			if (state->border == B_NORMAL) {
+				title_texture = container_get_title_texture(child, colors);
+				marks_texture = container_get_marks_texture(child, colors);
 				render_titlebar(output, damage, child, state->x,
 						state->y, state->width, colors,
 						title_texture, marks_texture);
@@ -765,20 +863,12 @@ static void render_containers_tabbed(struct sway_output *output,
 
 		if (urgent) {
 			colors = &config->border_colors.urgent;
-			title_texture = child->title_urgent;
-			marks_texture = child->marks_urgent;
 		} else if (cstate->focused || parent->focused) {
 			colors = &config->border_colors.focused;
-			title_texture = child->title_focused;
-			marks_texture = child->marks_focused;
 		} else if (child == parent->active_child) {
 			colors = &config->border_colors.focused_inactive;
-			title_texture = child->title_focused_inactive;
-			marks_texture = child->marks_focused_inactive;
 		} else {
 			colors = &config->border_colors.unfocused;
-			title_texture = child->title_unfocused;
-			marks_texture = child->marks_unfocused;
 		}
 
 		int x = cstate->x + tab_width * i;
@@ -788,6 +878,8 @@ static void render_containers_tabbed(struct sway_output *output,
 			tab_width = parent->box.width - tab_width * i;
 		}
 
+		title_texture = container_get_title_texture(child, colors);
+		marks_texture = container_get_marks_texture(child, colors);
 		render_titlebar(output, damage, child, x, parent->box.y, tab_width,
 				colors, title_texture, marks_texture);
 
@@ -830,23 +922,17 @@ static void render_containers_stacked(struct sway_output *output,
 
 		if (urgent) {
 			colors = &config->border_colors.urgent;
-			title_texture = child->title_urgent;
-			marks_texture = child->marks_urgent;
 		} else if (cstate->focused || parent->focused) {
 			colors = &config->border_colors.focused;
-			title_texture = child->title_focused;
-			marks_texture = child->marks_focused;
 		} else if (child == parent->active_child) {
 			colors = &config->border_colors.focused_inactive;
-			title_texture = child->title_focused_inactive;
-			marks_texture = child->marks_focused_inactive;
 		} else {
 			colors = &config->border_colors.unfocused;
-			title_texture = child->title_unfocused;
-			marks_texture = child->marks_unfocused;
 		}
 
 		int y = parent->box.y + titlebar_height * i;
+		title_texture = container_get_title_texture(child, colors);
+		marks_texture = container_get_marks_texture(child, colors);
 		render_titlebar(output, damage, child, parent->box.x, y,
 				parent->box.width, colors, title_texture, marks_texture);
 
@@ -933,19 +1019,15 @@ static void render_floating_container(struct sway_output *soutput,
 
 		if (view_is_urgent(view)) {
 			colors = &config->border_colors.urgent;
-			title_texture = con->title_urgent;
-			marks_texture = con->marks_urgent;
 		} else if (con->current.focused) {
 			colors = &config->border_colors.focused;
-			title_texture = con->title_focused;
-			marks_texture = con->marks_focused;
 		} else {
 			colors = &config->border_colors.unfocused;
-			title_texture = con->title_unfocused;
-			marks_texture = con->marks_unfocused;
 		}
 
 		if (con->current.border == B_NORMAL) {
+			title_texture = container_get_title_texture(con, colors);
+			marks_texture = container_get_marks_texture(con, colors);
 			render_titlebar(soutput, damage, con, con->current.x,
 					con->current.y, con->current.width, colors,
 					title_texture, marks_texture);
@@ -958,8 +1040,7 @@ static void render_floating_container(struct sway_output *soutput,
 	}
 }
 
-static void render_floating(struct sway_output *soutput,
-		pixman_region32_t *damage) {
+static void collect_floating(list_t *floaters) {
 	for (int i = 0; i < root->outputs->length; ++i) {
 		struct sway_output *output = root->outputs->items[i];
 		for (int j = 0; j < output->current.workspaces->length; ++j) {
@@ -972,12 +1053,248 @@ static void render_floating(struct sway_output *soutput,
 				if (floater->fullscreen_mode != FULLSCREEN_NONE) {
 					continue;
 				}
-				render_floating_container(soutput, damage, floater);
+				list_add(floaters, floater);
 			}
 		}
 	}
 }
 
+/**
+ * Scale a region from logical to buffer coordinates, rounding inwards so that
+ * the result only contains pixels which are entirely covered.
+ */
+static void scale_region_inward(pixman_region32_t *region, float scale) {
+	if (scale == 1.0f) {
+		return;
+	}
+	pixman_region32_t scaled;
+	pixman_region32_init(&scaled);
+	int nrects;
+	pixman_box32_t *rects = pixman_region32_rectangles(region, &nrects);
+	for (int i = 0; i < nrects; ++i) {
+		int x1 = ceil(rects[i].x1 * scale);
+		int y1 = ceil(rects[i].y1 * scale);
+		int x2 = floor(rects[i].x2 * scale);
+		int y2 = floor(rects[i].y2 * scale);
+		if (x2 > x1 && y2 > y1) {
+			pixman_region32_union_rect(&scaled, &scaled,
+				x1, y1, x2 - x1, y2 - y1);
+		}
+	}
+	pixman_region32_copy(region, &scaled);
+	pixman_region32_fini(&scaled);
+}
+
+static void opaque_region_iterator(struct sway_output *output,
+		struct sway_view *view, struct wlr_surface *surface,
+		struct wlr_box *box, float rotation, void *data) {
+	pixman_region32_t *occluder = data;
+	if (rotation != 0.0f || !wlr_surface_get_texture(surface)) {
+		return;
+	}
+	pixman_region32_t opaque;
+	pixman_region32_init(&opaque);
+	pixman_region32_intersect_rect(&opaque, &surface->opaque_region,
+		0, 0, surface->current.width, surface->current.height);
+	pixman_region32_translate(&opaque, box->x, box->y);
+	scale_region_inward(&opaque, output->wlr_output->scale);
+	pixman_region32_union(occluder, occluder, &opaque);
+	pixman_region32_fini(&opaque);
+}
+
+static void container_opaque_region(struct sway_output *output,
+		struct sway_container *con, pixman_region32_t *occluder);
+
+static void children_opaque_region(struct sway_output *output,
+		enum sway_container_layout layout, list_t *children,
+		struct sway_container *active_child, pixman_region32_t *occluder) {
+	bool lone_tab = config->hide_lone_tab && children->length == 1 &&
+		((struct sway_container *)children->items[0])->view;
+	if (!lone_tab && (layout == L_TABBED || layout == L_STACKED)) {
+		// Only the active child is drawn
+		if (active_child) {
+			container_opaque_region(output, active_child, occluder);
+		}
+		return;
+	}
+	for (int i = 0; i < children->length; ++i) {
+		container_opaque_region(output, children->items[i], occluder);
+	}
+}
+
+/**
+ * Add the area which the container's surfaces are drawn opaquely over to the
+ * occluder region. Decorations are not taken into account.
+ */
+static void container_opaque_region(struct sway_output *output,
+		struct sway_container *con, pixman_region32_t *occluder) {
+	if (!con->view) {
+		children_opaque_region(output, con->current.layout,
+			con->current.children, con->current.focused_inactive_child,
+			occluder);
+		return;
+	}
+	struct sway_view *view = con->view;
+	// Saved buffers carry no opaque region
+	if (!view->surface || !wl_list_empty(&view->saved_buffers) ||
+			con->alpha < 1.0f) {
+		return;
+	}
+	double ox = con->surface_x - output->lx - view->geometry.x;
+	double oy = con->surface_y - output->ly - view->geometry.y;
+	output_surface_for_each_surface(output, view->surface, ox, oy,
+			opaque_region_iterator, occluder);
+}
+
+static void render_occlusion_debug(struct sway_output *output,
+		pixman_region32_t *culled) {
+	struct wlr_output *wlr_output = output->wlr_output;
+	struct wlr_renderer *renderer =
+		wlr_backend_get_renderer(wlr_output->backend);
+	struct wlr_box box = {
+		.width = wlr_output->width,
+		.height = wlr_output->height,
+	};
+	float color[4] = {1.0f, 0.0f, 1.0f, 1.0f};
+	premultiply_alpha(color, 0.3f);
+
+	int nrects;
+	pixman_box32_t *rects = pixman_region32_rectangles(culled, &nrects);
+	for (int i = 0; i < nrects; ++i) {
+		scissor_output(wlr_output, &rects[i]);
+		wlr_render_rect(renderer, &box, color, wlr_output->transform_matrix);
+		++frame_counts.draw_calls;
+	}
+}
+
+/**
+ * Render everything up to and including the top layer, skipping what is
+ * covered by opaque surfaces in front of it.
+ *
+ * The opaque regions are collected front to back: each part of the scene is
+ * drawn with the damage minus what the parts above it cover.
+ */
+static void render_scene(struct sway_output *output, pixman_region32_t *damage,
+		struct sway_workspace *workspace) {
+	struct wlr_output *wlr_output = output->wlr_output;
+	struct wlr_renderer *renderer =
+		wlr_backend_get_renderer(wlr_output->backend);
+
+	list_t *floaters = create_list();
+	collect_floating(floaters);
+	int nfloaters = floaters->length;
+	pixman_region32_t *floater_damage =
+		calloc(nfloaters ? nfloaters : 1, sizeof(pixman_region32_t));
+	if (!floater_damage) {
+		sway_log(SWAY_ERROR, "Unable to allocate floating container damage");
+		list_free(floaters);
+		return;
+	}
+
+	pixman_region32_t occluded, unmanaged_damage, workspace_damage;
+	pixman_region32_init(&occluded);
+	pixman_region32_init(&unmanaged_damage);
+	pixman_region32_init(&workspace_damage);
+
+	output_layer_for_each_surface_toplevel(output,
+		&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_TOP],
+		opaque_region_iterator, &occluded);
+	pixman_region32_subtract(&unmanaged_damage, damage, &occluded);
+#if HAVE_XWAYLAND
+	output_unmanaged_for_each_surface(output, &root->xwayland_unmanaged,
+		opaque_region_iterator, &occluded);
+#endif
+	for (int i = nfloaters - 1; i >= 0; --i) {
+		pixman_region32_init(&floater_damage[i]);
+		pixman_region32_subtract(&floater_damage[i], damage, &occluded);
+		container_opaque_region(output, floaters->items[i], &occluded);
+	}
+	pixman_region32_subtract(&workspace_damage, damage, &occluded);
+	children_opaque_region(output, workspace->current.layout,
+		workspace->current.tiling, workspace->current.focused_inactive_child,
+		&occluded);
+
+	// What is left for the background and bottom layers
+	pixman_region32_t below_damage;
+	pixman_region32_init(&below_damage);
+	pixman_region32_subtract(&below_damage, damage, &occluded);
+
+	float clear_color[] = {0.25f, 0.25f, 0.25f, 1.0f};
+
+	int nrects;
+	pixman_box32_t *rects = pixman_region32_rectangles(&below_damage, &nrects);
+	for (int i = 0; i < nrects; ++i) {
+		scissor_output(wlr_output, &rects[i]);
+		wlr_renderer_clear(renderer, clear_color);
+		++frame_counts.draw_calls;
+	}
+
+	render_layer_toplevel(output, &below_damage,
+		&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_BACKGROUND]);
+	render_layer_toplevel(output, &below_damage,
+		&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_BOTTOM]);
+
+	render_workspace(output, &workspace_damage, workspace,
+		workspace->current.focused);
+	for (int i = 0; i < nfloaters; ++i) {
+		render_floating_container(output, &floater_damage[i],
+			floaters->items[i]);
+		flush_rects();
+		pixman_region32_fini(&floater_damage[i]);
+	}
+#if HAVE_XWAYLAND
+	render_unmanaged(output, &unmanaged_damage, &root->xwayland_unmanaged);
+#endif
+	render_layer_toplevel(output, damage,
+		&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_TOP]);
+	flush_rects();
+
+	if (debug.occlusion) {
+		pixman_region32_t culled;
+		pixman_region32_init(&culled);
+		pixman_region32_intersect(&culled, damage, &occluded);
+		render_occlusion_debug(output, &culled);
+		pixman_region32_fini(&culled);
+	}
+
+	pixman_region32_fini(&below_damage);
+	pixman_region32_fini(&workspace_damage);
+	pixman_region32_fini(&unmanaged_damage);
+	pixman_region32_fini(&occluded);
+	free(floater_damage);
+	list_free(floaters);
+}
+
+/**
+ * Tint the damage of the most recent frames on top of each other, so that the
+ * areas damaged over and over again are the most intense.
+ */
+static void render_damage_heatmap(struct sway_output *output) {
+	struct wlr_output *wlr_output = output->wlr_output;
+	struct wlr_renderer *renderer =
+		wlr_backend_get_renderer(wlr_output->backend);
+	struct wlr_box box = {
+		.width = wlr_output->width,
+		.height = wlr_output->height,
+	};
+	float color[4] = {1.0f, 0.0f, 0.0f, 1.0f};
+	premultiply_alpha(color, 0.15f);
+
+	flush_rects();
+	struct sway_output_damage_stats *stats = &output->damage_stats;
+	for (size_t i = 0; i < OUTPUT_DAMAGE_HISTORY; ++i) {
+		int nrects;
+		pixman_box32_t *rects =
+			pixman_region32_rectangles(&stats->history[i], &nrects);
+		for (int j = 0; j < nrects; ++j) {
+			scissor_output(wlr_output, &rects[j]);
+			wlr_render_rect(renderer, &box, color,
+				wlr_output->transform_matrix);
+			++frame_counts.draw_calls;
+		}
+	}
+}
+
 static void render_seatops(struct sway_output *output,
 		pixman_region32_t *damage) {
 	struct sway_seat *seat;
@@ -986,7 +1303,7 @@ static void render_seatops(struct sway_output *output,
 	}
 }
 
-void output_render(struct sway_output *output, struct timespec *when,
+bool output_render(struct sway_output *output, struct timespec *when,
 		pixman_region32_t *damage) {
 	struct wlr_output *wlr_output = output->wlr_output;
 
@@ -994,12 +1311,12 @@ void output_render(struct sway_output *output, struct timespec *when,
 		wlr_backend_get_renderer(wlr_output->backend);
 	if (!sway_assert(renderer != NULL,
 			"expected the output backend to have a renderer")) {
-		return;
+		return false;
 	}
 
 	struct sway_workspace *workspace = output->current.active_workspace;
 	if (workspace == NULL) {
-		return;
+		return false;
 	}
 
 	struct sway_container *fullscreen_con = root->fullscreen_global;
@@ -1008,6 +1325,7 @@ void output_render(struct sway_output *output, struct timespec *when,
 	}
 
 	wlr_renderer_begin(renderer, wlr_output->width, wlr_output->height);
+	frame_counts.draw_calls = frame_counts.scissor_changes = 0;
 
 	if (!pixman_region32_not_empty(damage)) {
 		// Output isn't damaged but needs buffer swap
@@ -1016,7 +1334,9 @@ void output_render(struct sway_output *output, struct timespec *when,
 
 	if (debug.damage == DAMAGE_HIGHLIGHT) {
 		wlr_renderer_clear(renderer, (float[]){1, 1, 0, 1});
-	} else if (debug.damage == DAMAGE_RERENDER) {
+		++frame_counts.draw_calls;
+	} else if (debug.damage == DAMAGE_RERENDER ||
+			debug.damage == DAMAGE_HEATMAP) {
 		int width, height;
 		wlr_output_transformed_resolution(wlr_output, &width, &height);
 		pixman_region32_union_rect(damage, damage, 0, 0, width, height);
@@ -1034,6 +1354,7 @@ void output_render(struct sway_output *output, struct timespec *when,
 		for (int i = 0; i < nrects; ++i) {
 			scissor_output(wlr_output, &rects[i]);
 			wlr_renderer_clear(renderer, clear_color);
+			++frame_counts.draw_calls;
 		}
 
 		if (fullscreen_con->view) {
@@ -1059,27 +1380,7 @@ void output_render(struct sway_output *output, struct timespec *when,
 		render_unmanaged(output, damage, &root->xwayland_unmanaged);
 #endif
 	} else {
-		float clear_color[] = {0.25f, 0.25f, 0.25f, 1.0f};
-
-		int nrects;
-		pixman_box32_t *rects = pixman_region32_rectangles(damage, &nrects);
-		for (int i = 0; i < nrects; ++i) {
-			scissor_output(wlr_output, &rects[i]);
-			wlr_renderer_clear(renderer, clear_color);
-		}
-
-		render_layer_toplevel(output, damage,
-			&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_BACKGROUND]);
-		render_layer_toplevel(output, damage,
-			&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_BOTTOM]);
-
-		render_workspace(output, damage, workspace, workspace->current.focused);
-		render_floating(output, damage);
-#if HAVE_XWAYLAND
-		render_unmanaged(output, damage, &root->xwayland_unmanaged);
-#endif
-		render_layer_toplevel(output, damage,
-			&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_TOP]);
+		render_scene(output, damage, workspace);
 
 		render_layer_popups(output, damage,
 			&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_BACKGROUND]);
@@ -1104,10 +1405,19 @@ render_overlay:
 		&output->layers[ZWLR_LAYER_SHELL_V1_LAYER_OVERLAY]);
 	render_drag_icons(output, damage, &root->drag_icons);
 
+	if (debug.damage == DAMAGE_HEATMAP) {
+		render_damage_heatmap(output);
+	}
+
 renderer_end:
+	flush_rects();
 	wlr_renderer_scissor(renderer, NULL);
 	wlr_output_render_software_cursors(wlr_output, damage);
 	wlr_renderer_end(renderer);
+	frame_samples_add(&output->frame_stats.draw_calls,
+		frame_counts.draw_calls);
+	frame_samples_add(&output->frame_stats.scissor_changes,
+		frame_counts.scissor_changes);
 
 	int width, height;
 	wlr_output_transformed_resolution(wlr_output, &width, &height);
@@ -1120,7 +1430,7 @@ renderer_end:
 	wlr_region_transform(&frame_damage, &output->damage->current,
 		transform, width, height);
 
-	if (debug.damage == DAMAGE_HIGHLIGHT) {
+	if (debug.damage == DAMAGE_HIGHLIGHT || debug.damage == DAMAGE_HEATMAP) {
 		pixman_region32_union_rect(&frame_damage, &frame_damage,
 			0, 0, wlr_output->width, wlr_output->height);
 	}
@@ -1129,7 +1439,8 @@ renderer_end:
 	pixman_region32_fini(&frame_damage);
 
 	if (!wlr_output_commit(wlr_output)) {
-		return;
+		return false;
 	}
 	output->last_frame = *when;
+	return true;
 }
@@ -0,0 +1,330 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cairo/cairo.h>
+#include <pango/pangocairo.h>
+#include <wayland-server-core.h>
+#include <wlr/backend.h>
+#include <wlr/render/wlr_renderer.h>
+#include <wlr/render/wlr_texture.h>
+#include <wlr/types/wlr_output.h>
+#include "cairo.h"
+#include "log.h"
+#include "pango.h"
+#include "sway/config.h"
+#include "sway/desktop/titlebar_cache.h"
+#include "sway/output.h"
+
+// How many textures nobody references are kept around for reuse
+#define TITLEBAR_CACHE_UNUSED_MAX 64
+#define TITLEBAR_CACHE_INITIAL_BUCKETS 64
+
+struct titlebar_texture {
+	uint32_t hash;
+
+	// Key
+	enum titlebar_text_type type;
+	char *text;
+	char *font;
+	bool markup;
+	enum wl_output_subpixel subpixel;
+	float scale;
+	int height;
+	float text_color[4];
+	float background[4];
+	struct wlr_renderer *renderer;
+
+	struct wlr_texture *texture;
+	size_t bytes;
+	int refs;
+
+	struct wl_list key_link; // cache.key_buckets
+	struct wl_list texture_link; // cache.texture_buckets
+	struct wl_list unused_link; // cache.unused, only while refs == 0
+};
+
+static struct {
+	struct wl_list *key_buckets;
+	struct wl_list *texture_buckets;
+	size_t nbuckets;
+	struct wl_list unused; // most recently released first
+	struct titlebar_cache_stats stats;
+} cache;
+
+static uint32_t hash_bytes(uint32_t hash, const void *data, size_t len) {
+	// FNV-1a
+	const unsigned char *bytes = data;
+	for (size_t i = 0; i < len; ++i) {
+		hash ^= bytes[i];
+		hash *= 16777619;
+	}
+	return hash;
+}
+
+static uint32_t hash_key(const struct titlebar_texture *key) {
+	uint32_t hash = 2166136261u;
+	hash = hash_bytes(hash, key->text, strlen(key->text));
+	hash = hash_bytes(hash, key->font, strlen(key->font));
+	hash = hash_bytes(hash, &key->type, sizeof(key->type));
+	hash = hash_bytes(hash, &key->markup, sizeof(key->markup));
+	hash = hash_bytes(hash, &key->subpixel, sizeof(key->subpixel));
+	hash = hash_bytes(hash, &key->scale, sizeof(key->scale));
+	hash = hash_bytes(hash, &key->height, sizeof(key->height));
+	hash = hash_bytes(hash, key->text_color, sizeof(key->text_color));
+	hash = hash_bytes(hash, key->background, sizeof(key->background));
+	hash = hash_bytes(hash, &key->renderer, sizeof(key->renderer));
+	return hash;
+}
+
+static uint32_t hash_texture(const struct wlr_texture *texture) {
+	return hash_bytes(2166136261u, &texture, sizeof(texture));
+}
+
+static bool key_equal(const struct titlebar_texture *a,
+		const struct titlebar_texture *b) {
+	return a->hash == b->hash && a->type == b->type
+		&& a->markup == b->markup && a->subpixel == b->subpixel
+		&& a->scale == b->scale && a->height == b->height
+		&& a->renderer == b->renderer
+		&& memcmp(a->text_color, b->text_color, sizeof(a->text_color)) == 0
+		&& memcmp(a->background, b->background, sizeof(a->background)) == 0
+		&& strcmp(a->text, b->text) == 0 && strcmp(a->font, b->font) == 0;
+}
+
+static bool resize_buckets(size_t nbuckets) {
+	struct wl_list *key_buckets = calloc(nbuckets, sizeof(struct wl_list));
+	struct wl_list *texture_buckets = calloc(nbuckets, sizeof(struct wl_list));
+	if (!key_buckets || !texture_buckets) {
+		sway_log(SWAY_ERROR, "Unable to allocate titlebar cache buckets");
+		free(key_buckets);
+		free(texture_buckets);
+		return false;
+	}
+	for (size_t i = 0; i < nbuckets; ++i) {
+		wl_list_init(&key_buckets[i]);
+		wl_list_init(&texture_buckets[i]);
+	}
+
+	for (size_t i = 0; i < cache.nbuckets; ++i) {
+		struct titlebar_texture *entry, *tmp;
+		wl_list_for_each_safe(entry, tmp, &cache.key_buckets[i], key_link) {
+			wl_list_remove(&entry->key_link);
+			wl_list_remove(&entry->texture_link);
+			wl_list_insert(&key_buckets[entry->hash % nbuckets],
+				&entry->key_link);
+			wl_list_insert(
+				&texture_buckets[hash_texture(entry->texture) % nbuckets],
+				&entry->texture_link);
+		}
+	}
+
+	free(cache.key_buckets);
+	free(cache.texture_buckets);
+	cache.key_buckets = key_buckets;
+	cache.texture_buckets = texture_buckets;
+	cache.nbuckets = nbuckets;
+	return true;
+}
+
+static struct wlr_texture *render_text(const struct titlebar_texture *key,
+		size_t *bytes) {
+	double scale = key->scale;
+	int width = 0;
+	int height = key->height * scale;
+
+	cairo_font_options_t *fo = NULL;
+	if (key->type == TITLEBAR_TEXT_TITLE) {
+		// We must use a non-nil cairo_t for cairo_set_font_options to work.
+		// Therefore, we cannot use cairo_create(NULL).
+		cairo_surface_t *dummy_surface = cairo_image_surface_create(
+				CAIRO_FORMAT_ARGB32, 0, 0);
+		cairo_t *c = cairo_create(dummy_surface);
+		cairo_set_antialias(c, CAIRO_ANTIALIAS_BEST);
+		fo = cairo_font_options_create();
+		cairo_font_options_set_hint_style(fo, CAIRO_HINT_STYLE_FULL);
+		if (key->subpixel == WL_OUTPUT_SUBPIXEL_NONE) {
+			cairo_font_options_set_antialias(fo, CAIRO_ANTIALIAS_GRAY);
+		} else {
+			cairo_font_options_set_antialias(fo, CAIRO_ANTIALIAS_SUBPIXEL);
+			cairo_font_options_set_subpixel_order(fo,
+				to_cairo_subpixel_order(key->subpixel));
+		}
+		cairo_set_font_options(c, fo);
+		get_text_size(c, key->font, &width, NULL, NULL, scale,
+				key->markup, "%s", key->text);
+		cairo_surface_destroy(dummy_surface);
+		cairo_destroy(c);
+	} else {
+		cairo_t *c = cairo_create(NULL);
+		get_text_size(c, key->font, &width, NULL, NULL, scale, key->markup,
+				"%s", key->text);
+		cairo_destroy(c);
+	}
+
+	cairo_surface_t *surface = cairo_image_surface_create(
+			CAIRO_FORMAT_ARGB32, width, height);
+	cairo_t *cairo = cairo_create(surface);
+	cairo_set_antialias(cairo, CAIRO_ANTIALIAS_BEST);
+	if (fo) {
+		cairo_set_font_options(cairo, fo);
+		cairo_font_options_destroy(fo);
+	}
+	cairo_set_source_rgba(cairo, key->background[0], key->background[1],
+			key->background[2], key->background[3]);
+	cairo_paint(cairo);
+	PangoContext *pango = pango_cairo_create_context(cairo);
+	cairo_set_source_rgba(cairo, key->text_color[0], key->text_color[1],
+			key->text_color[2], key->text_color[3]);
+	cairo_move_to(cairo, 0, 0);
+
+	pango_printf(cairo, key->font, scale, key->markup, "%s", key->text);
+
+	cairo_surface_flush(surface);
+	unsigned char *data = cairo_image_surface_get_data(surface);
+	int stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, width);
+	struct wlr_texture *texture = wlr_texture_from_pixels(key->renderer,
+			WL_SHM_FORMAT_ARGB8888, stride, width, height, data);
+	*bytes = (size_t)stride * height;
+	cairo_surface_destroy(surface);
+	g_object_unref(pango);
+	cairo_destroy(cairo);
+	return texture;
+}
+
+static void entry_destroy(struct titlebar_texture *entry) {
+	wl_list_remove(&entry->key_link);
+	wl_list_remove(&entry->texture_link);
+	wl_list_remove(&entry->unused_link);
+	if (entry->refs == 0) {
+		--cache.stats.unused_entries;
+	}
+	--cache.stats.entries;
+	cache.stats.bytes -= entry->bytes;
+	wlr_texture_destroy(entry->texture);
+	free(entry->text);
+	free(entry->font);
+	free(entry);
+}
+
+struct wlr_texture *titlebar_cache_get(struct sway_output *output,
+		enum titlebar_text_type type, const char *text, int height,
+		struct border_colors *class) {
+	if (cache.nbuckets == 0) {
+		wl_list_init(&cache.unused);
+		if (!resize_buckets(TITLEBAR_CACHE_INITIAL_BUCKETS)) {
+			return NULL;
+		}
+	}
+
+	struct titlebar_texture key = {
+		.type = type,
+		.text = (char *)text,
+		.font = config->font,
+		.markup = type == TITLEBAR_TEXT_TITLE && config->pango_markup,
+		// Only titles are rendered with subpixel antialiasing
+		.subpixel = type == TITLEBAR_TEXT_TITLE ?
+			output->wlr_output->subpixel : WL_OUTPUT_SUBPIXEL_UNKNOWN,
+		.scale = output->wlr_output->scale,
+		.height = height,
+		.renderer = wlr_backend_get_renderer(output->wlr_output->backend),
+	};
+	memcpy(key.text_color, class->text, sizeof(key.text_color));
+	memcpy(key.background, class->background, sizeof(key.background));
+	key.hash = hash_key(&key);
+
+	struct titlebar_texture *entry;
+	wl_list_for_each(entry, &cache.key_buckets[key.hash % cache.nbuckets],
+			key_link) {
+		if (!key_equal(entry, &key)) {
+			continue;
+		}
+		if (entry->refs++ == 0) {
+			wl_list_remove(&entry->unused_link);
+			wl_list_init(&entry->unused_link);
+			--cache.stats.unused_entries;
+		}
+		++cache.stats.hits;
+		cache.stats.bytes_saved += entry->bytes;
+		return entry->texture;
+	}
+
+	++cache.stats.misses;
+	size_t bytes = 0;
+	struct wlr_texture *texture = render_text(&key, &bytes);
+	if (!texture) {
+		return NULL;
+	}
+
+	entry = calloc(1, sizeof(struct titlebar_texture));
+	if (!entry) {
+		sway_log(SWAY_ERROR, "Unable to allocate titlebar cache entry");
+		wlr_texture_destroy(texture);
+		return NULL;
+	}
+	*entry = key;
+	entry->text = strdup(text);
+	entry->font = strdup(config->font);
+	entry->texture = texture;
+	entry->bytes = bytes;
+	entry->refs = 1;
+	wl_list_insert(&cache.key_buckets[entry->hash % cache.nbuckets],
+		&entry->key_link);
+	wl_list_insert(&cache.texture_buckets[hash_texture(texture) % cache.nbuckets],
+		&entry->texture_link);
+	wl_list_init(&entry->unused_link);
+	++cache.stats.entries;
+	cache.stats.bytes += bytes;
+
+	if (cache.stats.entries > cache.nbuckets * 2) {
+		resize_buckets(cache.nbuckets * 2);
+	}
+	return texture;
+}
+
+void titlebar_cache_release(struct wlr_texture *texture) {
+	// The texture is already gone if the cache has been finished
+	if (!texture || cache.nbuckets == 0) {
+		return;
+	}
+
+	struct titlebar_texture *entry, *found = NULL;
+	wl_list_for_each(entry,
+			&cache.texture_buckets[hash_texture(texture) % cache.nbuckets],
+			texture_link) {
+		if (entry->texture == texture) {
+			found = entry;
+			break;
+		}
+	}
+	if (!sway_assert(found, "Released a texture which isn't cached")) {
+		return;
+	}
+	if (--found->refs > 0) {
+		return;
+	}
+
+	wl_list_insert(&cache.unused, &found->unused_link);
+	++cache.stats.unused_entries;
+	if (cache.stats.unused_entries > TITLEBAR_CACHE_UNUSED_MAX) {
+		struct titlebar_texture *oldest =
+			wl_container_of(cache.unused.prev, oldest, unused_link);
+		entry_destroy(oldest);
+	}
+}
+
+void titlebar_cache_get_stats(struct titlebar_cache_stats *stats) {
+	*stats = cache.stats;
+}
+
+void titlebar_cache_finish(void) {
+	for (size_t i = 0; i < cache.nbuckets; ++i) {
+		struct titlebar_texture *entry, *tmp;
+		wl_list_for_each_safe(entry, tmp, &cache.key_buckets[i], key_link) {
+			entry_destroy(entry);
+		}
+	}
+	free(cache.key_buckets);
+	free(cache.texture_buckets);
+	memset(&cache, 0, sizeof(cache));
+}
@@ -1,5 +1,8 @@
 #define _POSIX_C_SOURCE 200809L
+#include <math.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -10,20 +13,36 @@
 #include "sway/desktop/transaction.h"
 #include "sway/input/cursor.h"
 #include "sway/input/input-manager.h"
+#include "sway/ipc-json.h"
+#include "sway/ipc-server.h"
 #include "sway/output.h"
+#include "sway/trace.h"
 #include "sway/tree/container.h"
 #include "sway/tree/node.h"
+#include "sway/tree/root.h"
 #include "sway/tree/view.h"
 #include "sway/tree/workspace.h"
 #include "list.h"
 #include "log.h"
+#include "util.h"
+
+// Fast clients are never waited for less than this, three frames at 60Hz, so
+// that a single response slower than usual doesn't time out
+#define TXN_DEADLINE_MIN_MS 50
+// Clients which usually take longer to respond than even the shortest deadline
+// don't hold back a transaction once every other view is ready
+#define TXN_SLOW_CLIENT_MS TXN_DEADLINE_MIN_MS
+#define TXN_LATENCY_MIN_SAMPLES 4
 
 struct sway_transaction {
 	struct wl_event_source *timer;
 	list_t *instructions;   // struct sway_transaction_instruction *
 	size_t num_waiting;
 	size_t num_configures;
+	size_t num_slow; // configures sent to slow clients
+	size_t num_waiting_slow;
 	struct timespec commit_time;
+	bool timed_out;
 };
 
 struct sway_transaction_instruction {
@@ -35,6 +54,9 @@ struct sway_transaction_instruction {
 		struct sway_container_state container_state;
 	};
 	uint32_t serial;
+	bool waiting; // for the view to respond to the configure
+	bool slow; // the client is chronically slow to respond
+	uint32_t deadline_ms; // after which the view isn't waited for any more
 };
 
 static struct sway_transaction *transaction_create(void) {
@@ -188,9 +210,122 @@ static void transaction_add_node(struct sway_transaction *transaction,
 	node->ntxnrefs++;
 }
 
+static bool lists_equal(list_t *a, list_t *b) {
+	if (!a || !b || a->length != b->length) {
+		return false;
+	}
+	for (int i = 0; i < a->length; ++i) {
+		if (a->items[i] != b->items[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// These mirror the copy_*_state functions above, without allocating
+static bool output_state_changed(struct sway_output *output) {
+	struct sway_output_state *state = &output->current;
+	return !lists_equal(state->workspaces, output->workspaces) ||
+		state->active_workspace != output_get_active_workspace(output);
+}
+
+static bool workspace_state_changed(struct sway_workspace *ws) {
+	struct sway_workspace_state *state = &ws->current;
+	if (state->fullscreen != ws->fullscreen ||
+			state->x != ws->x || state->y != ws->y ||
+			state->width != ws->width || state->height != ws->height ||
+			state->layout != ws->layout || state->output != ws->output ||
+			!lists_equal(state->floating, ws->floating) ||
+			!lists_equal(state->tiling, ws->tiling)) {
+		return true;
+	}
+
+	struct sway_seat *seat = input_manager_current_seat();
+	if (state->focused != (seat_get_focus(seat) == &ws->node)) {
+		return true;
+	}
+	struct sway_container *focus = seat_get_focus_inactive_tiling(seat, ws);
+	if (focus) {
+		while (focus->parent) {
+			focus = focus->parent;
+		}
+	}
+	return state->focused_inactive_child != focus;
+}
+
+static bool container_state_changed(struct sway_container *con) {
+	struct sway_container_state *state = &con->current;
+	if (state->layout != con->layout ||
+			state->x != con->x || state->y != con->y ||
+			state->width != con->width || state->height != con->height ||
+			state->fullscreen_mode != con->fullscreen_mode ||
+			state->parent != con->parent ||
+			state->workspace != con->workspace ||
+			state->border != con->border ||
+			state->border_thickness != con->border_thickness ||
+			state->border_top != con->border_top ||
+			state->border_left != con->border_left ||
+			state->border_right != con->border_right ||
+			state->border_bottom != con->border_bottom ||
+			state->content_x != con->content_x ||
+			state->content_y != con->content_y ||
+			state->content_width != con->content_width ||
+			state->content_height != con->content_height) {
+		return true;
+	}
+	if (!con->view && !lists_equal(state->children, con->children)) {
+		return true;
+	}
+
+	struct sway_seat *seat = input_manager_current_seat();
+	if (state->focused != (seat_get_focus(seat) == &con->node)) {
+		return true;
+	}
+	if (!con->view) {
+		struct sway_node *focus =
+			seat_get_active_tiling_child(seat, &con->node);
+		if (state->focused_inactive_child !=
+				(focus ? focus->sway_container : NULL)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool transaction_node_changed(struct sway_node *node) {
+	// The current state only describes the node once it has been applied,
+	// and a transaction in flight will overwrite it with older state
+	if (node->dirty || node->destroying || !node->current_applied ||
+			node->ntxnrefs > 0) {
+		return true;
+	}
+	switch (node->type) {
+	case N_ROOT:
+		return true;
+	case N_OUTPUT:
+		return output_state_changed(node->sway_output);
+	case N_WORKSPACE:
+		return workspace_state_changed(node->sway_workspace);
+	case N_CONTAINER:
+		return container_state_changed(node->sway_container);
+	}
+	return true;
+}
+
+static void release_textures_iterator(struct sway_container *con,
+		void *data) {
+	container_release_textures(con);
+}
+
 static void apply_output_state(struct sway_output *output,
 		struct sway_output_state *state) {
 	output_damage_whole(output);
+	// Titlebars of a workspace which is no longer shown don't need textures
+	struct sway_workspace *old_ws = output->current.active_workspace;
+	if (old_ws && old_ws != state->active_workspace &&
+			!old_ws->node.destroying) {
+		workspace_for_each_container(old_ws, release_textures_iterator, NULL);
+	}
 	list_free(output->current.workspaces);
 	memcpy(&output->current, state, sizeof(struct sway_output_state));
 	output_damage_whole(output);
@@ -279,6 +414,11 @@ static void apply_container_state(struct sway_container *container,
  */
 static void transaction_apply(struct sway_transaction *transaction) {
 	sway_log(SWAY_DEBUG, "Applying transaction %p", transaction);
+	struct timespec apply_start;
+	bool tracing = trace_is_active();
+	if (tracing) {
+		clock_gettime(CLOCK_MONOTONIC, &apply_start);
+	}
 	if (debug.txn_timings) {
 		struct timespec now;
 		clock_gettime(CLOCK_MONOTONIC, &now);
@@ -289,7 +429,9 @@ static void transaction_apply(struct sway_transaction *transaction) {
 				"(%.1f frames if 60Hz)", transaction, ms, ms / (1000.0f / 60));
 	}
 
-	// Apply the instruction state to the node's current state
+	// Apply the instruction state to the node's current state, describing
+	// the changes for tree event subscribers first
+	json_object *deltas = ipc_event_tree_begin();
 	for (int i = 0; i < transaction->instructions->length; ++i) {
 		struct sway_transaction_instruction *instruction =
 			transaction->instructions->items[i];
@@ -299,22 +441,52 @@ static void transaction_apply(struct sway_transaction *transaction) {
 		case N_ROOT:
 			break;
 		case N_OUTPUT:
+			if (deltas) {
+				ipc_json_describe_output_delta(deltas, node->sway_output,
+						&instruction->output_state);
+			}
 			apply_output_state(node->sway_output, &instruction->output_state);
 			break;
 		case N_WORKSPACE:
+			if (deltas) {
+				ipc_json_describe_workspace_delta(deltas,
+						node->sway_workspace, &instruction->workspace_state);
+			}
 			apply_workspace_state(node->sway_workspace,
 					&instruction->workspace_state);
 			break;
 		case N_CONTAINER:
+			if (deltas) {
+				ipc_json_describe_container_delta(deltas,
+						node->sway_container, &instruction->container_state);
+			}
 			apply_container_state(node->sway_container,
 					&instruction->container_state);
 			break;
 		}
 
 		node->instruction = NULL;
+		node->current_applied = !node->destroying;
 	}
+	ipc_event_tree(deltas);
 
 	cursor_rebase_all();
+
+	if (tracing) {
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		trace_span("transactions", "transaction_apply", &apply_start, &now,
+				NULL);
+		json_object *args = json_object_new_object();
+		json_object_object_add(args, "instructions",
+				json_object_new_int(transaction->instructions->length));
+		json_object_object_add(args, "configures",
+				json_object_new_int(transaction->num_configures));
+		json_object_object_add(args, "timed_out",
+				json_object_new_boolean(transaction->timed_out));
+		trace_span("transactions", "transaction",
+				&transaction->commit_time, &now, args);
+	}
 }
 
 static void transaction_commit(struct sway_transaction *transaction);
@@ -374,10 +546,207 @@ static void transaction_progress_queue(void) {
 	transaction_progress_queue();
 }
 
+static void trace_configure(struct sway_transaction_instruction *instruction,
+		bool timed_out) {
+	struct sway_transaction *transaction = instruction->transaction;
+	struct sway_view *view = instruction->node->sway_container->view;
+	const char *app_id = NULL, *title = NULL;
+	if (view->surface) {
+		app_id = view_get_app_id(view);
+		if (!app_id) {
+			app_id = view_get_class(view);
+		}
+		title = view_get_title(view);
+	}
+	char name[128];
+	snprintf(name, sizeof(name), "configure %s", app_id ? app_id : "unknown");
+
+	json_object *args = json_object_new_object();
+	json_object_object_add(args, "title",
+			title ? json_object_new_string(title) : NULL);
+	json_object_object_add(args, "serial",
+			json_object_new_int(instruction->serial));
+	json_object_object_add(args, "width", json_object_new_int(
+				instruction->container_state.content_width));
+	json_object_object_add(args, "height", json_object_new_int(
+				instruction->container_state.content_height));
+	json_object_object_add(args, "timed_out",
+			json_object_new_boolean(timed_out));
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	trace_async_span(name, (uintptr_t)instruction, &transaction->commit_time,
+			&now, args);
+}
+
+struct client_latency {
+	struct wl_listener destroy;
+	struct sway_configure_latency latency;
+};
+
+static void handle_client_destroy(struct wl_listener *listener, void *data) {
+	struct client_latency *client =
+		wl_container_of(listener, client, destroy);
+	wl_list_remove(&client->destroy.link);
+	free(client);
+}
+
+static struct sway_configure_latency *view_get_configure_latency(
+		struct sway_view *view) {
+#if HAVE_XWAYLAND
+	if (view->type == SWAY_VIEW_XWAYLAND) {
+		return &view->configure_latency;
+	}
+#endif
+	if (!view->surface) {
+		return NULL;
+	}
+	struct wl_client *wl_client =
+		wl_resource_get_client(view->surface->resource);
+	struct wl_listener *listener =
+		wl_client_get_destroy_listener(wl_client, handle_client_destroy);
+	if (listener) {
+		struct client_latency *client =
+			wl_container_of(listener, client, destroy);
+		return &client->latency;
+	}
+
+	struct client_latency *client = calloc(1, sizeof(struct client_latency));
+	if (!client) {
+		sway_log(SWAY_ERROR, "Unable to allocate client latency");
+		return NULL;
+	}
+	client->destroy.notify = handle_client_destroy;
+	wl_client_add_destroy_listener(wl_client, &client->destroy);
+	return &client->latency;
+}
+
+static void latency_add_sample(struct sway_configure_latency *latency,
+		double ms) {
+	if (latency->samples++ == 0) {
+		latency->srtt_ms = ms;
+		latency->rttvar_ms = ms / 2;
+		return;
+	}
+	double err = ms - latency->srtt_ms;
+	latency->srtt_ms += err / 8;
+	latency->rttvar_ms += (fabs(err) - latency->rttvar_ms) / 4;
+}
+
+static uint32_t latency_deadline(struct sway_configure_latency *latency) {
+	uint32_t timeout = server.txn_timeout_ms;
+	if (!latency || latency->samples < TXN_LATENCY_MIN_SAMPLES) {
+		return timeout;
+	}
+	double deadline = latency->srtt_ms + 4 * latency->rttvar_ms;
+	if (deadline < TXN_DEADLINE_MIN_MS) {
+		deadline = TXN_DEADLINE_MIN_MS;
+	}
+	return deadline < timeout ? ceil(deadline) : timeout;
+}
+
+static bool latency_is_slow(struct sway_configure_latency *latency) {
+	return latency && latency->samples >= TXN_LATENCY_MIN_SAMPLES &&
+		latency->srtt_ms > TXN_SLOW_CLIENT_MS;
+}
+
+static double transaction_elapsed_ms(struct sway_transaction *transaction) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return timespec_sub_nsec(&now, &transaction->commit_time) / 1000000.0;
+}
+
+/**
+ * Stop waiting for a view. Like after a timeout, it shows whatever it last
+ * committed until it catches up.
+ */
+static void exclude_instruction(
+		struct sway_transaction_instruction *instruction) {
+	struct sway_transaction *transaction = instruction->transaction;
+	struct sway_view *view = instruction->node->sway_container->view;
+	// Its latency is sampled once it responds, see sample_late_configure
+	view->late_configure.pending = true;
+	view->late_configure.serial = instruction->serial;
+	view->late_configure.width = instruction->container_state.content_width;
+	view->late_configure.height = instruction->container_state.content_height;
+	view->late_configure.sent = transaction->commit_time;
+	if (trace_is_active()) {
+		trace_configure(instruction, true);
+	}
+	instruction->waiting = false;
+	if (instruction->slow) {
+		--transaction->num_waiting_slow;
+	}
+	if (transaction->num_waiting > 0) {
+		--transaction->num_waiting;
+	}
+}
+
+/**
+ * Once every other view is ready, don't hold the transaction back for views of
+ * chronically slow clients.
+ */
+static void exclude_slow_instructions(struct sway_transaction *transaction) {
+	if (!transaction->num_waiting ||
+			transaction->num_waiting != transaction->num_waiting_slow ||
+			transaction->num_slow == transaction->num_configures) {
+		return;
+	}
+	sway_log(SWAY_DEBUG, "Transaction %p: not waiting for %zi slow views",
+			transaction, transaction->num_waiting_slow);
+	for (int i = 0; i < transaction->instructions->length; ++i) {
+		struct sway_transaction_instruction *instruction =
+			transaction->instructions->items[i];
+		if (instruction->waiting) {
+			exclude_instruction(instruction);
+		}
+	}
+}
+
 static int handle_timeout(void *data) {
 	struct sway_transaction *transaction = data;
-	sway_log(SWAY_DEBUG, "Transaction %p timed out (%zi waiting)",
-			transaction, transaction->num_waiting);
+	double elapsed = transaction_elapsed_ms(transaction);
+	uint32_t next_deadline = UINT32_MAX;
+	size_t num_timed_out = 0;
+	for (int i = 0; i < transaction->instructions->length; ++i) {
+		struct sway_transaction_instruction *instruction =
+			transaction->instructions->items[i];
+		if (!instruction->waiting) {
+			continue;
+		}
+		if (debug.txn_wait || instruction->deadline_ms <= elapsed) {
+			exclude_instruction(instruction);
+			++num_timed_out;
+		} else if (instruction->deadline_ms < next_deadline) {
+			next_deadline = instruction->deadline_ms;
+		}
+	}
+	if (debug.txn_wait) {
+		// The waiting counter was inflated to force the timeout
+		transaction->num_waiting = 0;
+	}
+	transaction->timed_out = true;
+	exclude_slow_instructions(transaction);
+
+	sway_log(SWAY_DEBUG, "Transaction %p timed out for %zi views "
+			"(%zi still waiting)", transaction, num_timed_out,
+			transaction->num_waiting);
+	if (trace_is_active()) {
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		json_object *args = json_object_new_object();
+		json_object_object_add(args, "timed_out",
+				json_object_new_int(num_timed_out));
+		json_object_object_add(args, "waiting",
+				json_object_new_int(transaction->num_waiting));
+		trace_instant("transactions", "transaction_timeout", &now, args);
+	}
+
+	if (transaction->num_waiting && next_deadline != UINT32_MAX) {
+		int delay = ceil(next_deadline - elapsed);
+		wl_event_source_timer_update(transaction->timer, delay > 0 ? delay : 1);
+		return 0;
+	}
 	transaction->num_waiting = 0;
 	transaction_progress_queue();
 	return 0;
@@ -414,6 +783,8 @@ static void transaction_commit(struct sway_transaction *transaction) {
 	sway_log(SWAY_DEBUG, "Transaction %p committing with %i instructions",
 			transaction, transaction->instructions->length);
 	transaction->num_waiting = 0;
+	clock_gettime(CLOCK_MONOTONIC, &transaction->commit_time);
+	uint32_t timeout_ms = server.txn_timeout_ms;
 	for (int i = 0; i < transaction->instructions->length; ++i) {
 		struct sway_transaction_instruction *instruction =
 			transaction->instructions->items[i];
@@ -425,6 +796,21 @@ static void transaction_commit(struct sway_transaction *transaction) {
 					instruction->container_state.content_width,
 					instruction->container_state.content_height);
 			++transaction->num_waiting;
+			instruction->waiting = true;
+
+			// Views are waited for according to how fast their client
+			// usually responds
+			struct sway_configure_latency *latency =
+				view_get_configure_latency(node->sway_container->view);
+			instruction->deadline_ms = latency_deadline(latency);
+			if (instruction->deadline_ms < timeout_ms) {
+				timeout_ms = instruction->deadline_ms;
+			}
+			instruction->slow = latency_is_slow(latency);
+			if (instruction->slow) {
+				++transaction->num_slow;
+				++transaction->num_waiting_slow;
+			}
 
 			// From here on we are rendering a saved buffer of the view, which
 			// means we can send a frame done event to make the client redraw it
@@ -444,15 +830,13 @@ static void transaction_commit(struct sway_transaction *transaction) {
 		node->instruction = instruction;
 	}
 	transaction->num_configures = transaction->num_waiting;
-	if (debug.txn_timings) {
-		clock_gettime(CLOCK_MONOTONIC, &transaction->commit_time);
-	}
 	if (debug.noatomic) {
 		transaction->num_waiting = 0;
 	} else if (debug.txn_wait) {
 		// Force the transaction to time out even if all views are ready.
 		// We do this by inflating the waiting counter.
 		transaction->num_waiting += 1000000;
+		timeout_ms = server.txn_timeout_ms;
 	}
 
 	if (transaction->num_waiting) {
@@ -460,8 +844,7 @@ static void transaction_commit(struct sway_transaction *transaction) {
 		transaction->timer = wl_event_loop_add_timer(server.wl_event_loop,
 				handle_timeout, transaction);
 		if (transaction->timer) {
-			wl_event_source_timer_update(transaction->timer,
-					server.txn_timeout_ms);
+			wl_event_source_timer_update(transaction->timer, timeout_ms);
 		} else {
 			sway_log_errno(SWAY_ERROR, "Unable to create transaction timer "
 					"(some imperfect frames might be rendered)");
@@ -487,18 +870,61 @@ static void set_instruction_ready(
 				instruction->node->sway_container->title);
 	}
 
-	// If the transaction has timed out then its num_waiting will be 0 already.
-	if (transaction->num_waiting > 0 && --transaction->num_waiting == 0) {
-		sway_log(SWAY_DEBUG, "Transaction %p is ready", transaction);
-		wl_event_source_timer_update(transaction->timer, 0);
+	// A view which isn't waited for any more might still respond late
+	if (instruction->waiting) {
+		struct sway_view *view = instruction->node->sway_container->view;
+		struct sway_configure_latency *latency =
+			view_get_configure_latency(view);
+		if (latency) {
+			latency_add_sample(latency, transaction_elapsed_ms(transaction));
+		}
+		// An earlier configure which timed out won't be responded to any more
+		view->late_configure.pending = false;
+		if (trace_is_active()) {
+			trace_configure(instruction, false);
+		}
+		instruction->waiting = false;
+		if (instruction->slow) {
+			--transaction->num_waiting_slow;
+		}
+
+		// If the transaction has timed out then its num_waiting will be 0
+		// already.
+		if (transaction->num_waiting > 0) {
+			--transaction->num_waiting;
+			exclude_slow_instructions(transaction);
+			if (transaction->num_waiting == 0) {
+				sway_log(SWAY_DEBUG, "Transaction %p is ready", transaction);
+				wl_event_source_timer_update(transaction->timer, 0);
+			}
+		}
 	}
 
 	instruction->node->instruction = NULL;
 	transaction_progress_queue();
 }
 
+/**
+ * Sample the latency of a response to a configure which was no longer waited
+ * for, even if its transaction has been applied since.
+ */
+static void sample_late_configure(struct sway_view *view) {
+	view->late_configure.pending = false;
+	struct sway_configure_latency *latency = view_get_configure_latency(view);
+	if (latency) {
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		latency_add_sample(latency,
+				timespec_sub_nsec(&now, &view->late_configure.sent) / 1000000.0);
+	}
+}
+
 void transaction_notify_view_ready_by_serial(struct sway_view *view,
 		uint32_t serial) {
+	if (view->late_configure.pending &&
+			view->late_configure.serial == serial) {
+		sample_late_configure(view);
+	}
 	struct sway_transaction_instruction *instruction =
 		view->container->node.instruction;
 	if (instruction != NULL && instruction->serial == serial) {
@@ -510,14 +936,26 @@ void transaction_notify_view_ready_by_size(struct sway_view *view,
 		int width, int height) {
 	struct sway_transaction_instruction *instruction =
 		view->container->node.instruction;
-	if (instruction != NULL &&
-			instruction->container_state.content_width == width &&
-			instruction->container_state.content_height == height) {
+	bool matches = instruction != NULL &&
+		instruction->container_state.content_width == width &&
+		instruction->container_state.content_height == height;
+	// Sizes can repeat, a response to the configure waited for isn't late
+	if (view->late_configure.pending &&
+			view->late_configure.width == width &&
+			view->late_configure.height == height &&
+			!(matches && instruction->waiting)) {
+		sample_late_configure(view);
+	}
+	if (matches) {
 		set_instruction_ready(instruction);
 	}
 }
 
-void transaction_commit_dirty(void) {
+static void commit_dirty_nodes(void) {
+	if (server.txn_batch_timer) {
+		wl_event_source_timer_update(server.txn_batch_timer, 0);
+	}
+	server.txn_batch_pending = false;
 	if (!server.dirty_nodes->length) {
 		return;
 	}
@@ -542,3 +980,59 @@ void transaction_commit_dirty(void) {
 		transaction_progress_queue();
 	}
 }
+
+static int handle_batch_timeout(void *data) {
+	commit_dirty_nodes();
+	return 0;
+}
+
+// Returns false if the dirty nodes have to be committed right away
+static bool schedule_batch(void) {
+	if (server.txn_batch_pending) {
+		return true;
+	}
+	if (server.txn_batch_frame) {
+		for (int i = 0; i < root->outputs->length; ++i) {
+			struct sway_output *output = root->outputs->items[i];
+			if (output->enabled && output->wlr_output->enabled) {
+				wlr_output_schedule_frame(output->wlr_output);
+				server.txn_batch_pending = true;
+			}
+		}
+		return server.txn_batch_pending;
+	}
+	if (!server.txn_batch_timer) {
+		server.txn_batch_timer = wl_event_loop_add_timer(server.wl_event_loop,
+				handle_batch_timeout, NULL);
+		if (!server.txn_batch_timer) {
+			sway_log_errno(SWAY_ERROR, "Unable to create transaction batch "
+					"timer");
+			return false;
+		}
+	}
+	wl_event_source_timer_update(server.txn_batch_timer, server.txn_batch_ms);
+	server.txn_batch_pending = true;
+	return true;
+}
+
+void transaction_commit_dirty(void) {
+	if (!server.dirty_nodes->length) {
+		return;
+	}
+	if ((server.txn_batch_ms || server.txn_batch_frame) && schedule_batch()) {
+		return;
+	}
+	commit_dirty_nodes();
+}
+
+void transaction_commit_dirty_now(void) {
+	if (server.dirty_nodes->length) {
+		commit_dirty_nodes();
+	}
+}
+
+void transaction_flush_batch(void) {
+	if (server.txn_batch_pending) {
+		commit_dirty_nodes();
+	}
+}
@@ -7,6 +7,7 @@
 #include <wlr/types/wlr_output.h>
 #include <wlr/xwayland.h>
 #include "log.h"
+#include "sway/criteria.h"
 #include "sway/desktop.h"
 #include "sway/desktop/transaction.h"
 #include "sway/input/cursor.h"
@@ -577,6 +578,7 @@ static void handle_set_title(struct wl_listener *listener, void *data) {
 		return;
 	}
 	view_update_title(view, false);
+	criteria_invalidate_view(view);
 	view_execute_criteria(view);
 }
 
@@ -588,6 +590,7 @@ static void handle_set_class(struct wl_listener *listener, void *data) {
 	if (!xsurface->mapped) {
 		return;
 	}
+	criteria_invalidate_view(view);
 	view_execute_criteria(view);
 }
 
@@ -599,6 +602,7 @@ static void handle_set_role(struct wl_listener *listener, void *data) {
 	if (!xsurface->mapped) {
 		return;
 	}
+	criteria_invalidate_view(view);
 	view_execute_criteria(view);
 }
 
@@ -610,6 +614,7 @@ static void handle_set_window_type(struct wl_listener *listener, void *data) {
 	if (!xsurface->mapped) {
 		return;
 	}
+	criteria_invalidate_view(view);
 	view_execute_criteria(view);
 }
 
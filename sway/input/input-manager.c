@@ -581,6 +581,24 @@ void input_manager_reset_all_inputs(void) {
 	}
 }
 
+void input_manager_forget_bindings(void) {
+	struct sway_seat *seat;
+	wl_list_for_each(seat, &server.input->seats, link) {
+		struct sway_seat_device *seat_device;
+		wl_list_for_each(seat_device, &seat->devices, link) {
+			if (seat_device->keyboard) {
+				sway_keyboard_disarm_key_repeat(seat_device->keyboard);
+				seat_device->keyboard->held_binding = NULL;
+			}
+		}
+		struct sway_keyboard_group *group;
+		wl_list_for_each(group, &seat->keyboard_groups, link) {
+			sway_keyboard_disarm_key_repeat(group->seat_device->keyboard);
+			group->seat_device->keyboard->held_binding = NULL;
+		}
+	}
+}
+
 void input_manager_apply_seat_config(struct seat_config *seat_config) {
 	sway_log(SWAY_DEBUG, "applying seat config for seat %s", seat_config->name);
 	if (strcmp(seat_config->name, "*") == 0) {
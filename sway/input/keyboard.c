@@ -15,6 +15,7 @@
 #include "sway/input/seat.h"
 #include "sway/ipc-server.h"
 #include "log.h"
+#include "stringop.h"
 
 static struct modifier_key {
 	char *name;
@@ -148,46 +149,52 @@ static bool update_shortcut_state(struct sway_shortcut_state *state,
 /**
  * If one exists, finds a binding which matches the shortcut model state,
  * current modifiers, release state, and locked state.
+ *
+ * The input must be interned, so that it can be compared to the bindings'
+ * inputs by pointer.
  */
 static void get_active_binding(const struct sway_shortcut_state *state,
-		list_t *bindings, struct sway_binding **current_binding,
-		uint32_t modifiers, bool release, bool locked, bool inhibited,
-		const char *input, bool exact_input, xkb_layout_index_t group) {
-	for (int i = 0; i < bindings->length; ++i) {
-		struct sway_binding *binding = bindings->items[i];
+		list_t *bindings, struct sway_binding_index *index,
+		struct sway_binding **current_binding, uint32_t modifiers,
+		bool release, bool locked, bool inhibited, const char *input,
+		bool exact_input, xkb_layout_index_t group) {
+	static const char *any_input = NULL;
+	if (!any_input) {
+		any_input = intern_string("*");
+	}
+
+	// Bindings matching exactly the pressed keys and, if those are not a
+	// single key, single-key bindings matching the newly-pressed key. Both are
+	// visited in binding list order, as the tie-breaking below depends on it.
+	const struct binding_index_slot *exact = binding_index_find(index,
+			bindings, modifiers, release, state->pressed_keys,
+			state->npressed);
+	const struct binding_index_slot *single = NULL;
+	if (state->npressed != 1) {
+		single = binding_index_find(index, bindings, modifiers, release,
+				&state->current_key, 1);
+	}
+	int exact_len = exact ? exact->len : 0;
+	int single_len = single ? single->len : 0;
+
+	int i = 0, j = 0;
+	while (i < exact_len || j < single_len) {
+		struct sway_binding *binding;
+		if (j == single_len || (i < exact_len &&
+				exact->matches[i].position < single->matches[j].position)) {
+			binding = exact->matches[i++].binding;
+		} else {
+			binding = single->matches[j++].binding;
+		}
 		bool binding_locked = (binding->flags & BINDING_LOCKED) != 0;
 		bool binding_inhibited = (binding->flags & BINDING_INHIBITED) != 0;
-		bool binding_release = binding->flags & BINDING_RELEASE;
 
-		if (modifiers ^ binding->modifiers ||
-				release != binding_release ||
-				locked > binding_locked ||
+		if (locked > binding_locked ||
 				inhibited > binding_inhibited ||
 				(binding->group != XKB_LAYOUT_INVALID &&
 				 binding->group != group) ||
-				(strcmp(binding->input, input) != 0 &&
-				 (strcmp(binding->input, "*") != 0 || exact_input))) {
-			continue;
-		}
-
-		bool match = false;
-		if (state->npressed == (size_t)binding->keys->length) {
-			match = true;
-			for (size_t j = 0; j < state->npressed; j++) {
-				uint32_t key = *(uint32_t *)binding->keys->items[j];
-				if (key != state->pressed_keys[j]) {
-					match = false;
-					break;
-				}
-			}
-		} else if (binding->keys->length == 1) {
-			/*
-			 * If no multiple-key binding has matched, try looking for
-			 * single-key bindings that match the newly-pressed key.
-			 */
-			match = state->current_key == *(uint32_t *)binding->keys->items[0];
-		}
-		if (!match) {
+				(binding->input != input &&
+				 (binding->input != any_input || exact_input))) {
 			continue;
 		}
 
@@ -200,10 +207,10 @@ static void get_active_binding(const struct sway_shortcut_state *state,
 				((*current_binding)->flags & BINDING_LOCKED) != 0;
 			bool current_inhibited =
 				((*current_binding)->flags & BINDING_INHIBITED) != 0;
-			bool current_input = strcmp((*current_binding)->input, input) == 0;
+			bool current_input = (*current_binding)->input == input;
 			bool current_group_set =
 				(*current_binding)->group != XKB_LAYOUT_INVALID;
-			bool binding_input = strcmp(binding->input, input) == 0;
+			bool binding_input = binding->input == input;
 			bool binding_group_set = binding->group != XKB_LAYOUT_INVALID;
 
 			if (current_input == binding_input
@@ -242,7 +249,7 @@ static void get_active_binding(const struct sway_shortcut_state *state,
 		}
 
 		*current_binding = binding;
-		if (strcmp((*current_binding)->input, input) == 0 &&
+		if ((*current_binding)->input == input &&
 				(((*current_binding)->flags & BINDING_LOCKED) == locked) &&
 				(((*current_binding)->flags & BINDING_INHIBITED) == inhibited) &&
 				(*current_binding)->group == group) {
@@ -384,7 +391,6 @@ static void handle_key_event(struct sway_keyboard *keyboard,
 	struct wlr_seat *wlr_seat = seat->wlr_seat;
 	struct wlr_input_device *wlr_device =
 		keyboard->seat_device->input_device->wlr_device;
-	char *device_identifier = input_device_get_identifier(wlr_device);
 	bool exact_identifier = wlr_device->keyboard->group != NULL;
 	seat_idle_notify_activity(seat, IDLE_SOURCE_KEYBOARD);
 	bool input_inhibited = seat->exclusive_client != NULL;
@@ -400,19 +406,22 @@ static void handle_key_event(struct sway_keyboard *keyboard,
 	// Identify active release binding
 	struct sway_binding *binding_released = NULL;
 	get_active_binding(&keyboard->state_keycodes,
-			config->current_mode->keycode_bindings, &binding_released,
+			config->current_mode->keycode_bindings,
+			&config->current_mode->keycode_index, &binding_released,
 			keyinfo.code_modifiers, true, input_inhibited,
-			shortcuts_inhibited, device_identifier,
+			shortcuts_inhibited, keyboard->identifier,
 			exact_identifier, keyboard->effective_layout);
 	get_active_binding(&keyboard->state_keysyms_raw,
-			config->current_mode->keysym_bindings, &binding_released,
+			config->current_mode->keysym_bindings,
+			&config->current_mode->keysym_index, &binding_released,
 			keyinfo.raw_modifiers, true, input_inhibited,
-			shortcuts_inhibited, device_identifier,
+			shortcuts_inhibited, keyboard->identifier,
 			exact_identifier, keyboard->effective_layout);
 	get_active_binding(&keyboard->state_keysyms_translated,
-			config->current_mode->keysym_bindings, &binding_released,
+			config->current_mode->keysym_bindings,
+			&config->current_mode->keysym_index, &binding_released,
 			keyinfo.translated_modifiers, true, input_inhibited,
-			shortcuts_inhibited, device_identifier,
+			shortcuts_inhibited, keyboard->identifier,
 			exact_identifier, keyboard->effective_layout);
 
 	// Execute stored release binding once no longer active
@@ -432,19 +441,22 @@ static void handle_key_event(struct sway_keyboard *keyboard,
 	struct sway_binding *binding = NULL;
 	if (event->state == WLR_KEY_PRESSED) {
 		get_active_binding(&keyboard->state_keycodes,
-				config->current_mode->keycode_bindings, &binding,
+				config->current_mode->keycode_bindings,
+				&config->current_mode->keycode_index, &binding,
 				keyinfo.code_modifiers, false, input_inhibited,
-				shortcuts_inhibited, device_identifier,
+				shortcuts_inhibited, keyboard->identifier,
 				exact_identifier, keyboard->effective_layout);
 		get_active_binding(&keyboard->state_keysyms_raw,
-				config->current_mode->keysym_bindings, &binding,
+				config->current_mode->keysym_bindings,
+				&config->current_mode->keysym_index, &binding,
 				keyinfo.raw_modifiers, false, input_inhibited,
-				shortcuts_inhibited, device_identifier,
+				shortcuts_inhibited, keyboard->identifier,
 				exact_identifier, keyboard->effective_layout);
 		get_active_binding(&keyboard->state_keysyms_translated,
-				config->current_mode->keysym_bindings, &binding,
+				config->current_mode->keysym_bindings,
+				&config->current_mode->keysym_index, &binding,
 				keyinfo.translated_modifiers, false, input_inhibited,
-				shortcuts_inhibited, device_identifier,
+				shortcuts_inhibited, keyboard->identifier,
 				exact_identifier, keyboard->effective_layout);
 	}
 
@@ -468,7 +480,6 @@ static void handle_key_event(struct sway_keyboard *keyboard,
 
 	if (!handled && wlr_device->keyboard->group) {
 		// Only handle device specific bindings for keyboards in a group
-		free(device_identifier);
 		return;
 	}
 
@@ -496,8 +507,6 @@ static void handle_key_event(struct sway_keyboard *keyboard,
 	}
 
 	transaction_commit_dirty();
-
-	free(device_identifier);
 }
 
 static void handle_keyboard_key(struct wl_listener *listener, void *data) {
@@ -653,6 +662,14 @@ struct sway_keyboard *sway_keyboard_create(struct sway_seat *seat,
 	keyboard->seat_device = device;
 	device->keyboard = keyboard;
 
+	// Keyboard groups have no identifier in their input device
+	char *identifier =
+		input_device_get_identifier(device->input_device->wlr_device);
+	if (identifier) {
+		keyboard->identifier = intern_string(identifier);
+		free(identifier);
+	}
+
 	wl_list_init(&keyboard->keyboard_key.link);
 	wl_list_init(&keyboard->keyboard_modifiers.link);
 
@@ -1486,6 +1486,11 @@ void seat_consider_warp_to_focus(struct sway_seat *seat) {
 	}
 }
 
+void seatop_discard_pointer_motion(struct sway_seat *seat) {
+	seat->coalesced_motion.pending = false;
+	seat->coalesced_motion.dx = seat->coalesced_motion.dy = 0;
+}
+
 void seatop_unref(struct sway_seat *seat, struct sway_container *con) {
 	if (seat->seatop_impl->unref) {
 		seat->seatop_impl->unref(seat, con);
@@ -1495,14 +1500,55 @@ void seatop_unref(struct sway_seat *seat, struct sway_container *con) {
 void seatop_button(struct sway_seat *seat, uint32_t time_msec,
 		struct wlr_input_device *device, uint32_t button,
 		enum wlr_button_state state) {
+	seatop_flush_pointer_motion(seat);
 	if (seat->seatop_impl->button) {
 		seat->seatop_impl->button(seat, time_msec, device, button, state);
 	}
 }
 
+static bool seat_coalesces_motion(struct sway_seat *seat) {
+	struct seat_config *sc = seat_get_config(seat);
+	if (!sc) {
+		sc = seat_get_config_by_name("*");
+	}
+	return sc && sc->coalesce_motion == COALESCE_MOTION_ENABLE;
+}
+
 void seatop_pointer_motion(struct sway_seat *seat, uint32_t time_msec,
 		double dx, double dy) {
-	if (seat->seatop_impl->pointer_motion) {
+	if (!seat->seatop_impl->pointer_motion) {
+		return;
+	}
+	if (seat->seatop_impl->coalesce_motion && seat_coalesces_motion(seat)) {
+		struct wlr_output *wlr_output = wlr_output_layout_output_at(
+				root->output_layout, seat->cursor->cursor->x,
+				seat->cursor->cursor->y);
+		struct sway_output *output = wlr_output ? wlr_output->data : NULL;
+		if (output && output->enabled) {
+			if (!seat->coalesced_motion.pending) {
+				wlr_output_schedule_frame(output->wlr_output);
+			}
+			seat->coalesced_motion.pending = true;
+			seat->coalesced_motion.time_msec = time_msec;
+			seat->coalesced_motion.dx += dx;
+			seat->coalesced_motion.dy += dy;
+			return;
+		}
+	}
+	seatop_flush_pointer_motion(seat);
+	seat->seatop_impl->pointer_motion(seat, time_msec, dx, dy);
+}
+
+void seatop_flush_pointer_motion(struct sway_seat *seat) {
+	if (!seat->coalesced_motion.pending) {
+		return;
+	}
+	uint32_t time_msec = seat->coalesced_motion.time_msec;
+	double dx = seat->coalesced_motion.dx;
+	double dy = seat->coalesced_motion.dy;
+	seat->coalesced_motion.pending = false;
+	seat->coalesced_motion.dx = seat->coalesced_motion.dy = 0;
+	if (seat->seatop_impl && seat->seatop_impl->pointer_motion) {
 		seat->seatop_impl->pointer_motion(seat, time_msec, dx, dy);
 	}
 }
@@ -1517,6 +1563,7 @@ void seatop_pointer_axis(struct sway_seat *seat,
 void seatop_tablet_tool_tip(struct sway_seat *seat,
 		struct sway_tablet_tool *tool, uint32_t time_msec,
 		enum wlr_tablet_tool_tip_state state) {
+	seatop_flush_pointer_motion(seat);
 	if (seat->seatop_impl->tablet_tool_tip) {
 		seat->seatop_impl->tablet_tool_tip(seat, tool, time_msec, state);
 	}
@@ -1532,12 +1579,14 @@ void seatop_tablet_tool_motion(struct sway_seat *seat,
 }
 
 void seatop_rebase(struct sway_seat *seat, uint32_t time_msec) {
+	seatop_flush_pointer_motion(seat);
 	if (seat->seatop_impl->rebase) {
 		seat->seatop_impl->rebase(seat, time_msec);
 	}
 }
 
 void seatop_end(struct sway_seat *seat) {
+	seatop_flush_pointer_motion(seat);
 	if (seat->seatop_impl && seat->seatop_impl->end) {
 		seat->seatop_impl->end(seat);
 	}
@@ -46,6 +46,8 @@ static void handle_pointer_motion(struct sway_seat *seat, uint32_t time_msec,
 static void handle_unref(struct sway_seat *seat, struct sway_container *con) {
 	struct seatop_move_floating_event *e = seat->seatop_data;
 	if (e->con == con) {
+		// Don't move or resize a container which is going away
+		seatop_discard_pointer_motion(seat);
 		seatop_begin_default(seat);
 	}
 }
@@ -55,6 +57,7 @@ static const struct sway_seatop_impl seatop_impl = {
 	.pointer_motion = handle_pointer_motion,
 	.tablet_tool_tip = handle_tablet_tool_tip,
 	.unref = handle_unref,
+	.coalesce_motion = true,
 };
 
 void seatop_begin_move_floating(struct sway_seat *seat,
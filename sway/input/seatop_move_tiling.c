@@ -314,11 +314,15 @@ static void handle_tablet_tool_tip(struct sway_seat *seat,
 
 static void handle_unref(struct sway_seat *seat, struct sway_container *con) {
 	struct seatop_move_tiling_event *e = seat->seatop_data;
-	if (e->target_node == &con->node) { // Drop target
-		e->target_node = NULL;
-	}
 	if (e->con == con) { // The container being moved
+		seatop_discard_pointer_motion(seat);
 		seatop_begin_default(seat);
+		return;
+	}
+	// Pick the drop target from the motion so far before letting go of it
+	seatop_flush_pointer_motion(seat);
+	if (e->target_node == &con->node) { // Drop target
+		e->target_node = NULL;
 	}
 }
 
@@ -328,6 +332,7 @@ static const struct sway_seatop_impl seatop_impl = {
 	.tablet_tool_tip = handle_tablet_tool_tip,
 	.unref = handle_unref,
 	.render = handle_render,
+	.coalesce_motion = true,
 };
 
 void seatop_begin_move_tiling_threshold(struct sway_seat *seat,
@@ -1,11 +1,14 @@
 #include <json.h>
 #include <libevdev/libevdev.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <ctype.h>
 #include "config.h"
 #include "log.h"
 #include "sway/config.h"
 #include "sway/ipc-json.h"
+#include "sway/json-writer.h"
 #include "sway/tree/container.h"
 #include "sway/tree/view.h"
 #include "sway/tree/workspace.h"
@@ -19,6 +22,7 @@
 #include <xkbcommon/xkbcommon.h>
 #include "wlr-layer-shell-unstable-v1-protocol.h"
 #include "sway/desktop/idle_inhibit_v1.h"
+#include "sway/desktop/titlebar_cache.h"
 
 static const int i3_output_id = INT32_MAX;
 static const int i3_scratch_id = INT32_MAX - 1;
@@ -183,133 +187,6 @@ static json_object *ipc_json_create_rect(struct wlr_box *box) {
 	return rect;
 }
 
-static json_object *ipc_json_create_empty_rect(void) {
-	struct wlr_box empty = {0, 0, 0, 0};
-
-	return ipc_json_create_rect(&empty);
-}
-
-static json_object *ipc_json_create_node(int id, char *name,
-		bool focused, json_object *focus, struct wlr_box *box) {
-	json_object *object = json_object_new_object();
-
-	json_object_object_add(object, "id", json_object_new_int(id));
-	json_object_object_add(object, "name",
-			name ? json_object_new_string(name) : NULL);
-	json_object_object_add(object, "rect", ipc_json_create_rect(box));
-	json_object_object_add(object, "focused", json_object_new_boolean(focused));
-	json_object_object_add(object, "focus", focus);
-
-	// set default values to be compatible with i3
-	json_object_object_add(object, "border",
-			json_object_new_string(
-				ipc_json_border_description(B_NONE)));
-	json_object_object_add(object, "current_border_width",
-			json_object_new_int(0));
-	json_object_object_add(object, "layout",
-			json_object_new_string(
-				ipc_json_layout_description(L_HORIZ)));
-	json_object_object_add(object, "orientation",
-			json_object_new_string(
-				ipc_json_orientation_description(L_HORIZ)));
-	json_object_object_add(object, "percent", NULL);
-	json_object_object_add(object, "window_rect", ipc_json_create_empty_rect());
-	json_object_object_add(object, "deco_rect", ipc_json_create_empty_rect());
-	json_object_object_add(object, "geometry", ipc_json_create_empty_rect());
-	json_object_object_add(object, "window", NULL);
-	json_object_object_add(object, "urgent", json_object_new_boolean(false));
-	json_object_object_add(object, "marks", json_object_new_array());
-	json_object_object_add(object, "fullscreen_mode", json_object_new_int(0));
-	json_object_object_add(object, "nodes", json_object_new_array());
-	json_object_object_add(object, "floating_nodes", json_object_new_array());
-	json_object_object_add(object, "sticky", json_object_new_boolean(false));
-
-	return object;
-}
-
-static void ipc_json_describe_root(struct sway_root *root, json_object *object) {
-	json_object_object_add(object, "type", json_object_new_string("root"));
-}
-
-static void ipc_json_describe_output(struct sway_output *output,
-		json_object *object) {
-	struct wlr_output *wlr_output = output->wlr_output;
-	json_object_object_add(object, "type", json_object_new_string("output"));
-	json_object_object_add(object, "active", json_object_new_boolean(true));
-	json_object_object_add(object, "dpms",
-			json_object_new_boolean(wlr_output->enabled));
-	json_object_object_add(object, "primary", json_object_new_boolean(false));
-	json_object_object_add(object, "layout", json_object_new_string("output"));
-	json_object_object_add(object, "orientation",
-			json_object_new_string(
-				ipc_json_orientation_description(L_NONE)));
-	json_object_object_add(object, "make",
-			json_object_new_string(wlr_output->make));
-	json_object_object_add(object, "model",
-			json_object_new_string(wlr_output->model));
-	json_object_object_add(object, "serial",
-			json_object_new_string(wlr_output->serial));
-	json_object_object_add(object, "scale",
-			json_object_new_double(wlr_output->scale));
-	json_object_object_add(object, "scale_filter",
-		json_object_new_string(
-			sway_output_scale_filter_to_string(output->scale_filter)));
-	json_object_object_add(object, "transform",
-		json_object_new_string(
-			ipc_json_output_transform_description(wlr_output->transform)));
-	const char *adaptive_sync_status =
-		ipc_json_output_adaptive_sync_status_description(
-			wlr_output->adaptive_sync_status);
-	json_object_object_add(object, "adaptive_sync_status",
-		json_object_new_string(adaptive_sync_status));
-
-	struct sway_workspace *ws = output_get_active_workspace(output);
-	if (!sway_assert(ws, "Expected output to have a workspace")) {
-		return;
-	}
-	json_object_object_add(object, "current_workspace",
-			json_object_new_string(ws->name));
-
-	json_object *modes_array = json_object_new_array();
-	struct wlr_output_mode *mode;
-	wl_list_for_each(mode, &wlr_output->modes, link) {
-		json_object *mode_object = json_object_new_object();
-		json_object_object_add(mode_object, "width",
-			json_object_new_int(mode->width));
-		json_object_object_add(mode_object, "height",
-			json_object_new_int(mode->height));
-		json_object_object_add(mode_object, "refresh",
-			json_object_new_int(mode->refresh));
-		json_object_array_add(modes_array, mode_object);
-	}
-
-	json_object_object_add(object, "modes", modes_array);
-
-	json_object *current_mode_object = json_object_new_object();
-	json_object_object_add(current_mode_object, "width",
-		json_object_new_int(wlr_output->width));
-	json_object_object_add(current_mode_object, "height",
-		json_object_new_int(wlr_output->height));
-	json_object_object_add(current_mode_object, "refresh",
-		json_object_new_int(wlr_output->refresh));
-	json_object_object_add(object, "current_mode", current_mode_object);
-
-	struct sway_node *parent = node_get_parent(&output->node);
-	struct wlr_box parent_box = {0, 0, 0, 0};
-
-	if (parent != NULL) {
-		node_get_box(parent, &parent_box);
-	}
-
-	if (parent_box.width != 0 && parent_box.height != 0) {
-		double percent = ((double)output->width / parent_box.width)
-				* ((double)output->height / parent_box.height);
-		json_object_object_add(object, "percent", json_object_new_double(percent));
-	}
-
-	json_object_object_add(object, "max_render_time", json_object_new_int(output->max_render_time));
-}
-
 json_object *ipc_json_describe_disabled_output(struct sway_output *output) {
 	struct wlr_output *wlr_output = output->wlr_output;
 
@@ -357,93 +234,219 @@ json_object *ipc_json_describe_disabled_output(struct sway_output *output) {
 	return object;
 }
 
-static json_object *ipc_json_describe_scratchpad_output(void) {
-	struct wlr_box box;
-	root_get_box(root, &box);
+static json_object *ipc_json_describe_samples(
+		const struct sway_frame_samples *samples) {
+	json_object *object = json_object_new_object();
+	json_object_object_add(object, "samples",
+			json_object_new_int(samples->len));
+	json_object_object_add(object, "min",
+			json_object_new_int64(frame_samples_percentile(samples, 0)));
+	json_object_object_add(object, "p50",
+			json_object_new_int64(frame_samples_percentile(samples, 50)));
+	json_object_object_add(object, "p90",
+			json_object_new_int64(frame_samples_percentile(samples, 90)));
+	json_object_object_add(object, "p99",
+			json_object_new_int64(frame_samples_percentile(samples, 99)));
+	json_object_object_add(object, "max",
+			json_object_new_int64(frame_samples_percentile(samples, 100)));
+	return object;
+}
 
-	// Create focus stack for __i3_scratch workspace
-	json_object *workspace_focus = json_object_new_array();
-	for (int i = root->scratchpad->length - 1; i >= 0; --i) {
-		struct sway_container *container = root->scratchpad->items[i];
-		json_object_array_add(workspace_focus,
-				json_object_new_int(container->node.id));
-	}
-
-	json_object *workspace = ipc_json_create_node(i3_scratch_id,
-				"__i3_scratch", false, workspace_focus, &box);
-	json_object_object_add(workspace, "fullscreen_mode", json_object_new_int(1));
-	json_object_object_add(workspace, "type",
-			json_object_new_string("workspace"));
-
-	// List all hidden scratchpad containers as floating nodes
-	json_object *floating_array = json_object_new_array();
-	for (int i = 0; i < root->scratchpad->length; ++i) {
-		struct sway_container *container = root->scratchpad->items[i];
-		if (container_is_scratchpad_hidden(container)) {
-			json_object_array_add(floating_array,
-				ipc_json_describe_node_recursive(&container->node));
+static json_object *ipc_json_describe_frame_samples(
+		const struct sway_frame_samples *samples) {
+	json_object *object = ipc_json_describe_samples(samples);
+
+	// Power-of-two buckets from 250us to 16ms, plus one for everything above
+	const uint32_t bounds[] = { 250, 500, 1000, 2000, 4000, 8000, 16000 };
+	const size_t nbounds = sizeof(bounds) / sizeof(bounds[0]);
+	int counts[sizeof(bounds) / sizeof(bounds[0]) + 1] = {0};
+	for (size_t i = 0; i < samples->len; ++i) {
+		size_t b = 0;
+		while (b < nbounds && samples->samples[i] > bounds[b]) {
+			++b;
 		}
+		++counts[b];
 	}
-	json_object_object_add(workspace, "floating_nodes", floating_array);
 
-	// Create focus stack for __i3 output
-	json_object *output_focus = json_object_new_array();
-	json_object_array_add(output_focus, json_object_new_int(i3_scratch_id));
+	json_object *histogram = json_object_new_array();
+	for (size_t b = 0; b <= nbounds; ++b) {
+		json_object *bucket = json_object_new_object();
+		json_object_object_add(bucket, "le",
+				b < nbounds ? json_object_new_int64(bounds[b]) : NULL);
+		json_object_object_add(bucket, "count",
+				json_object_new_int(counts[b]));
+		json_object_array_add(histogram, bucket);
+	}
+	json_object_object_add(object, "histogram", histogram);
 
-	json_object *output = ipc_json_create_node(i3_output_id,
-					"__i3", false, output_focus, &box);
-	json_object_object_add(output, "type",
-			json_object_new_string("output"));
-	json_object_object_add(output, "layout",
-			json_object_new_string("output"));
+	return object;
+}
 
-	json_object *nodes = json_object_new_array();
-	json_object_array_add(nodes, workspace);
-	json_object_object_add(output, "nodes", nodes);
+static const char *ipc_json_scanout_rejection_description(
+		enum sway_scanout_rejection reason) {
+	switch (reason) {
+	case SCANOUT_REJECT_SAVED_BUFFERS:
+		return "saved_buffers";
+	case SCANOUT_REJECT_FLOATING:
+		return "floating";
+	case SCANOUT_REJECT_UNMANAGED:
+		return "unmanaged";
+	case SCANOUT_REJECT_LAYERS:
+		return "layers";
+	case SCANOUT_REJECT_DRAG_ICONS:
+		return "drag_icons";
+	case SCANOUT_REJECT_SEATOP:
+		return "seatop";
+	case SCANOUT_REJECT_NO_BUFFER:
+		return "no_buffer";
+	case SCANOUT_REJECT_SURFACES:
+		return "surfaces";
+	case SCANOUT_REJECT_GEOMETRY:
+		return "geometry";
+	case SCANOUT_REJECT_NOT_OPAQUE:
+		return "not_opaque";
+	case SCANOUT_REJECT_SCALE:
+		return "scale";
+	case SCANOUT_REJECT_TRANSFORM:
+		return "transform";
+	case SCANOUT_REJECT_COMMIT:
+		return "commit";
+	case SCANOUT_REJECT_COUNT:
+		break;
+	}
+	return "unknown";
+}
+
+json_object *ipc_json_describe_frame_stats(struct sway_output *output) {
+	struct sway_output_frame_stats *stats = &output->frame_stats;
+	json_object *object = json_object_new_object();
+
+	json_object_object_add(object, "name",
+			json_object_new_string(output->wlr_output->name));
+	json_object_object_add(object, "refresh",
+			json_object_new_int64(output->refresh_nsec));
+	json_object_object_add(object, "max_render_time",
+			json_object_new_int(output->max_render_time));
+	json_object_object_add(object, "frames_rendered",
+			json_object_new_int64(stats->frames_rendered));
+	json_object_object_add(object, "frames_missed",
+			json_object_new_int64(stats->frames_missed));
+	json_object_object_add(object, "scanout_attempts",
+			json_object_new_int64(stats->scanout_attempts));
+	json_object_object_add(object, "scanout_hits",
+			json_object_new_int64(stats->scanout_hits));
+	json_object_object_add(object, "scanout_active",
+			json_object_new_boolean(stats->scanning_out));
+	json_object *rejections = json_object_new_object();
+	for (int i = 0; i < SCANOUT_REJECT_COUNT; ++i) {
+		json_object_object_add(rejections,
+				ipc_json_scanout_rejection_description(i),
+				json_object_new_int64(stats->scanout_rejections[i]));
+	}
+	json_object_object_add(object, "scanout_rejections", rejections);
+	json_object_object_add(object, "render_time",
+			ipc_json_describe_frame_samples(&stats->render));
+	json_object_object_add(object, "present_latency",
+			ipc_json_describe_frame_samples(&stats->present));
+	json_object_object_add(object, "draw_calls",
+			ipc_json_describe_samples(&stats->draw_calls));
+	json_object_object_add(object, "scissor_changes",
+			ipc_json_describe_samples(&stats->scissor_changes));
 
-	return output;
+	return object;
 }
 
-static void ipc_json_describe_workspace(struct sway_workspace *workspace,
-		json_object *object) {
-	int num;
-	if (isdigit(workspace->name[0])) {
-		errno = 0;
-		char *endptr = NULL;
-		long long parsed_num = strtoll(workspace->name, &endptr, 10);
-		if (errno != 0 || parsed_num > INT32_MAX || parsed_num < 0 || endptr == workspace->name) {
-			num = -1;
-		} else {
-			num = (int) parsed_num;
+static int cmp_damage_source_area(const void *_a, const void *_b) {
+	const struct sway_damage_source *a =
+		*(const struct sway_damage_source **)_a;
+	const struct sway_damage_source *b =
+		*(const struct sway_damage_source **)_b;
+	return (a->area < b->area) - (a->area > b->area);
+}
+
+json_object *ipc_json_describe_damage_stats(struct sway_output *output) {
+	struct sway_output_damage_stats *stats = &output->damage_stats;
+	json_object *object = json_object_new_object();
+
+	int width, height;
+	wlr_output_transformed_resolution(output->wlr_output, &width, &height);
+	json_object_object_add(object, "name",
+			json_object_new_string(output->wlr_output->name));
+	json_object_object_add(object, "pixels",
+			json_object_new_int64((int64_t)width * height));
+	json_object_object_add(object, "frames_rendered",
+			json_object_new_int64(output->frame_stats.frames_rendered));
+	json_object_object_add(object, "frames_skipped",
+			json_object_new_int64(stats->frames_skipped));
+	json_object_object_add(object, "frames_full",
+			json_object_new_int64(stats->frames_full));
+	json_object_object_add(object, "damage_area",
+			ipc_json_describe_samples(&stats->area));
+	json_object_object_add(object, "damage_rects",
+			ipc_json_describe_samples(&stats->rects));
+
+	// Clients which damaged the most area first
+	struct sway_damage_source *sources[OUTPUT_DAMAGE_SOURCES];
+	size_t nsources = 0;
+	for (size_t i = 0; i < OUTPUT_DAMAGE_SOURCES; ++i) {
+		if (stats->sources[i].client) {
+			sources[nsources++] = &stats->sources[i];
 		}
-	} else {
-		num = -1;
-	}
-	json_object_object_add(object, "num", json_object_new_int(num));
-	json_object_object_add(object, "fullscreen_mode", json_object_new_int(1));
-	json_object_object_add(object, "output", workspace->output ?
-			json_object_new_string(workspace->output->wlr_output->name) : NULL);
-	json_object_object_add(object, "type", json_object_new_string("workspace"));
-	json_object_object_add(object, "urgent",
-			json_object_new_boolean(workspace->urgent));
-	json_object_object_add(object, "representation", workspace->representation ?
-			json_object_new_string(workspace->representation) : NULL);
-
-	json_object_object_add(object, "layout",
-			json_object_new_string(
-				ipc_json_layout_description(workspace->layout)));
-	json_object_object_add(object, "orientation",
-			json_object_new_string(
-				ipc_json_orientation_description(workspace->layout)));
-
-	// Floating
-	json_object *floating_array = json_object_new_array();
-	for (int i = 0; i < workspace->floating->length; ++i) {
-		struct sway_container *floater = workspace->floating->items[i];
-		json_object_array_add(floating_array,
-				ipc_json_describe_node_recursive(&floater->node));
-	}
-	json_object_object_add(object, "floating_nodes", floating_array);
+	}
+	qsort(sources, nsources, sizeof(sources[0]), cmp_damage_source_area);
+
+	json_object *array = json_object_new_array();
+	for (size_t i = 0; i < nsources; ++i) {
+		struct sway_damage_source *source = sources[i];
+		json_object *entry = json_object_new_object();
+		json_object_object_add(entry, "pid", json_object_new_int(source->pid));
+		json_object_object_add(entry, "name", source->name[0] ?
+				json_object_new_string(source->name) : NULL);
+		json_object_object_add(entry, "commits",
+				json_object_new_int64(source->commits));
+		json_object_object_add(entry, "whole_commits",
+				json_object_new_int64(source->whole_commits));
+		json_object_object_add(entry, "area",
+				json_object_new_int64(source->area));
+		json_object_array_add(array, entry);
+	}
+	json_object_object_add(object, "sources", array);
+
+	return object;
+}
+
+json_object *ipc_json_describe_titlebar_cache(void) {
+	struct titlebar_cache_stats stats;
+	titlebar_cache_get_stats(&stats);
+
+	json_object *object = json_object_new_object();
+	json_object_object_add(object, "hits", json_object_new_int64(stats.hits));
+	json_object_object_add(object, "misses",
+			json_object_new_int64(stats.misses));
+	uint64_t lookups = stats.hits + stats.misses;
+	json_object_object_add(object, "hit_rate", json_object_new_double(
+			lookups ? (double)stats.hits / lookups : 0));
+	json_object_object_add(object, "bytes_saved",
+			json_object_new_int64(stats.bytes_saved));
+	json_object_object_add(object, "entries",
+			json_object_new_int64(stats.entries));
+	json_object_object_add(object, "unused_entries",
+			json_object_new_int64(stats.unused_entries));
+	json_object_object_add(object, "bytes", json_object_new_int64(stats.bytes));
+	return object;
+}
+
+static int ipc_json_workspace_num(struct sway_workspace *workspace) {
+	if (!isdigit(workspace->name[0])) {
+		return -1;
+	}
+	errno = 0;
+	char *endptr = NULL;
+	long long parsed_num = strtoll(workspace->name, &endptr, 10);
+	if (errno != 0 || parsed_num > INT32_MAX || parsed_num < 0 || endptr == workspace->name) {
+		return -1;
+	}
+	return (int) parsed_num;
 }
 
 static void get_deco_rect(struct sway_container *c, struct wlr_box *deco_rect) {
@@ -483,279 +486,949 @@ static void get_deco_rect(struct sway_container *c, struct wlr_box *deco_rect) {
 	}
 }
 
-static void ipc_json_describe_view(struct sway_container *c, json_object *object) {
-	json_object_object_add(object, "pid", json_object_new_int(c->view->pid));
-
-	const char *app_id = view_get_app_id(c->view);
-	json_object_object_add(object, "app_id",
-			app_id ? json_object_new_string(app_id) : NULL);
-
-	bool visible = view_is_visible(c->view);
-	json_object_object_add(object, "visible", json_object_new_boolean(visible));
-
-	struct wlr_box window_box = {
-		c->content_x - c->x,
-		(c->current.border == B_PIXEL) ? c->current.border_thickness : 0,
-		c->content_width,
-		c->content_height
-	};
-
-	json_object_object_add(object, "window_rect", ipc_json_create_rect(&window_box));
-
-	struct wlr_box geometry = {0, 0, c->view->natural_width, c->view->natural_height};
-	json_object_object_add(object, "geometry", ipc_json_create_rect(&geometry));
-
-	json_object_object_add(object, "max_render_time", json_object_new_int(c->view->max_render_time));
-
-	json_object_object_add(object, "shell", json_object_new_string(view_get_shell(c->view)));
-
-	json_object_object_add(object, "inhibit_idle",
-		json_object_new_boolean(view_inhibit_idle(c->view)));
+/*
+ * Nodes are only described here, for GET_TREE, the other replies and events.
+ * The writer either streams the description or builds it as json-c objects.
+ */
+
+struct tree_writer {
+	struct json_writer *json;
+	const struct ipc_json_tree_query *query;
+	int depth; // of the node being written, relative to the query root
+	// Leave out the tiling children of the top node
+	bool shallow;
+	// Write the generation into the top node
+	bool has_generation;
+	uint64_t generation;
+};
 
-	json_object *idle_inhibitors = json_object_new_object();
+static bool field_selected(struct tree_writer *tw, const char *key) {
+	list_t *fields = tw->query ? tw->query->fields : NULL;
+	if (!fields) {
+		return true;
+	}
+	for (int i = 0; i < fields->length; ++i) {
+		if (strcmp(fields->items[i], key) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
 
-	struct sway_idle_inhibitor_v1 *user_inhibitor =
-		sway_idle_inhibit_v1_user_inhibitor_for_view(c->view);
+static bool children_selected(struct tree_writer *tw) {
+	return !tw->query || tw->query->max_depth < 0 ||
+		tw->depth < tw->query->max_depth;
+}
 
-	if (user_inhibitor) {
-		json_object_object_add(idle_inhibitors, "user",
-			json_object_new_string(
-				ipc_json_user_idle_inhibitor_description(user_inhibitor->mode)));
-	} else {
-		json_object_object_add(idle_inhibitors, "user",
-			json_object_new_string("none"));
+static void write_int_field(struct tree_writer *tw, const char *key,
+		int64_t value) {
+	if (field_selected(tw, key)) {
+		json_writer_key(tw->json, key);
+		json_writer_int(tw->json, value);
 	}
+}
 
-	struct sway_idle_inhibitor_v1 *application_inhibitor =
-		sway_idle_inhibit_v1_application_inhibitor_for_view(c->view);
+static void write_bool_field(struct tree_writer *tw, const char *key,
+		bool value) {
+	if (field_selected(tw, key)) {
+		json_writer_key(tw->json, key);
+		json_writer_bool(tw->json, value);
+	}
+}
 
-	if (application_inhibitor) {
-		json_object_object_add(idle_inhibitors, "application",
-			json_object_new_string("enabled"));
-	} else {
-		json_object_object_add(idle_inhibitors, "application",
-			json_object_new_string("none"));
+static void write_string_field(struct tree_writer *tw, const char *key,
+		const char *value) {
+	if (field_selected(tw, key)) {
+		json_writer_key(tw->json, key);
+		json_writer_string(tw->json, value);
 	}
+}
 
-	json_object_object_add(object, "idle_inhibitors", idle_inhibitors);
+static void write_rect(struct json_writer *json, const struct wlr_box *box) {
+	json_writer_begin_object(json);
+	json_writer_key(json, "x");
+	json_writer_int(json, box->x);
+	json_writer_key(json, "y");
+	json_writer_int(json, box->y);
+	json_writer_key(json, "width");
+	json_writer_int(json, box->width);
+	json_writer_key(json, "height");
+	json_writer_int(json, box->height);
+	json_writer_end_object(json);
+}
 
-#if HAVE_XWAYLAND
-	if (c->view->type == SWAY_VIEW_XWAYLAND) {
-		json_object_object_add(object, "window",
-				json_object_new_int(view_get_x11_window_id(c->view)));
+static void write_rect_field(struct tree_writer *tw, const char *key,
+		const struct wlr_box *box) {
+	if (field_selected(tw, key)) {
+		json_writer_key(tw->json, key);
+		write_rect(tw->json, box);
+	}
+}
 
-		json_object *window_props = json_object_new_object();
+struct focus_ids {
+	struct sway_node *node;
+	size_t *ids;
+	size_t len, cap;
+};
 
-		const char *class = view_get_class(c->view);
-		if (class) {
-			json_object_object_add(window_props, "class", json_object_new_string(class));
+static void focus_ids_iterator(struct sway_node *node, void *_data) {
+	struct focus_ids *data = _data;
+	if (data->node == &root->node) {
+		struct sway_output *output = node_get_output(node);
+		if (output == NULL) {
+			return;
 		}
-		const char *instance = view_get_instance(c->view);
-		if (instance) {
-			json_object_object_add(window_props, "instance", json_object_new_string(instance));
+		for (size_t i = 0; i < data->len; ++i) {
+			if (data->ids[i] == output->node.id) {
+				return;
+			}
 		}
-		if (c->title) {
-			json_object_object_add(window_props, "title", json_object_new_string(c->title));
+		node = &output->node;
+	} else if (node_get_parent(node) != data->node) {
+		return;
+	}
+	if (data->len == data->cap) {
+		size_t cap = data->cap ? data->cap * 2 : 8;
+		size_t *ids = realloc(data->ids, cap * sizeof(size_t));
+		if (!ids) {
+			return;
 		}
+		data->ids = ids;
+		data->cap = cap;
+	}
+	data->ids[data->len++] = node->id;
+}
 
-		// the transient_for key is always present in i3's output
-		uint32_t parent_id = view_get_x11_parent_id(c->view);
-		json_object_object_add(window_props, "transient_for",
-				parent_id ? json_object_new_int(parent_id) : NULL);
+static void write_focus_field(struct tree_writer *tw,
+		struct sway_seat *seat, struct sway_node *node) {
+	if (!field_selected(tw, "focus")) {
+		return;
+	}
+	struct focus_ids data = { .node = node };
+	seat_for_each_node(seat, focus_ids_iterator, &data);
+	json_writer_key(tw->json, "focus");
+	json_writer_begin_array(tw->json);
+	for (size_t i = 0; i < data.len; ++i) {
+		json_writer_int(tw->json, (int)data.ids[i]);
+	}
+	json_writer_end_array(tw->json);
+	free(data.ids);
+}
 
-		const char *role = view_get_window_role(c->view);
-		if (role) {
-			json_object_object_add(window_props, "window_role", json_object_new_string(role));
-		}
+/**
+ * The fields shared by all nodes, initialized to the defaults nodes without
+ * them have in i3.
+ */
+struct node_fields {
+	const char *border;
+	int border_width;
+	const char *layout;
+	const char *orientation;
+	bool has_percent;
+	double percent;
+	struct wlr_box window_rect, deco_rect, geometry;
+	bool has_window;
+	uint32_t window;
+	bool urgent;
+	list_t *marks;
+	int fullscreen_mode;
+	bool sticky;
+};
 
-		uint32_t window_type = view_get_window_type(c->view);
-		if (window_type) {
-			json_object_object_add(window_props, "window_type",
-				json_object_new_string(
-					ipc_json_xwindow_type_description(c->view)));
-		}
+static void init_node_fields(struct node_fields *fields) {
+	*fields = (struct node_fields){
+		.border = ipc_json_border_description(B_NONE),
+		.layout = ipc_json_layout_description(L_HORIZ),
+		.orientation = ipc_json_orientation_description(L_HORIZ),
+	};
+}
 
-		json_object_object_add(object, "window_properties", window_props);
+static void set_percent(struct node_fields *fields, struct sway_node *node,
+		double width, double height) {
+	struct sway_node *parent = node_get_parent(node);
+	struct wlr_box parent_box = {0, 0, 0, 0};
+	if (parent != NULL) {
+		node_get_box(parent, &parent_box);
+	}
+	if (parent_box.width != 0 && parent_box.height != 0) {
+		fields->has_percent = true;
+		fields->percent = (width / parent_box.width)
+			* (height / parent_box.height);
 	}
-#endif
 }
 
-static void ipc_json_describe_container(struct sway_container *c, json_object *object) {
-	json_object_object_add(object, "name",
-			c->title ? json_object_new_string(c->title) : NULL);
-	json_object_object_add(object, "type",
-			json_object_new_string(container_is_floating(c) ? "floating_con" : "con"));
-
-	json_object_object_add(object, "layout",
-			json_object_new_string(
-				ipc_json_layout_description(c->layout)));
-
-	json_object_object_add(object, "orientation",
-			json_object_new_string(
-				ipc_json_orientation_description(c->layout)));
+/**
+ * Write the fields from border up to and including fullscreen_mode.
+ */
+static void write_node_fields(struct tree_writer *tw,
+		const struct node_fields *fields) {
+	write_string_field(tw, "border", fields->border);
+	write_int_field(tw, "current_border_width", fields->border_width);
+	write_string_field(tw, "layout", fields->layout);
+	write_string_field(tw, "orientation", fields->orientation);
+	if (field_selected(tw, "percent")) {
+		json_writer_key(tw->json, "percent");
+		if (fields->has_percent) {
+			json_writer_double(tw->json, fields->percent);
+		} else {
+			json_writer_null(tw->json);
+		}
+	}
+	write_rect_field(tw, "window_rect", &fields->window_rect);
+	write_rect_field(tw, "deco_rect", &fields->deco_rect);
+	write_rect_field(tw, "geometry", &fields->geometry);
+	if (field_selected(tw, "window")) {
+		json_writer_key(tw->json, "window");
+		if (fields->has_window) {
+			json_writer_int(tw->json, fields->window);
+		} else {
+			json_writer_null(tw->json);
+		}
+	}
+	write_bool_field(tw, "urgent", fields->urgent);
+	if (field_selected(tw, "marks")) {
+		json_writer_key(tw->json, "marks");
+		json_writer_begin_array(tw->json);
+		for (int i = 0; fields->marks && i < fields->marks->length; ++i) {
+			json_writer_string(tw->json, fields->marks->items[i]);
+		}
+		json_writer_end_array(tw->json);
+	}
+	write_int_field(tw, "fullscreen_mode", fields->fullscreen_mode);
+}
 
-	bool urgent = c->view ?
-		view_is_urgent(c->view) : container_has_urgent_child(c);
-	json_object_object_add(object, "urgent", json_object_new_boolean(urgent));
-	json_object_object_add(object, "sticky", json_object_new_boolean(c->is_sticky));
+static void write_node_recursive(struct tree_writer *tw,
+		struct sway_node *node);
 
-	json_object_object_add(object, "fullscreen_mode",
-			json_object_new_int(c->fullscreen_mode));
+static void write_scratchpad_output(struct tree_writer *tw);
 
-	struct sway_node *parent = node_get_parent(&c->node);
-	struct wlr_box parent_box = {0, 0, 0, 0};
+static void write_modes(struct json_writer *json,
+		struct wlr_output *wlr_output) {
+	json_writer_begin_array(json);
+	struct wlr_output_mode *mode;
+	wl_list_for_each(mode, &wlr_output->modes, link) {
+		json_writer_begin_object(json);
+		json_writer_key(json, "width");
+		json_writer_int(json, mode->width);
+		json_writer_key(json, "height");
+		json_writer_int(json, mode->height);
+		json_writer_key(json, "refresh");
+		json_writer_int(json, mode->refresh);
+		json_writer_end_object(json);
+	}
+	json_writer_end_array(json);
+}
 
-	if (parent != NULL) {
-		node_get_box(parent, &parent_box);
+static void write_output_fields(struct tree_writer *tw,
+		struct sway_output *output) {
+	struct wlr_output *wlr_output = output->wlr_output;
+	write_string_field(tw, "type", "output");
+	write_bool_field(tw, "active", true);
+	write_bool_field(tw, "dpms", wlr_output->enabled);
+	write_bool_field(tw, "primary", false);
+	write_string_field(tw, "make", wlr_output->make);
+	write_string_field(tw, "model", wlr_output->model);
+	write_string_field(tw, "serial", wlr_output->serial);
+	if (field_selected(tw, "scale")) {
+		json_writer_key(tw->json, "scale");
+		json_writer_double(tw->json, wlr_output->scale);
 	}
+	write_string_field(tw, "scale_filter",
+			sway_output_scale_filter_to_string(output->scale_filter));
+	write_string_field(tw, "transform",
+			ipc_json_output_transform_description(wlr_output->transform));
+	write_string_field(tw, "adaptive_sync_status",
+			ipc_json_output_adaptive_sync_status_description(
+				wlr_output->adaptive_sync_status));
 
-	if (parent_box.width != 0 && parent_box.height != 0) {
-		double percent = ((double)c->width / parent_box.width)
-				* ((double)c->height / parent_box.height);
-		json_object_object_add(object, "percent", json_object_new_double(percent));
+	struct sway_workspace *ws = output_get_active_workspace(output);
+	if (!sway_assert(ws, "Expected output to have a workspace")) {
+		return;
+	}
+	write_string_field(tw, "current_workspace", ws->name);
+	if (field_selected(tw, "modes")) {
+		json_writer_key(tw->json, "modes");
+		write_modes(tw->json, wlr_output);
 	}
+	if (field_selected(tw, "current_mode")) {
+		json_writer_key(tw->json, "current_mode");
+		json_writer_begin_object(tw->json);
+		json_writer_key(tw->json, "width");
+		json_writer_int(tw->json, wlr_output->width);
+		json_writer_key(tw->json, "height");
+		json_writer_int(tw->json, wlr_output->height);
+		json_writer_key(tw->json, "refresh");
+		json_writer_int(tw->json, wlr_output->refresh);
+		json_writer_end_object(tw->json);
+	}
+	write_int_field(tw, "max_render_time", output->max_render_time);
+	write_bool_field(tw, "max_render_time_auto",
+			output->max_render_time_auto);
+}
 
-	json_object_object_add(object, "border",
-			json_object_new_string(
-				ipc_json_border_description(c->current.border)));
-	json_object_object_add(object, "current_border_width",
-			json_object_new_int(c->current.border_thickness));
-	json_object_object_add(object, "floating_nodes", json_object_new_array());
+static void write_workspace_fields(struct tree_writer *tw,
+		struct sway_workspace *workspace) {
+	write_int_field(tw, "num", ipc_json_workspace_num(workspace));
+	write_string_field(tw, "output", workspace->output ?
+			workspace->output->wlr_output->name : NULL);
+	write_string_field(tw, "type", "workspace");
+	write_string_field(tw, "representation", workspace->representation);
+}
 
-	struct wlr_box deco_box = {0, 0, 0, 0};
-	get_deco_rect(c, &deco_box);
-	json_object_object_add(object, "deco_rect", ipc_json_create_rect(&deco_box));
+#if HAVE_XWAYLAND
+static void write_window_properties(struct json_writer *json,
+		struct sway_container *c) {
+	struct sway_view *view = c->view;
+	json_writer_begin_object(json);
+	const char *class = view_get_class(view);
+	if (class) {
+		json_writer_key(json, "class");
+		json_writer_string(json, class);
+	}
+	const char *instance = view_get_instance(view);
+	if (instance) {
+		json_writer_key(json, "instance");
+		json_writer_string(json, instance);
+	}
+	if (c->title) {
+		json_writer_key(json, "title");
+		json_writer_string(json, c->title);
+	}
+	// the transient_for key is always present in i3's output
+	uint32_t parent_id = view_get_x11_parent_id(view);
+	json_writer_key(json, "transient_for");
+	if (parent_id) {
+		json_writer_int(json, parent_id);
+	} else {
+		json_writer_null(json);
+	}
+	const char *role = view_get_window_role(view);
+	if (role) {
+		json_writer_key(json, "window_role");
+		json_writer_string(json, role);
+	}
+	if (view_get_window_type(view)) {
+		json_writer_key(json, "window_type");
+		json_writer_string(json, ipc_json_xwindow_type_description(view));
+	}
+	json_writer_end_object(json);
+}
+#endif
 
-	json_object *marks = json_object_new_array();
-	list_t *con_marks = c->marks;
-	for (int i = 0; i < con_marks->length; ++i) {
-		json_object_array_add(marks, json_object_new_string(con_marks->items[i]));
+static void write_view_fields(struct tree_writer *tw,
+		struct sway_container *c) {
+	struct sway_view *view = c->view;
+	write_int_field(tw, "pid", view->pid);
+	if (field_selected(tw, "app_id")) {
+		write_string_field(tw, "app_id", view_get_app_id(view));
+	}
+	if (field_selected(tw, "visible")) {
+		write_bool_field(tw, "visible", view_is_visible(view));
+	}
+	write_int_field(tw, "max_render_time", view->max_render_time);
+	write_string_field(tw, "shell", view_get_shell(view));
+	if (field_selected(tw, "inhibit_idle")) {
+		write_bool_field(tw, "inhibit_idle", view_inhibit_idle(view));
 	}
 
-	json_object_object_add(object, "marks", marks);
+	if (field_selected(tw, "idle_inhibitors")) {
+		json_writer_key(tw->json, "idle_inhibitors");
+		json_writer_begin_object(tw->json);
+		struct sway_idle_inhibitor_v1 *user_inhibitor =
+			sway_idle_inhibit_v1_user_inhibitor_for_view(view);
+		json_writer_key(tw->json, "user");
+		json_writer_string(tw->json, user_inhibitor ?
+				ipc_json_user_idle_inhibitor_description(
+					user_inhibitor->mode) : "none");
+		struct sway_idle_inhibitor_v1 *application_inhibitor =
+			sway_idle_inhibit_v1_application_inhibitor_for_view(view);
+		json_writer_key(tw->json, "application");
+		json_writer_string(tw->json,
+				application_inhibitor ? "enabled" : "none");
+		json_writer_end_object(tw->json);
+	}
 
-	if (c->view) {
-		ipc_json_describe_view(c, object);
+#if HAVE_XWAYLAND
+	if (view->type == SWAY_VIEW_XWAYLAND &&
+			field_selected(tw, "window_properties")) {
+		json_writer_key(tw->json, "window_properties");
+		write_window_properties(tw->json, c);
 	}
+#endif
 }
 
-struct focus_inactive_data {
-	struct sway_node *node;
-	json_object *object;
-};
-
-static void focus_inactive_children_iterator(struct sway_node *node,
-		void *_data) {
-	struct focus_inactive_data *data = _data;
-	json_object *focus = data->object;
-	if (data->node == &root->node) {
-		struct sway_output *output = node_get_output(node);
-		if (output == NULL) {
-			return;
+static void write_child_nodes(struct tree_writer *tw,
+		struct sway_node *node) {
+	json_writer_key(tw->json, "nodes");
+	json_writer_begin_array(tw->json);
+	if (tw->shallow && tw->depth == 0) {
+		json_writer_end_array(tw->json);
+		return;
+	}
+	++tw->depth;
+	list_t *children = NULL;
+	switch (node->type) {
+	case N_ROOT:
+		write_scratchpad_output(tw);
+		for (int i = 0; i < root->outputs->length; ++i) {
+			struct sway_output *output = root->outputs->items[i];
+			write_node_recursive(tw, &output->node);
 		}
-		size_t id = output->node.id;
-		int len = json_object_array_length(focus);
-		for (int i = 0; i < len; ++i) {
-			if ((size_t) json_object_get_int(json_object_array_get_idx(focus, i)) == id) {
-				return;
-			}
+		break;
+	case N_OUTPUT:
+		for (int i = 0; i < node->sway_output->workspaces->length; ++i) {
+			struct sway_workspace *ws =
+				node->sway_output->workspaces->items[i];
+			write_node_recursive(tw, &ws->node);
 		}
-		node = &output->node;
-	} else if (node_get_parent(node) != data->node) {
-		return;
+		break;
+	case N_WORKSPACE:
+		children = node->sway_workspace->tiling;
+		break;
+	case N_CONTAINER:
+		children = node->sway_container->children;
+		break;
+	}
+	for (int i = 0; children && i < children->length; ++i) {
+		struct sway_container *child = children->items[i];
+		write_node_recursive(tw, &child->node);
 	}
-	json_object_array_add(focus, json_object_new_int(node->id));
+	--tw->depth;
+	json_writer_end_array(tw->json);
 }
 
-json_object *ipc_json_describe_node(struct sway_node *node) {
+static void write_floating_nodes(struct tree_writer *tw,
+		struct sway_node *node) {
+	json_writer_key(tw->json, "floating_nodes");
+	json_writer_begin_array(tw->json);
+	++tw->depth;
+	if (node->type == N_WORKSPACE) {
+		list_t *floating = node->sway_workspace->floating;
+		for (int i = 0; i < floating->length; ++i) {
+			struct sway_container *floater = floating->items[i];
+			write_node_recursive(tw, &floater->node);
+		}
+	}
+	--tw->depth;
+	json_writer_end_array(tw->json);
+}
+
+static void write_node_recursive(struct tree_writer *tw,
+		struct sway_node *node) {
 	struct sway_seat *seat = input_manager_get_default_seat();
-	bool focused = seat_get_focus(seat) == node;
-	char *name = node_get_name(node);
+	struct node_fields fields;
+	init_node_fields(&fields);
 
 	struct wlr_box box;
 	node_get_box(node, &box);
-	if (node->type == N_CONTAINER) {
-		struct wlr_box deco_rect = {0, 0, 0, 0};
-		get_deco_rect(node->sway_container, &deco_rect);
+
+	struct sway_container *c = NULL;
+	switch (node->type) {
+	case N_ROOT:
+		break;
+	case N_OUTPUT:
+		fields.layout = "output";
+		fields.orientation = ipc_json_orientation_description(L_NONE);
+		set_percent(&fields, node, node->sway_output->width,
+				node->sway_output->height);
+		break;
+	case N_WORKSPACE:
+		fields.fullscreen_mode = 1;
+		fields.urgent = node->sway_workspace->urgent;
+		fields.layout =
+			ipc_json_layout_description(node->sway_workspace->layout);
+		fields.orientation =
+			ipc_json_orientation_description(node->sway_workspace->layout);
+		break;
+	case N_CONTAINER:
+		c = node->sway_container;
+		get_deco_rect(c, &fields.deco_rect);
 		size_t count = 1;
-		if (container_parent_layout(node->sway_container) == L_STACKED) {
-			count = container_get_siblings(node->sway_container)->length;
+		if (container_parent_layout(c) == L_STACKED) {
+			count = container_get_siblings(c)->length;
+		}
+		box.y += fields.deco_rect.height * count;
+		box.height -= fields.deco_rect.height * count;
+
+		fields.layout = ipc_json_layout_description(c->layout);
+		fields.orientation = ipc_json_orientation_description(c->layout);
+		if (field_selected(tw, "urgent")) {
+			fields.urgent = c->view ?
+				view_is_urgent(c->view) : container_has_urgent_child(c);
+		}
+		fields.sticky = c->is_sticky;
+		fields.fullscreen_mode = c->fullscreen_mode;
+		set_percent(&fields, node, c->width, c->height);
+		fields.border = ipc_json_border_description(c->current.border);
+		fields.border_width = c->current.border_thickness;
+		fields.marks = c->marks;
+		if (c->view) {
+			fields.window_rect = (struct wlr_box){
+				c->content_x - c->x,
+				(c->current.border == B_PIXEL) ?
+					c->current.border_thickness : 0,
+				c->content_width,
+				c->content_height
+			};
+			fields.geometry = (struct wlr_box){
+				0, 0, c->view->natural_width, c->view->natural_height
+			};
+#if HAVE_XWAYLAND
+			if (c->view->type == SWAY_VIEW_XWAYLAND) {
+				fields.has_window = true;
+				fields.window = view_get_x11_window_id(c->view);
+			}
+#endif
 		}
-		box.y += deco_rect.height * count;
-		box.height -= deco_rect.height * count;
+		break;
 	}
 
-	json_object *focus = json_object_new_array();
-	struct focus_inactive_data data = {
-		.node = node,
-		.object = focus,
-	};
-	seat_for_each_node(seat, focus_inactive_children_iterator, &data);
-
-	json_object *object = ipc_json_create_node(
-				(int)node->id, name, focused, focus, &box);
+	json_writer_begin_object(tw->json);
+	if (tw->depth == 0 && tw->has_generation) {
+		json_writer_key(tw->json, "generation");
+		json_writer_int(tw->json, tw->generation);
+	}
+	write_int_field(tw, "id", (int)node->id);
+	write_string_field(tw, "name", node_get_name(node));
+	write_rect_field(tw, "rect", &box);
+	if (field_selected(tw, "focused")) {
+		write_bool_field(tw, "focused", seat_get_focus(seat) == node);
+	}
+	write_focus_field(tw, seat, node);
+	write_node_fields(tw, &fields);
+	if (children_selected(tw)) {
+		write_child_nodes(tw, node);
+		write_floating_nodes(tw, node);
+	}
+	write_bool_field(tw, "sticky", fields.sticky);
 
 	switch (node->type) {
 	case N_ROOT:
-		ipc_json_describe_root(root, object);
+		write_string_field(tw, "type", "root");
 		break;
 	case N_OUTPUT:
-		ipc_json_describe_output(node->sway_output, object);
-		break;
-	case N_CONTAINER:
-		ipc_json_describe_container(node->sway_container, object);
+		write_output_fields(tw, node->sway_output);
 		break;
 	case N_WORKSPACE:
-		ipc_json_describe_workspace(node->sway_workspace, object);
+		write_workspace_fields(tw, node->sway_workspace);
+		break;
+	case N_CONTAINER:
+		write_string_field(tw, "type",
+				container_is_floating(c) ? "floating_con" : "con");
+		if (c->view) {
+			write_view_fields(tw, c);
+		}
 		break;
 	}
+	json_writer_end_object(tw->json);
+}
 
-	return object;
+/**
+ * Write the fields of a pseudo node of the scratchpad, up to and including
+ * focused.
+ */
+static void write_scratchpad_node_start(struct tree_writer *tw, int id,
+		const char *name, struct wlr_box *box) {
+	json_writer_begin_object(tw->json);
+	write_int_field(tw, "id", id);
+	write_string_field(tw, "name", name);
+	write_rect_field(tw, "rect", box);
+	write_bool_field(tw, "focused", false);
+}
+
+static void write_scratchpad_output(struct tree_writer *tw) {
+	struct wlr_box box;
+	root_get_box(root, &box);
+
+	struct node_fields fields;
+	init_node_fields(&fields);
+	fields.layout = "output";
+
+	write_scratchpad_node_start(tw, i3_output_id, "__i3", &box);
+	if (field_selected(tw, "focus")) {
+		json_writer_key(tw->json, "focus");
+		json_writer_begin_array(tw->json);
+		json_writer_int(tw->json, i3_scratch_id);
+		json_writer_end_array(tw->json);
+	}
+	write_node_fields(tw, &fields);
+
+	if (children_selected(tw)) {
+		json_writer_key(tw->json, "nodes");
+		json_writer_begin_array(tw->json);
+		++tw->depth;
+
+		// The __i3_scratch workspace
+		init_node_fields(&fields);
+		fields.fullscreen_mode = 1;
+		write_scratchpad_node_start(tw, i3_scratch_id, "__i3_scratch", &box);
+		if (field_selected(tw, "focus")) {
+			json_writer_key(tw->json, "focus");
+			json_writer_begin_array(tw->json);
+			for (int i = root->scratchpad->length - 1; i >= 0; --i) {
+				struct sway_container *container = root->scratchpad->items[i];
+				json_writer_int(tw->json, container->node.id);
+			}
+			json_writer_end_array(tw->json);
+		}
+		write_node_fields(tw, &fields);
+		if (children_selected(tw)) {
+			json_writer_key(tw->json, "nodes");
+			json_writer_begin_array(tw->json);
+			json_writer_end_array(tw->json);
+			// List all hidden scratchpad containers as floating nodes
+			json_writer_key(tw->json, "floating_nodes");
+			json_writer_begin_array(tw->json);
+			++tw->depth;
+			for (int i = 0; i < root->scratchpad->length; ++i) {
+				struct sway_container *container = root->scratchpad->items[i];
+				if (container_is_scratchpad_hidden(container)) {
+					write_node_recursive(tw, &container->node);
+				}
+			}
+			--tw->depth;
+			json_writer_end_array(tw->json);
+		}
+		write_bool_field(tw, "sticky", false);
+		write_string_field(tw, "type", "workspace");
+		json_writer_end_object(tw->json);
+
+		--tw->depth;
+		json_writer_end_array(tw->json);
+		json_writer_key(tw->json, "floating_nodes");
+		json_writer_begin_array(tw->json);
+		json_writer_end_array(tw->json);
+	}
+	write_bool_field(tw, "sticky", false);
+	write_string_field(tw, "type", "output");
+	json_writer_end_object(tw->json);
+}
+
+void ipc_json_write_node_recursive(struct json_writer *writer,
+		struct sway_node *node, const struct ipc_json_tree_query *query,
+		uint64_t generation) {
+	struct tree_writer tw = {
+		.json = writer,
+		.query = query,
+		.has_generation = true,
+		.generation = generation,
+	};
+	write_node_recursive(&tw, node);
+}
+
+static json_object *describe_node(struct sway_node *node, bool shallow) {
+	struct json_writer writer;
+	json_writer_init(&writer, JSON_WRITER_OBJECT);
+	struct tree_writer tw = {
+		.json = &writer,
+		.shallow = shallow,
+	};
+	write_node_recursive(&tw, node);
+	return json_writer_finish_object(&writer);
+}
+
+json_object *ipc_json_describe_node(struct sway_node *node) {
+	return describe_node(node, true);
 }
 
 json_object *ipc_json_describe_node_recursive(struct sway_node *node) {
-	json_object *object = ipc_json_describe_node(node);
-	int i;
+	return describe_node(node, false);
+}
 
-	json_object *children = json_object_new_array();
-	switch (node->type) {
-	case N_ROOT:
-		json_object_array_add(children,
-				ipc_json_describe_scratchpad_output());
-		for (i = 0; i < root->outputs->length; ++i) {
-			struct sway_output *output = root->outputs->items[i];
-			json_object_array_add(children,
-					ipc_json_describe_node_recursive(&output->node));
+static json_object *create_delta(const char *change, struct sway_node *node) {
+	json_object *delta = json_object_new_object();
+	json_object_object_add(delta, "change", json_object_new_string(change));
+	json_object_object_add(delta, "id", json_object_new_int(node->id));
+	return delta;
+}
+
+static json_object *create_added_delta(struct sway_node *node,
+		const char *type, struct sway_node *parent, struct wlr_box *box) {
+	json_object *delta = create_delta("added", node);
+	json_object_object_add(delta, "type", json_object_new_string(type));
+	json_object_object_add(delta, "parent",
+			parent ? json_object_new_int(parent->id) : NULL);
+	char *name = node_get_name(node);
+	json_object_object_add(delta, "name",
+			name ? json_object_new_string(name) : NULL);
+	if (box) {
+		json_object_object_add(delta, "rect", ipc_json_create_rect(box));
+	}
+	return delta;
+}
+
+/**
+ * Add the common deltas. Returns false if the node was added or removed, in
+ * which case there is nothing else to describe.
+ */
+static bool describe_lifetime_delta(json_object *deltas,
+		struct sway_node *node, const char *type, struct sway_node *parent,
+		struct wlr_box *box) {
+	if (node->destroying) {
+		if (node->current_applied) {
+			json_object_array_add(deltas, create_delta("removed", node));
 		}
-		break;
-	case N_OUTPUT:
-		for (i = 0; i < node->sway_output->workspaces->length; ++i) {
-			struct sway_workspace *ws = node->sway_output->workspaces->items[i];
-			json_object_array_add(children,
-					ipc_json_describe_node_recursive(&ws->node));
+		return false;
+	}
+	if (!node->current_applied) {
+		json_object_array_add(deltas,
+				create_added_delta(node, type, parent, box));
+		return false;
+	}
+	return true;
+}
+
+static void describe_reparent_delta(json_object *deltas,
+		struct sway_node *node, struct sway_node *old_parent,
+		struct sway_node *new_parent) {
+	if (old_parent != new_parent) {
+		json_object *delta = create_delta("reparented", node);
+		json_object_object_add(delta, "parent",
+				new_parent ? json_object_new_int(new_parent->id) : NULL);
+		json_object_array_add(deltas, delta);
+	}
+}
+
+static void describe_rect_delta(json_object *deltas, struct sway_node *node,
+		struct wlr_box *old_box, struct wlr_box *new_box) {
+	if (memcmp(old_box, new_box, sizeof(struct wlr_box)) != 0) {
+		json_object *delta = create_delta("rect", node);
+		json_object_object_add(delta, "rect", ipc_json_create_rect(new_box));
+		json_object_array_add(deltas, delta);
+	}
+}
+
+static bool node_lists_equal(list_t *a, list_t *b) {
+	int a_length = a ? a->length : 0;
+	int b_length = b ? b->length : 0;
+	if (a_length != b_length) {
+		return false;
+	}
+	for (int i = 0; i < a_length; ++i) {
+		if (a->items[i] != b->items[i]) {
+			return false;
 		}
-		break;
-	case N_WORKSPACE:
-		for (i = 0; i < node->sway_workspace->tiling->length; ++i) {
-			struct sway_container *con = node->sway_workspace->tiling->items[i];
-			json_object_array_add(children,
-					ipc_json_describe_node_recursive(&con->node));
+	}
+	return true;
+}
+
+static json_object *create_id_array(list_t *containers) {
+	json_object *ids = json_object_new_array();
+	for (int i = 0; containers && i < containers->length; ++i) {
+		struct sway_container *con = containers->items[i];
+		json_object_array_add(ids, json_object_new_int(con->node.id));
+	}
+	return ids;
+}
+
+/**
+ * Add a children delta with the new order of the tiling and floating children
+ * that changed. The floating lists are NULL for containers.
+ */
+static void describe_children_delta(json_object *deltas,
+		struct sway_node *node, list_t *old_tiling, list_t *new_tiling,
+		list_t *old_floating, list_t *new_floating) {
+	bool tiling_changed = !node_lists_equal(old_tiling, new_tiling);
+	bool floating_changed = !node_lists_equal(old_floating, new_floating);
+	if (!tiling_changed && !floating_changed) {
+		return;
+	}
+	json_object *delta = create_delta("children", node);
+	if (tiling_changed) {
+		json_object_object_add(delta, "nodes", create_id_array(new_tiling));
+	}
+	if (floating_changed) {
+		json_object_object_add(delta, "floating_nodes",
+				create_id_array(new_floating));
+	}
+	json_object_array_add(deltas, delta);
+}
+
+/**
+ * Add a property delta with the changed properties, if there are any.
+ */
+static void describe_property_delta(json_object *deltas,
+		struct sway_node *node, json_object *properties) {
+	if (json_object_object_length(properties) == 0) {
+		json_object_put(properties);
+		return;
+	}
+	json_object *delta = create_delta("property", node);
+	json_object_object_add(delta, "properties", properties);
+	json_object_array_add(deltas, delta);
+}
+
+void ipc_json_describe_output_delta(json_object *deltas,
+		struct sway_output *output, struct sway_output_state *state) {
+	if (!describe_lifetime_delta(deltas, &output->node, "output",
+				&root->node, NULL)) {
+		return;
+	}
+	json_object *properties = json_object_new_object();
+	if (output->current.active_workspace != state->active_workspace) {
+		json_object_object_add(properties, "current_workspace",
+				state->active_workspace ?
+				json_object_new_string(state->active_workspace->name) : NULL);
+	}
+	describe_property_delta(deltas, &output->node, properties);
+}
+
+void ipc_json_describe_workspace_delta(json_object *deltas,
+		struct sway_workspace *workspace, struct sway_workspace_state *state) {
+	struct sway_workspace_state *current = &workspace->current;
+	struct sway_node *parent = state->output ? &state->output->node : NULL;
+	struct wlr_box box = { state->x, state->y, state->width, state->height };
+	bool existed = describe_lifetime_delta(deltas, &workspace->node,
+			"workspace", parent, &box);
+	if (!workspace->node.destroying) {
+		describe_children_delta(deltas, &workspace->node,
+				current->tiling, state->tiling,
+				current->floating, state->floating);
+	}
+	if (!existed) {
+		return;
+	}
+
+	describe_reparent_delta(deltas, &workspace->node,
+			current->output ? &current->output->node : NULL, parent);
+	struct wlr_box old_box = {
+		current->x, current->y, current->width, current->height
+	};
+	describe_rect_delta(deltas, &workspace->node, &old_box, &box);
+
+	json_object *properties = json_object_new_object();
+	if (current->layout != state->layout) {
+		json_object_object_add(properties, "layout", json_object_new_string(
+					ipc_json_layout_description(state->layout)));
+	}
+	if (current->focused != state->focused) {
+		json_object_object_add(properties, "focused",
+				json_object_new_boolean(state->focused));
+	}
+	if (current->fullscreen != state->fullscreen) {
+		json_object_object_add(properties, "fullscreen",
+				state->fullscreen ?
+				json_object_new_int(state->fullscreen->node.id) : NULL);
+	}
+	describe_property_delta(deltas, &workspace->node, properties);
+}
+
+static struct sway_node *container_state_parent(
+		struct sway_container_state *state) {
+	if (state->parent) {
+		return &state->parent->node;
+	}
+	if (state->workspace) {
+		return &state->workspace->node;
+	}
+	return NULL;
+}
+
+void ipc_json_describe_container_delta(json_object *deltas,
+		struct sway_container *container, struct sway_container_state *state) {
+	struct sway_container_state *current = &container->current;
+	struct sway_node *parent = container_state_parent(state);
+	struct wlr_box box = { state->x, state->y, state->width, state->height };
+	bool existed = describe_lifetime_delta(deltas, &container->node,
+			container_is_floating(container) ? "floating_con" : "con",
+			parent, &box);
+	if (!container->node.destroying) {
+		describe_children_delta(deltas, &container->node,
+				current->children, state->children, NULL, NULL);
+		// Moving urgent views in or out changes the urgency of parents
+		ipc_json_describe_urgency_change(deltas, container);
+	}
+	if (!existed) {
+		return;
+	}
+
+	describe_reparent_delta(deltas, &container->node,
+			container_state_parent(current), parent);
+	struct wlr_box old_box = {
+		current->x, current->y, current->width, current->height
+	};
+	describe_rect_delta(deltas, &container->node, &old_box, &box);
+
+	json_object *properties = json_object_new_object();
+	if (current->layout != state->layout) {
+		json_object_object_add(properties, "layout", json_object_new_string(
+					ipc_json_layout_description(state->layout)));
+	}
+	if (current->focused != state->focused) {
+		json_object_object_add(properties, "focused",
+				json_object_new_boolean(state->focused));
+	}
+	if (current->fullscreen_mode != state->fullscreen_mode) {
+		json_object_object_add(properties, "fullscreen_mode",
+				json_object_new_int(state->fullscreen_mode));
+	}
+	if (current->border != state->border) {
+		json_object_object_add(properties, "border", json_object_new_string(
+					ipc_json_border_description(state->border)));
+	}
+	if (current->border_thickness != state->border_thickness) {
+		json_object_object_add(properties, "current_border_width",
+				json_object_new_int(state->border_thickness));
+	}
+	describe_property_delta(deltas, &container->node, properties);
+}
+
+void ipc_json_describe_property_change(json_object *deltas,
+		struct sway_node *node, const char *property) {
+	struct sway_container *con =
+		node->type == N_CONTAINER ? node->sway_container : NULL;
+	json_object *value = NULL;
+	if (strcmp(property, "name") == 0) {
+		char *name = node_get_name(node);
+		value = name ? json_object_new_string(name) : NULL;
+	} else if (strcmp(property, "app_id") == 0) {
+		const char *app_id = con && con->view ?
+			view_get_app_id(con->view) : NULL;
+		value = app_id ? json_object_new_string(app_id) : NULL;
+	} else if (strcmp(property, "marks") == 0) {
+		value = json_object_new_array();
+		for (int i = 0; con && i < con->marks->length; ++i) {
+			json_object_array_add(value,
+					json_object_new_string(con->marks->items[i]));
 		}
-		break;
-	case N_CONTAINER:
-		if (node->sway_container->children) {
-			for (i = 0; i < node->sway_container->children->length; ++i) {
-				struct sway_container *child =
-					node->sway_container->children->items[i];
-				json_object_array_add(children,
-						ipc_json_describe_node_recursive(&child->node));
-			}
+	} else if (strcmp(property, "current_workspace") == 0) {
+		struct sway_workspace *ws = node->type == N_OUTPUT ?
+			node->sway_output->current.active_workspace : NULL;
+		value = ws ? json_object_new_string(ws->name) : NULL;
+	} else if (strcmp(property, "urgent") == 0) {
+		bool urgent = false;
+		if (node->type == N_WORKSPACE) {
+			urgent = node->sway_workspace->urgent;
+		} else if (con) {
+			urgent = con->view ?
+				view_is_urgent(con->view) : container_has_urgent_child(con);
 		}
-		break;
+		value = json_object_new_boolean(urgent);
+	} else {
+		sway_assert(false, "Unknown property %s", property);
+		return;
 	}
-	json_object_object_add(object, "nodes", children);
+	json_object *properties = json_object_new_object();
+	json_object_object_add(properties, property, value);
+	describe_property_delta(deltas, node, properties);
+}
 
-	return object;
+void ipc_json_describe_urgency_change(json_object *deltas,
+		struct sway_container *container) {
+	if (container->view) {
+		return;
+	}
+	bool urgent = container_has_urgent_child(container);
+	if (urgent == container->urgent_reported) {
+		return;
+	}
+	container->urgent_reported = urgent;
+	if (deltas) {
+		json_object *properties = json_object_new_object();
+		json_object_object_add(properties, "urgent",
+				json_object_new_boolean(urgent));
+		describe_property_delta(deltas, &container->node, properties);
+	}
 }
 
 static json_object *describe_libinput_device(struct libinput_device *device) {
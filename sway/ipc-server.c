@@ -4,6 +4,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <json.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -12,6 +13,7 @@
 #include <string.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <unistd.h>
 #include <wayland-server-core.h>
@@ -37,20 +39,77 @@ static struct wl_event_source *ipc_event_source =  NULL;
 static struct sockaddr_un *ipc_sockaddr = NULL;
 static list_t *ipc_client_list = NULL;
 static struct wl_listener ipc_display_destroy;
+// The number of tree events sent so far
+static uint64_t tree_generation = 0;
 
 static const char ipc_magic[] = {'i', '3', '-', 'i', 'p', 'c'};
 
 #define IPC_HEADER_SIZE (sizeof(ipc_magic) + 8)
 
+// Upper bound on the iovecs passed to a single writev
+#define IPC_WRITE_IOV_MAX 64
+// Clients which fall further behind than this are disconnected. For clients
+// subscribed with "coalesce", events with a coalesce key are counted separately
+// against the same limit, since they are bounded by the number of keys.
+#define IPC_WRITE_QUEUE_MAX 4000000 // 4 MB
+
+// Window and workspace changes for which clients subscribed with "coalesce"
+// only keep the latest queued event per container or workspace
+static const char *coalesced_window_changes[] = {
+	"title",
+	"mark",
+	"urgent",
+};
+static const char *coalesced_workspace_changes[] = {
+	"focus",
+	"urgent",
+};
+
+// Low byte of the coalesce keys of events which aren't about a node. The low
+// byte of node keys is the index into the change lists above plus one.
+enum coalesce_kind {
+	COALESCE_MODE = 0x10,
+	COALESCE_BARCONFIG_UPDATE,
+	COALESCE_BAR_STATE_UPDATE,
+};
+
+/**
+ * An encoded message, header included. Events are encoded once and the same
+ * message is queued to every subscribed client.
+ */
+struct ipc_message {
+	int refcount;
+	uint64_t coalesce_key; // 0 if the message can't be coalesced
+	size_t len;
+	char data[];
+};
+
+struct ipc_write_chunk {
+	struct ipc_message *message;
+	bool coalesced; // counted in ipc_client::coalesced_queue_len
+	struct wl_list link; // ipc_client::write_queue
+};
+
+struct ipc_coalesce_slot {
+	uint64_t key;
+	struct ipc_write_chunk *chunk; // NULL if the slot is empty
+};
+
 struct ipc_client {
 	struct wl_event_source *event_source;
 	struct wl_event_source *writable_event_source;
 	struct sway_server *server;
 	int fd;
 	enum ipc_command_type subscribed_events;
-	size_t write_buffer_len;
-	size_t write_buffer_size;
-	char *write_buffer;
+	enum json_writer_format encoding; // of replies and events
+	struct wl_list write_queue; // ipc_write_chunk::link
+	size_t write_queue_len; // bytes not yet written
+	size_t write_offset; // bytes of the first chunk already written
+	// Queued chunks by coalesce key, for clients subscribed with "coalesce"
+	bool coalesce;
+	struct ipc_coalesce_slot *coalesce_slots;
+	size_t coalesce_len, coalesce_cap; // cap is a power of two
+	size_t coalesced_queue_len; // bytes of queued chunks with a coalesce key
 	// The following are for storing data between event_loop calls
 	uint32_t pending_length;
 	enum ipc_command_type pending_type;
@@ -65,6 +124,211 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 	enum ipc_command_type payload_type);
 bool ipc_send_reply(struct ipc_client *client, enum ipc_command_type payload_type,
 	const char *payload, uint32_t payload_length);
+static bool ipc_send_encoded_reply(struct ipc_client *client,
+	enum ipc_command_type payload_type, const char *payload,
+	uint32_t payload_length);
+static bool ipc_send_json_reply(struct ipc_client *client,
+	enum ipc_command_type payload_type, json_object *json);
+
+static struct ipc_message *ipc_message_create(
+		enum ipc_command_type payload_type, const char *payload,
+		uint32_t payload_length) {
+	struct ipc_message *message =
+		malloc(sizeof(struct ipc_message) + IPC_HEADER_SIZE + payload_length);
+	if (!message) {
+		sway_log(SWAY_ERROR, "Unable to allocate ipc message");
+		return NULL;
+	}
+	message->refcount = 1;
+	message->coalesce_key = 0;
+	message->len = IPC_HEADER_SIZE + payload_length;
+
+	char *data = message->data;
+	memcpy(data, ipc_magic, sizeof(ipc_magic));
+	memcpy(data + sizeof(ipc_magic), &payload_length, sizeof(payload_length));
+	memcpy(data + sizeof(ipc_magic) + sizeof(payload_length), &payload_type,
+			sizeof(payload_type));
+	memcpy(data + IPC_HEADER_SIZE, payload, payload_length);
+	return message;
+}
+
+static struct ipc_message *ipc_message_create_json(
+		enum ipc_command_type payload_type, json_object *json,
+		enum json_writer_format format) {
+	if (format == JSON_WRITER_TEXT) {
+		const char *json_string = json_object_to_json_string(json);
+		return ipc_message_create(payload_type, json_string,
+				(uint32_t)strlen(json_string));
+	}
+	struct json_writer writer;
+	json_writer_init(&writer, format);
+	json_writer_object(&writer, json);
+	size_t length = 0;
+	char *payload = json_writer_finish(&writer, &length);
+	if (!payload) {
+		return NULL;
+	}
+	struct ipc_message *message =
+		ipc_message_create(payload_type, payload, (uint32_t)length);
+	free(payload);
+	return message;
+}
+
+static void ipc_message_unref(struct ipc_message *message) {
+	if (--message->refcount == 0) {
+		free(message);
+	}
+}
+
+static size_t coalesce_hash(uint64_t key, size_t cap) {
+	return (size_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & (cap - 1);
+}
+
+static struct ipc_coalesce_slot *coalesce_slot(struct ipc_coalesce_slot *slots,
+		size_t cap, uint64_t key) {
+	size_t i = coalesce_hash(key, cap);
+	while (slots[i].chunk && slots[i].key != key) {
+		i = (i + 1) & (cap - 1);
+	}
+	return &slots[i];
+}
+
+static struct ipc_write_chunk *coalesce_find(struct ipc_client *client,
+		uint64_t key) {
+	if (!client->coalesce_cap) {
+		return NULL;
+	}
+	return coalesce_slot(client->coalesce_slots, client->coalesce_cap,
+			key)->chunk;
+}
+
+static bool coalesce_set(struct ipc_client *client, uint64_t key,
+		struct ipc_write_chunk *chunk) {
+	// Keep the table at most half full
+	if ((client->coalesce_len + 1) * 2 > client->coalesce_cap) {
+		size_t cap = client->coalesce_cap ? client->coalesce_cap * 2 : 16;
+		struct ipc_coalesce_slot *slots =
+			calloc(cap, sizeof(struct ipc_coalesce_slot));
+		if (!slots) {
+			return false;
+		}
+		for (size_t i = 0; i < client->coalesce_cap; ++i) {
+			struct ipc_coalesce_slot *old = &client->coalesce_slots[i];
+			if (old->chunk) {
+				*coalesce_slot(slots, cap, old->key) = *old;
+			}
+		}
+		free(client->coalesce_slots);
+		client->coalesce_slots = slots;
+		client->coalesce_cap = cap;
+	}
+	struct ipc_coalesce_slot *slot = coalesce_slot(client->coalesce_slots,
+			client->coalesce_cap, key);
+	if (!slot->chunk) {
+		++client->coalesce_len;
+	}
+	slot->key = key;
+	slot->chunk = chunk;
+	return true;
+}
+
+static void coalesce_remove(struct ipc_client *client,
+		struct ipc_write_chunk *chunk) {
+	uint64_t key = chunk->message->coalesce_key;
+	if (!key || !client->coalesce_cap) {
+		return;
+	}
+	size_t mask = client->coalesce_cap - 1;
+	struct ipc_coalesce_slot *slots = client->coalesce_slots;
+	struct ipc_coalesce_slot *slot =
+		coalesce_slot(slots, client->coalesce_cap, key);
+	if (slot->chunk != chunk) {
+		return;
+	}
+	// Shift the following slots of the probe sequence back into the hole
+	size_t i = slot - slots;
+	for (size_t j = (i + 1) & mask; slots[j].chunk; j = (j + 1) & mask) {
+		size_t home = coalesce_hash(slots[j].key, client->coalesce_cap);
+		bool in_place = i <= j ? (i < home && home <= j) :
+			(i < home || home <= j);
+		if (!in_place) {
+			slots[i] = slots[j];
+			i = j;
+		}
+	}
+	slots[i].chunk = NULL;
+	--client->coalesce_len;
+}
+
+static void ipc_write_chunk_destroy(struct ipc_client *client,
+		struct ipc_write_chunk *chunk) {
+	coalesce_remove(client, chunk);
+	if (chunk->coalesced) {
+		client->coalesced_queue_len -= chunk->message->len;
+	}
+	wl_list_remove(&chunk->link);
+	ipc_message_unref(chunk->message);
+	free(chunk);
+}
+
+/**
+ * Add a reference to the message to the client's write queue. On failure the
+ * client is disconnected.
+ */
+static bool ipc_queue_message(struct ipc_client *client,
+		struct ipc_message *message) {
+	uint64_t key = client->coalesce ? message->coalesce_key : 0;
+	if (key) {
+		// Drop the older event unless it is already being written
+		struct ipc_write_chunk *old = coalesce_find(client, key);
+		struct ipc_write_chunk *first = wl_container_of(
+				client->write_queue.next, first, link);
+		if (old && (old != first || client->write_offset == 0)) {
+			client->write_queue_len -= old->message->len;
+			ipc_write_chunk_destroy(client, old);
+		}
+	}
+
+	// Superseded events were dropped above, so only the events which can't be
+	// coalesced grow the queue without bound
+	size_t coalesced_len = client->coalesced_queue_len;
+	size_t queue_len = client->write_queue_len > coalesced_len ?
+		client->write_queue_len - coalesced_len : 0;
+	if (key) {
+		coalesced_len += message->len;
+	} else {
+		queue_len += message->len;
+	}
+	if (queue_len > IPC_WRITE_QUEUE_MAX || coalesced_len > IPC_WRITE_QUEUE_MAX) {
+		sway_log(SWAY_ERROR, "Client write queue too big (%zu), disconnecting client",
+				client->write_queue_len + message->len);
+		ipc_client_disconnect(client);
+		return false;
+	}
+
+	struct ipc_write_chunk *chunk = malloc(sizeof(struct ipc_write_chunk));
+	if (!chunk || (key && !coalesce_set(client, key, chunk))) {
+		sway_log(SWAY_ERROR, "Unable to allocate ipc client write chunk");
+		free(chunk);
+		ipc_client_disconnect(client);
+		return false;
+	}
+	chunk->message = message;
+	chunk->coalesced = key != 0;
+	++message->refcount;
+	wl_list_insert(client->write_queue.prev, &chunk->link);
+	client->write_queue_len += message->len;
+	if (chunk->coalesced) {
+		client->coalesced_queue_len += message->len;
+	}
+
+	if (!client->writable_event_source) {
+		client->writable_event_source = wl_event_loop_add_fd(
+				server.wl_event_loop, client->fd, WL_EVENT_WRITABLE,
+				ipc_client_handle_writable, client);
+	}
+	return true;
+}
 
 static void handle_display_destroy(struct wl_listener *listener, void *data) {
 	if (ipc_event_source) {
@@ -183,18 +447,18 @@ int ipc_handle_connection(int fd, uint32_t mask, void *data) {
 	client->pending_length = 0;
 	client->fd = client_fd;
 	client->subscribed_events = 0;
+	client->encoding = JSON_WRITER_TEXT;
 	client->event_source = wl_event_loop_add_fd(server->wl_event_loop,
 			client_fd, WL_EVENT_READABLE, ipc_client_handle_readable, client);
 	client->writable_event_source = NULL;
 
-	client->write_buffer_size = 128;
-	client->write_buffer_len = 0;
-	client->write_buffer = malloc(client->write_buffer_size);
-	if (!client->write_buffer) {
-		sway_log(SWAY_ERROR, "Unable to allocate ipc client write buffer");
-		close(client_fd);
-		return 0;
-	}
+	wl_list_init(&client->write_queue);
+	client->write_queue_len = 0;
+	client->write_offset = 0;
+	client->coalesce = false;
+	client->coalesce_slots = NULL;
+	client->coalesce_len = client->coalesce_cap = 0;
+	client->coalesced_queue_len = 0;
 
 	sway_log(SWAY_DEBUG, "New client: fd %d", client_fd);
 	list_add(ipc_client_list, client);
@@ -280,22 +544,124 @@ static bool ipc_has_event_listeners(enum ipc_command_type event) {
 	return false;
 }
 
-static void ipc_send_event(const char *json_string, enum ipc_command_type event) {
+/**
+ * Send the event to every subscribed client. The event is encoded at most once
+ * per encoding. Queued events with the same non-zero coalesce key are replaced
+ * for clients subscribed with "coalesce".
+ */
+static void ipc_send_event(json_object *json, enum ipc_command_type event,
+		uint64_t coalesce_key) {
+	struct ipc_message *messages[] = {
+		[JSON_WRITER_TEXT] = NULL,
+		[JSON_WRITER_MSGPACK] = NULL,
+	};
 	struct ipc_client *client;
 	for (int i = 0; i < ipc_client_list->length; i++) {
 		client = ipc_client_list->items[i];
 		if ((client->subscribed_events & event_mask(event)) == 0) {
 			continue;
 		}
-		if (!ipc_send_reply(client, event, json_string,
-				(uint32_t)strlen(json_string))) {
+		struct ipc_message **message = &messages[client->encoding];
+		if (!*message) {
+			*message = ipc_message_create_json(event, json, client->encoding);
+			if (!*message) {
+				continue;
+			}
+			(*message)->coalesce_key = coalesce_key;
+		}
+		if (!ipc_queue_message(client, *message)) {
 			sway_log_errno(SWAY_INFO, "Unable to send reply to IPC client");
-			/* ipc_send_reply destroys client on error, which also
+			/* ipc_queue_message destroys client on error, which also
 			 * removes it from the list, so we need to process
 			 * current index again */
 			i--;
 		}
 	}
+	for (size_t i = 0; i < sizeof(messages) / sizeof(messages[0]); ++i) {
+		if (messages[i]) {
+			ipc_message_unref(messages[i]);
+		}
+	}
+}
+
+json_object *ipc_event_tree_begin(void) {
+	if (!ipc_has_event_listeners(IPC_EVENT_TREE)) {
+		return NULL;
+	}
+	return json_object_new_array();
+}
+
+void ipc_event_tree(json_object *deltas) {
+	if (!deltas) {
+		return;
+	}
+	if (json_object_array_length(deltas) == 0) {
+		json_object_put(deltas);
+		return;
+	}
+	++tree_generation;
+	sway_log(SWAY_DEBUG, "Sending tree event for generation %" PRIu64,
+			tree_generation);
+	json_object *obj = json_object_new_object();
+	json_object_object_add(obj, "generation",
+			json_object_new_int64(tree_generation));
+	json_object_object_add(obj, "deltas", deltas);
+
+	ipc_send_event(obj, IPC_EVENT_TREE, 0);
+	json_object_put(obj);
+}
+
+void ipc_event_tree_property(struct sway_node *node, const char *property) {
+	// Clients only know of the node once its added delta is sent
+	if (!node->current_applied || node->destroying) {
+		return;
+	}
+	json_object *deltas = ipc_event_tree_begin();
+	if (!deltas) {
+		return;
+	}
+	ipc_json_describe_property_change(deltas, node, property);
+	ipc_event_tree(deltas);
+}
+
+void ipc_event_tree_ancestors_urgency(struct sway_container *container) {
+	// The urgency is remembered even without listeners, so that it is only
+	// reported once it changes from what GET_TREE showed
+	json_object *deltas = ipc_event_tree_begin();
+	for (struct sway_container *con = container->parent; con;
+			con = con->parent) {
+		bool known = con->node.current_applied && !con->node.destroying;
+		ipc_json_describe_urgency_change(known ? deltas : NULL, con);
+	}
+	ipc_event_tree(deltas);
+}
+
+/**
+ * Return the coalesce key of the change to the node, or 0 if the change can't
+ * be coalesced. Node ids are unique across node types, so the keys of window
+ * and workspace events don't collide.
+ */
+static uint64_t coalesce_key(struct sway_node *node, const char *change,
+		const char **changes, size_t nchanges) {
+	for (size_t i = 0; i < nchanges; ++i) {
+		if (strcmp(change, changes[i]) == 0) {
+			return (uint64_t)node->id << 8 | (i + 1);
+		}
+	}
+	return 0;
+}
+
+/**
+ * Return the coalesce key of the events of the bar. The id is hashed, which
+ * keeps the keys stable across reloads.
+ */
+static uint64_t bar_coalesce_key(struct bar_config *bar,
+		enum coalesce_kind kind) {
+	uint64_t hash = 0xcbf29ce484222325ull; // FNV-1a
+	for (const char *c = bar->id; *c; ++c) {
+		hash = (hash ^ (unsigned char)*c) * 0x100000001b3ull;
+	}
+	return hash << 8 | kind;
 }
 
 void ipc_event_workspace(struct sway_workspace *old,
@@ -320,8 +686,11 @@ void ipc_event_workspace(struct sway_workspace *old,
 		json_object_object_add(obj, "current", NULL);
 	}
 
-	const char *json_string = json_object_to_json_string(obj);
-	ipc_send_event(json_string, IPC_EVENT_WORKSPACE);
+	// Keyed by the workspace the change is about, which is the new one
+	uint64_t key = new ? coalesce_key(&new->node, change,
+			coalesced_workspace_changes,
+			sizeof(coalesced_workspace_changes) / sizeof(char *)) : 0;
+	ipc_send_event(obj, IPC_EVENT_WORKSPACE, key);
 	json_object_put(obj);
 }
 
@@ -335,8 +704,10 @@ void ipc_event_window(struct sway_container *window, const char *change) {
 	json_object_object_add(obj, "container",
 			ipc_json_describe_node_recursive(&window->node));
 
-	const char *json_string = json_object_to_json_string(obj);
-	ipc_send_event(json_string, IPC_EVENT_WINDOW);
+	uint64_t key = coalesce_key(&window->node, change,
+			coalesced_window_changes,
+			sizeof(coalesced_window_changes) / sizeof(char *));
+	ipc_send_event(obj, IPC_EVENT_WINDOW, key);
 	json_object_put(obj);
 }
 
@@ -347,8 +718,8 @@ void ipc_event_barconfig_update(struct bar_config *bar) {
 	sway_log(SWAY_DEBUG, "Sending barconfig_update event");
 	json_object *json = ipc_json_describe_bar_config(bar);
 
-	const char *json_string = json_object_to_json_string(json);
-	ipc_send_event(json_string, IPC_EVENT_BARCONFIG_UPDATE);
+	ipc_send_event(json, IPC_EVENT_BARCONFIG_UPDATE,
+			bar_coalesce_key(bar, COALESCE_BARCONFIG_UPDATE));
 	json_object_put(json);
 }
 
@@ -363,8 +734,8 @@ void ipc_event_bar_state_update(struct bar_config *bar) {
 	json_object_object_add(json, "visible_by_modifier",
 			json_object_new_boolean(bar->visible_by_modifier));
 
-	const char *json_string = json_object_to_json_string(json);
-	ipc_send_event(json_string, IPC_EVENT_BAR_STATE_UPDATE);
+	ipc_send_event(json, IPC_EVENT_BAR_STATE_UPDATE,
+			bar_coalesce_key(bar, COALESCE_BAR_STATE_UPDATE));
 	json_object_put(json);
 }
 
@@ -378,8 +749,7 @@ void ipc_event_mode(const char *mode, bool pango) {
 	json_object_object_add(obj, "pango_markup",
 			json_object_new_boolean(pango));
 
-	const char *json_string = json_object_to_json_string(obj);
-	ipc_send_event(json_string, IPC_EVENT_MODE);
+	ipc_send_event(obj, IPC_EVENT_MODE, COALESCE_MODE);
 	json_object_put(obj);
 }
 
@@ -392,8 +762,7 @@ void ipc_event_shutdown(const char *reason) {
 	json_object *json = json_object_new_object();
 	json_object_object_add(json, "change", json_object_new_string(reason));
 
-	const char *json_string = json_object_to_json_string(json);
-	ipc_send_event(json_string, IPC_EVENT_SHUTDOWN);
+	ipc_send_event(json, IPC_EVENT_SHUTDOWN, 0);
 	json_object_put(json);
 }
 
@@ -478,8 +847,7 @@ void ipc_event_binding(struct sway_binding *binding) {
 	json_object *json = json_object_new_object();
 	json_object_object_add(json, "change", json_object_new_string("run"));
 	json_object_object_add(json, "binding", json_binding);
-	const char *json_string = json_object_to_json_string(json);
-	ipc_send_event(json_string, IPC_EVENT_BINDING);
+	ipc_send_event(json, IPC_EVENT_BINDING, 0);
 	json_object_put(json);
 }
 
@@ -493,8 +861,7 @@ static void ipc_event_tick(const char *payload) {
 	json_object_object_add(json, "first", json_object_new_boolean(false));
 	json_object_object_add(json, "payload", json_object_new_string(payload));
 
-	const char *json_string = json_object_to_json_string(json);
-	ipc_send_event(json_string, IPC_EVENT_TICK);
+	ipc_send_event(json, IPC_EVENT_TICK, 0);
 	json_object_put(json);
 }
 
@@ -508,8 +875,7 @@ void ipc_event_input(const char *change, struct sway_input_device *device) {
 	json_object_object_add(json, "change", json_object_new_string(change));
 	json_object_object_add(json, "input", ipc_json_describe_input(device));
 
-	const char *json_string = json_object_to_json_string(json);
-	ipc_send_event(json_string, IPC_EVENT_INPUT);
+	ipc_send_event(json, IPC_EVENT_INPUT, 0);
 	json_object_put(json);
 }
 
@@ -528,13 +894,27 @@ int ipc_client_handle_writable(int client_fd, uint32_t mask, void *data) {
 		return 0;
 	}
 
-	if (client->write_buffer_len <= 0) {
+	if (client->write_queue_len == 0) {
 		return 0;
 	}
 
 	sway_log(SWAY_DEBUG, "Client %d writable", client->fd);
 
-	ssize_t written = write(client->fd, client->write_buffer, client->write_buffer_len);
+	struct iovec iov[IPC_WRITE_IOV_MAX];
+	int iovcnt = 0;
+	size_t offset = client->write_offset;
+	struct ipc_write_chunk *chunk;
+	wl_list_for_each(chunk, &client->write_queue, link) {
+		if (iovcnt == IPC_WRITE_IOV_MAX) {
+			break;
+		}
+		iov[iovcnt].iov_base = chunk->message->data + offset;
+		iov[iovcnt].iov_len = chunk->message->len - offset;
+		++iovcnt;
+		offset = 0;
+	}
+
+	ssize_t written = writev(client->fd, iov, iovcnt);
 
 	if (written == -1 && errno == EAGAIN) {
 		return 0;
@@ -544,10 +924,21 @@ int ipc_client_handle_writable(int client_fd, uint32_t mask, void *data) {
 		return 0;
 	}
 
-	memmove(client->write_buffer, client->write_buffer + written, client->write_buffer_len - written);
-	client->write_buffer_len -= written;
+	client->write_queue_len -= written;
+	size_t remaining = written;
+	struct ipc_write_chunk *tmp;
+	wl_list_for_each_safe(chunk, tmp, &client->write_queue, link) {
+		size_t len = chunk->message->len - client->write_offset;
+		if (remaining < len) {
+			client->write_offset += remaining;
+			break;
+		}
+		remaining -= len;
+		client->write_offset = 0;
+		ipc_write_chunk_destroy(client, chunk);
+	}
 
-	if (client->write_buffer_len == 0 && client->writable_event_source) {
+	if (client->write_queue_len == 0 && client->writable_event_source) {
 		wl_event_source_remove(client->writable_event_source);
 		client->writable_event_source = NULL;
 	}
@@ -572,7 +963,11 @@ void ipc_client_disconnect(struct ipc_client *client) {
 		i++;
 	}
 	list_del(ipc_client_list, i);
-	free(client->write_buffer);
+	struct ipc_write_chunk *chunk, *tmp;
+	wl_list_for_each_safe(chunk, tmp, &client->write_queue, link) {
+		ipc_write_chunk_destroy(client, chunk);
+	}
+	free(client->coalesce_slots);
 	close(client->fd);
 	free(client);
 }
@@ -604,6 +999,86 @@ static void ipc_get_marks_callback(struct sway_container *con, void *data) {
 	}
 }
 
+static bool find_con_id(struct sway_container *con, void *data) {
+	size_t *con_id = data;
+	return con->node.id == *con_id;
+}
+
+static bool find_workspace_name(struct sway_workspace *ws, void *data) {
+	return strcmp(ws->name, data) == 0;
+}
+
+/**
+ * Parse the optional GET_TREE payload, which selects the subtree to describe
+ * and restricts its depth and fields. The fields point into the request.
+ * Returns an error message, or NULL on success.
+ */
+static const char *ipc_parse_tree_query(json_object *request,
+		struct sway_node **node, struct ipc_json_tree_query *query) {
+	if (!request || !json_object_is_type(request, json_type_object)) {
+		return "Expected a JSON object";
+	}
+
+	json_object *value;
+	if (json_object_object_get_ex(request, "con_id", &value)) {
+		if (!json_object_is_type(value, json_type_int)) {
+			return "Expected con_id to be an integer";
+		}
+		size_t con_id = json_object_get_int64(value);
+		struct sway_container *con = root_find_container(find_con_id, &con_id);
+		if (!con) {
+			return "No container with that ID";
+		}
+		*node = &con->node;
+	} else if (json_object_object_get_ex(request, "workspace", &value)) {
+		if (!json_object_is_type(value, json_type_string)) {
+			return "Expected workspace to be a string";
+		}
+		// Only exact names, not next, prev, current and the like
+		struct sway_workspace *ws = root_find_workspace(find_workspace_name,
+				(void *)json_object_get_string(value));
+		if (!ws) {
+			return "No workspace with that name";
+		}
+		*node = &ws->node;
+	} else if (json_object_object_get_ex(request, "output", &value)) {
+		if (!json_object_is_type(value, json_type_string)) {
+			return "Expected output to be a string";
+		}
+		struct sway_output *output =
+			output_by_name_or_id(json_object_get_string(value));
+		if (!output) {
+			return "No output with that name";
+		}
+		*node = &output->node;
+	}
+
+	if (json_object_object_get_ex(request, "depth", &value)) {
+		if (!json_object_is_type(value, json_type_int)) {
+			return "Expected depth to be an integer";
+		}
+		query->max_depth = json_object_get_int(value);
+		if (query->max_depth < 0) {
+			return "Depth must not be negative";
+		}
+	}
+
+	if (json_object_object_get_ex(request, "fields", &value)) {
+		if (!json_object_is_type(value, json_type_array)) {
+			return "Expected fields to be an array";
+		}
+		query->fields = create_list();
+		for (size_t i = 0; i < json_object_array_length(value); ++i) {
+			json_object *field = json_object_array_get_idx(value, i);
+			if (!json_object_is_type(field, json_type_string)) {
+				return "Expected fields to be an array of strings";
+			}
+			list_add(query->fields, (char *)json_object_get_string(field));
+		}
+	}
+	return NULL;
+}
+
 void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_length,
 		enum ipc_command_type payload_type) {
 	if (!sway_assert(client != NULL, "client != NULL")) {
@@ -692,9 +1167,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 						ipc_json_describe_disabled_output(output));
 			}
 		}
-		const char *json_string = json_object_to_json_string(outputs);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
+		ipc_send_json_reply(client, payload_type, outputs);
 		json_object_put(outputs); // free
 		goto exit_cleanup;
 	}
@@ -703,9 +1176,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 	{
 		json_object *workspaces = json_object_new_array();
 		root_for_each_workspace(ipc_get_workspaces_callback, workspaces);
-		const char *json_string = json_object_to_json_string(workspaces);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
+		ipc_send_json_reply(client, payload_type, workspaces);
 		json_object_put(workspaces); // free
 		goto exit_cleanup;
 	}
@@ -744,6 +1215,10 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 				is_tick = true;
 			} else if (strcmp(event_type, "input") == 0) {
 				client->subscribed_events |= event_mask(IPC_EVENT_INPUT);
+			} else if (strcmp(event_type, "tree") == 0) {
+				client->subscribed_events |= event_mask(IPC_EVENT_TREE);
+			} else if (strcmp(event_type, "coalesce") == 0) {
+				client->coalesce = true;
 			} else {
 				const char msg[] = "{\"success\": false}";
 				ipc_send_reply(client, payload_type, msg, strlen(msg));
@@ -771,9 +1246,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 		wl_list_for_each(device, &server.input->devices, link) {
 			json_object_array_add(inputs, ipc_json_describe_input(device));
 		}
-		const char *json_string = json_object_to_json_string(inputs);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
+		ipc_send_json_reply(client, payload_type, inputs);
 		json_object_put(inputs); // free
 		goto exit_cleanup;
 	}
@@ -785,20 +1258,83 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 		wl_list_for_each(seat, &server.input->seats, link) {
 			json_object_array_add(seats, ipc_json_describe_seat(seat));
 		}
-		const char *json_string = json_object_to_json_string(seats);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
+		ipc_send_json_reply(client, payload_type, seats);
 		json_object_put(seats); // free
 		goto exit_cleanup;
 	}
 
+	case IPC_GET_FRAME_STATS:
+	{
+		json_object *outputs = json_object_new_array();
+		for (int i = 0; i < root->outputs->length; ++i) {
+			struct sway_output *output = root->outputs->items[i];
+			json_object_array_add(outputs,
+					ipc_json_describe_frame_stats(output));
+		}
+		ipc_send_json_reply(client, payload_type, outputs);
+		json_object_put(outputs); // free
+		goto exit_cleanup;
+	}
+
+	case IPC_GET_DAMAGE_STATS:
+	{
+		json_object *outputs = json_object_new_array();
+		for (int i = 0; i < root->outputs->length; ++i) {
+			struct sway_output *output = root->outputs->items[i];
+			json_object_array_add(outputs,
+					ipc_json_describe_damage_stats(output));
+		}
+		ipc_send_json_reply(client, payload_type, outputs);
+		json_object_put(outputs); // free
+		goto exit_cleanup;
+	}
+
+	case IPC_GET_TITLEBAR_CACHE:
+	{
+		json_object *stats = ipc_json_describe_titlebar_cache();
+		ipc_send_json_reply(client, payload_type, stats);
+		json_object_put(stats); // free
+		goto exit_cleanup;
+	}
+
 	case IPC_GET_TREE:
 	{
-		json_object *tree = ipc_json_describe_node_recursive(&root->node);
-		const char *json_string = json_object_to_json_string(tree);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
-		json_object_put(tree);
+		struct sway_node *node = &root->node;
+		struct ipc_json_tree_query query = { .max_depth = -1 };
+		json_object *request = NULL;
+		const char *error = NULL;
+		if (payload_length > 0) {
+			request = json_tokener_parse(buf);
+			error = ipc_parse_tree_query(request, &node, &query);
+		}
+
+		struct json_writer writer;
+		json_writer_init(&writer, client->encoding);
+		if (!error) {
+			ipc_json_write_node_recursive(&writer, node,
+					request ? &query : NULL, tree_generation);
+		}
+		size_t length = 0;
+		char *tree = json_writer_finish(&writer, &length);
+		if (!error && !tree) {
+			error = "Unable to describe the tree";
+		}
+		list_free(query.fields);
+		json_object_put(request);
+
+		if (error) {
+			json_object *reply = json_object_new_object();
+			json_object_object_add(reply, "success",
+					json_object_new_boolean(false));
+			json_object_object_add(reply, "error",
+					json_object_new_string(error));
+			ipc_send_json_reply(client, payload_type, reply);
+			json_object_put(reply);
+			free(tree);
+			goto exit_cleanup;
+		}
+		ipc_send_encoded_reply(client, payload_type, tree, (uint32_t)length);
+		free(tree);
 		goto exit_cleanup;
 	}
 
@@ -806,9 +1342,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 	{
 		json_object *marks = json_object_new_array();
 		root_for_each_container(ipc_get_marks_callback, marks);
-		const char *json_string = json_object_to_json_string(marks);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
+		ipc_send_json_reply(client, payload_type, marks);
 		json_object_put(marks);
 		goto exit_cleanup;
 	}
@@ -816,9 +1350,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 	case IPC_GET_VERSION:
 	{
 		json_object *version = ipc_json_get_version();
-		const char *json_string = json_object_to_json_string(version);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
+		ipc_send_json_reply(client, payload_type, version);
 		json_object_put(version); // free
 		goto exit_cleanup;
 	}
@@ -832,9 +1364,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 				struct bar_config *bar = config->bars->items[i];
 				json_object_array_add(bars, json_object_new_string(bar->id));
 			}
-			const char *json_string = json_object_to_json_string(bars);
-			ipc_send_reply(client, payload_type, json_string,
-				(uint32_t)strlen(json_string));
+			ipc_send_json_reply(client, payload_type, bars);
 			json_object_put(bars); // free
 		} else {
 			// Send particular bar's details
@@ -853,9 +1383,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 				goto exit_cleanup;
 			}
 			json_object *json = ipc_json_describe_bar_config(bar);
-			const char *json_string = json_object_to_json_string(json);
-			ipc_send_reply(client, payload_type, json_string,
-				(uint32_t)strlen(json_string));
+			ipc_send_json_reply(client, payload_type, json);
 			json_object_put(json); // free
 		}
 		goto exit_cleanup;
@@ -868,9 +1396,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 			struct sway_mode *mode = config->modes->items[i];
 			json_object_array_add(modes, json_object_new_string(mode->name));
 		}
-		const char *json_string = json_object_to_json_string(modes);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
+		ipc_send_json_reply(client, payload_type, modes);
 		json_object_put(modes); // free
 		goto exit_cleanup;
 	}
@@ -878,9 +1404,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 	case IPC_GET_BINDING_STATE:
 	{
 		json_object *current_mode = ipc_json_get_binding_mode();
-		const char *json_string = json_object_to_json_string(current_mode);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
+		ipc_send_json_reply(client, payload_type, current_mode);
 		json_object_put(current_mode); // free
 		goto exit_cleanup;
 	}
@@ -889,13 +1413,36 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 	{
 		json_object *json = json_object_new_object();
 		json_object_object_add(json, "config", json_object_new_string(config->current_config));
-		const char *json_string = json_object_to_json_string(json);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
+		ipc_send_json_reply(client, payload_type, json);
 		json_object_put(json); // free
 		goto exit_cleanup;
 	}
 
+	case IPC_SET_ENCODING:
+	{
+		// The reply is always JSON text, so that clients can parse it
+		// without knowing whether the switch succeeded
+		enum json_writer_format encoding = client->encoding;
+		client->encoding = JSON_WRITER_TEXT;
+		if (strcmp(buf, "json") == 0) {
+			encoding = JSON_WRITER_TEXT;
+		} else if (strcmp(buf, "msgpack") == 0) {
+			encoding = JSON_WRITER_MSGPACK;
+		} else {
+			const char msg[] = "{\"success\": false, "
+				"\"error\": \"Unknown encoding\"}";
+			if (ipc_send_reply(client, payload_type, msg, strlen(msg))) {
+				client->encoding = encoding;
+			}
+			goto exit_cleanup;
+		}
+		const char msg[] = "{\"success\": true}";
+		if (ipc_send_reply(client, payload_type, msg, strlen(msg))) {
+			client->encoding = encoding;
+		}
+		goto exit_cleanup;
+	}
+
 	case IPC_SYNC:
 	{
 		// It was decided sway will not support this, just return success:false
@@ -914,45 +1461,57 @@ exit_cleanup:
 	return;
 }
 
-bool ipc_send_reply(struct ipc_client *client, enum ipc_command_type payload_type,
-		const char *payload, uint32_t payload_length) {
-	assert(payload);
-
-	char data[IPC_HEADER_SIZE];
-
-	memcpy(data, ipc_magic, sizeof(ipc_magic));
-	memcpy(data + sizeof(ipc_magic), &payload_length, sizeof(payload_length));
-	memcpy(data + sizeof(ipc_magic) + sizeof(payload_length), &payload_type, sizeof(payload_type));
-
-	while (client->write_buffer_len + IPC_HEADER_SIZE + payload_length >=
-				 client->write_buffer_size) {
-		client->write_buffer_size *= 2;
-	}
-
-	if (client->write_buffer_size > 4e6) { // 4 MB
-		sway_log(SWAY_ERROR, "Client write buffer too big (%zu), disconnecting client",
-				client->write_buffer_size);
+static bool ipc_send_encoded_reply(struct ipc_client *client,
+		enum ipc_command_type payload_type, const char *payload,
+		uint32_t payload_length) {
+	struct ipc_message *message =
+		ipc_message_create(payload_type, payload, payload_length);
+	if (!message) {
 		ipc_client_disconnect(client);
 		return false;
 	}
+	bool queued = ipc_queue_message(client, message);
+	ipc_message_unref(message);
+	return queued;
+}
 
-	char *new_buffer = realloc(client->write_buffer, client->write_buffer_size);
-	if (!new_buffer) {
-		sway_log(SWAY_ERROR, "Unable to reallocate ipc client write buffer");
+static bool ipc_send_json_reply(struct ipc_client *client,
+		enum ipc_command_type payload_type, json_object *json) {
+	struct ipc_message *message =
+		ipc_message_create_json(payload_type, json, client->encoding);
+	if (!message) {
 		ipc_client_disconnect(client);
 		return false;
 	}
-	client->write_buffer = new_buffer;
+	size_t length = message->len;
+	bool queued = ipc_queue_message(client, message);
+	ipc_message_unref(message);
+	if (!queued) {
+		return false;
+	}
 
-	memcpy(client->write_buffer + client->write_buffer_len, data, IPC_HEADER_SIZE);
-	client->write_buffer_len += IPC_HEADER_SIZE;
-	memcpy(client->write_buffer + client->write_buffer_len, payload, payload_length);
-	client->write_buffer_len += payload_length;
+	sway_log(SWAY_DEBUG, "Added IPC reply of type 0x%x to client %d queue "
+		"(%zu bytes)", payload_type, client->fd, length);
+	return true;
+}
 
-	if (!client->writable_event_source) {
-		client->writable_event_source = wl_event_loop_add_fd(
-				server.wl_event_loop, client->fd, WL_EVENT_WRITABLE,
-				ipc_client_handle_writable, client);
+/**
+ * Send a reply given as JSON text, which is converted to the client's encoding
+ * if it negotiated a different one.
+ */
+bool ipc_send_reply(struct ipc_client *client, enum ipc_command_type payload_type,
+		const char *payload, uint32_t payload_length) {
+	assert(payload);
+
+	if (client->encoding != JSON_WRITER_TEXT) {
+		json_object *json = json_tokener_parse(payload);
+		bool sent = ipc_send_json_reply(client, payload_type, json);
+		json_object_put(json);
+		return sent;
+	}
+	if (!ipc_send_encoded_reply(client, payload_type, payload,
+			payload_length)) {
+		return false;
 	}
 
 	sway_log(SWAY_DEBUG, "Added IPC reply of type 0x%x to client %d queue: %s",
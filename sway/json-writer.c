@@ -0,0 +1,491 @@
+#define _POSIX_C_SOURCE 200809L
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "log.h"
+#include "sway/json-writer.h"
+
+static bool reserve(struct json_writer *writer, size_t len) {
+	if (writer->failed) {
+		return false;
+	}
+	if (writer->len + len + 1 <= writer->cap) {
+		return true;
+	}
+	size_t cap = writer->cap ? writer->cap : 4096;
+	while (writer->len + len + 1 > cap) {
+		cap *= 2;
+	}
+	char *buf = realloc(writer->buf, cap);
+	if (!buf) {
+		sway_log(SWAY_ERROR, "Unable to allocate JSON buffer");
+		writer->failed = true;
+		return false;
+	}
+	writer->buf = buf;
+	writer->cap = cap;
+	return true;
+}
+
+static void append(struct json_writer *writer, const char *data, size_t len) {
+	if (!reserve(writer, len)) {
+		return;
+	}
+	memcpy(writer->buf + writer->len, data, len);
+	writer->len += len;
+}
+
+static void append_char(struct json_writer *writer, char c) {
+	if (!reserve(writer, 1)) {
+		return;
+	}
+	writer->buf[writer->len++] = c;
+}
+
+// MessagePack stores multi-byte values in big-endian order
+static void append_be(struct json_writer *writer, uint64_t value, int bytes) {
+	if (!reserve(writer, bytes)) {
+		return;
+	}
+	for (int i = bytes - 1; i >= 0; --i) {
+		writer->buf[writer->len++] = (char)(value >> (i * 8));
+	}
+}
+
+static void separate(struct json_writer *writer) {
+	if (writer->need_comma) {
+		append_char(writer, ',');
+	}
+}
+
+// Escapes the same characters as json-c, including '/'
+static void append_string(struct json_writer *writer, const char *str,
+		size_t len) {
+	append_char(writer, '"');
+	const char *start = str;
+	const char *end = str + len;
+	for (const char *p = str; p < end; ++p) {
+		unsigned char c = *p;
+		const char *escape = NULL;
+		char unicode[7];
+		switch (c) {
+		case '"': escape = "\\\""; break;
+		case '\\': escape = "\\\\"; break;
+		case '/': escape = "\\/"; break;
+		case '\b': escape = "\\b"; break;
+		case '\f': escape = "\\f"; break;
+		case '\n': escape = "\\n"; break;
+		case '\r': escape = "\\r"; break;
+		case '\t': escape = "\\t"; break;
+		default:
+			if (c < 0x20) {
+				snprintf(unicode, sizeof(unicode), "\\u%04x", c);
+				escape = unicode;
+			}
+			break;
+		}
+		if (escape) {
+			append(writer, start, p - start);
+			append(writer, escape, strlen(escape));
+			start = p + 1;
+		}
+	}
+	append(writer, start, end - start);
+	append_char(writer, '"');
+}
+
+static void msgpack_string(struct json_writer *writer, const char *str,
+		size_t len) {
+	if (len < 32) {
+		append_char(writer, (char)(0xa0 | len));
+	} else if (len <= UINT8_MAX) {
+		append_char(writer, (char)0xd9);
+		append_be(writer, len, 1);
+	} else if (len <= UINT16_MAX) {
+		append_char(writer, (char)0xda);
+		append_be(writer, len, 2);
+	} else {
+		append_char(writer, (char)0xdb);
+		append_be(writer, len, 4);
+	}
+	append(writer, str, len);
+}
+
+// Counts a value towards the enclosing array. Object members are counted by
+// their keys instead.
+static void msgpack_value(struct json_writer *writer) {
+	if (writer->depth > 0) {
+		struct json_writer_container *top = &writer->stack[writer->depth - 1];
+		if (!top->object) {
+			++top->count;
+		}
+	}
+}
+
+static bool push_container(struct json_writer *writer,
+		struct json_writer_container container) {
+	if (writer->failed) {
+		return false;
+	}
+	if (writer->depth == writer->stack_cap) {
+		size_t cap = writer->stack_cap ? writer->stack_cap * 2 : 16;
+		struct json_writer_container *stack =
+			realloc(writer->stack, cap * sizeof(*stack));
+		if (!stack) {
+			sway_log(SWAY_ERROR, "Unable to allocate JSON writer stack");
+			writer->failed = true;
+			return false;
+		}
+		writer->stack = stack;
+		writer->stack_cap = cap;
+	}
+	writer->stack[writer->depth++] = container;
+	return true;
+}
+
+static struct json_writer_container *pop_container(
+		struct json_writer *writer) {
+	if (writer->failed || !sway_assert(writer->depth > 0,
+				"Ending a container which was never begun")) {
+		writer->failed = true;
+		return NULL;
+	}
+	return &writer->stack[--writer->depth];
+}
+
+static void msgpack_begin(struct json_writer *writer, bool object) {
+	msgpack_value(writer);
+	struct json_writer_container container = {
+		.offset = writer->len,
+		.object = object,
+	};
+	if (!push_container(writer, container)) {
+		return;
+	}
+	append_char(writer, object ? (char)0xdf : (char)0xdd);
+	append_be(writer, 0, 4);
+}
+
+static void msgpack_end(struct json_writer *writer) {
+	struct json_writer_container *top = pop_container(writer);
+	if (!top) {
+		return;
+	}
+	size_t len = writer->len;
+	writer->len = top->offset + 1;
+	append_be(writer, top->count, 4);
+	writer->len = len;
+}
+
+// Adds a value to the enclosing container, or makes it the top-level value.
+// NULL is the null value.
+static void object_value(struct json_writer *writer, json_object *value) {
+	if (writer->failed) {
+		json_object_put(value);
+		return;
+	}
+	if (writer->depth == 0) {
+		json_object_put(writer->result);
+		writer->result = value;
+		return;
+	}
+	struct json_writer_container *top = &writer->stack[writer->depth - 1];
+	if (top->object) {
+		json_object_object_add(top->json, writer->key, value);
+	} else {
+		json_object_array_add(top->json, value);
+	}
+}
+
+static void object_new_value(struct json_writer *writer, json_object *value) {
+	if (!value) {
+		sway_log(SWAY_ERROR, "Unable to allocate JSON object");
+		writer->failed = true;
+		return;
+	}
+	object_value(writer, value);
+}
+
+static void object_begin(struct json_writer *writer, bool object) {
+	json_object *json =
+		object ? json_object_new_object() : json_object_new_array();
+	object_new_value(writer, json);
+	struct json_writer_container container = {
+		.object = object,
+		.json = json,
+	};
+	push_container(writer, container);
+}
+
+void json_writer_init(struct json_writer *writer,
+		enum json_writer_format format) {
+	memset(writer, 0, sizeof(struct json_writer));
+	writer->format = format;
+}
+
+char *json_writer_finish(struct json_writer *writer, size_t *len) {
+	char *buf = NULL;
+	if (writer->depth > 0) {
+		sway_log(SWAY_ERROR, "JSON writer finished with open containers");
+		writer->failed = true;
+	}
+	if (!writer->failed && reserve(writer, 0)) {
+		writer->buf[writer->len] = '\0';
+		buf = writer->buf;
+		if (len) {
+			*len = writer->len;
+		}
+	} else {
+		free(writer->buf);
+	}
+	free(writer->stack);
+	json_object_put(writer->result);
+	json_writer_init(writer, writer->format);
+	return buf;
+}
+
+json_object *json_writer_finish_object(struct json_writer *writer) {
+	json_object *result = writer->result;
+	if (writer->depth > 0) {
+		sway_log(SWAY_ERROR, "JSON writer finished with open containers");
+		writer->failed = true;
+	}
+	if (writer->failed) {
+		json_object_put(result);
+		result = NULL;
+	}
+	free(writer->stack);
+	json_writer_init(writer, writer->format);
+	return result;
+}
+
+void json_writer_begin_object(struct json_writer *writer) {
+	if (writer->format == JSON_WRITER_OBJECT) {
+		object_begin(writer, true);
+		return;
+	}
+	if (writer->format == JSON_WRITER_MSGPACK) {
+		msgpack_begin(writer, true);
+		return;
+	}
+	separate(writer);
+	append_char(writer, '{');
+	writer->need_comma = false;
+}
+
+void json_writer_end_object(struct json_writer *writer) {
+	if (writer->format == JSON_WRITER_OBJECT) {
+		pop_container(writer);
+		return;
+	}
+	if (writer->format == JSON_WRITER_MSGPACK) {
+		msgpack_end(writer);
+		return;
+	}
+	append_char(writer, '}');
+	writer->need_comma = true;
+}
+
+void json_writer_begin_array(struct json_writer *writer) {
+	if (writer->format == JSON_WRITER_OBJECT) {
+		object_begin(writer, false);
+		return;
+	}
+	if (writer->format == JSON_WRITER_MSGPACK) {
+		msgpack_begin(writer, false);
+		return;
+	}
+	separate(writer);
+	append_char(writer, '[');
+	writer->need_comma = false;
+}
+
+void json_writer_end_array(struct json_writer *writer) {
+	if (writer->format == JSON_WRITER_OBJECT) {
+		pop_container(writer);
+		return;
+	}
+	if (writer->format == JSON_WRITER_MSGPACK) {
+		msgpack_end(writer);
+		return;
+	}
+	append_char(writer, ']');
+	writer->need_comma = true;
+}
+
+void json_writer_key(struct json_writer *writer, const char *key) {
+	if (writer->format == JSON_WRITER_OBJECT) {
+		writer->key = key;
+		return;
+	}
+	if (writer->format == JSON_WRITER_MSGPACK) {
+		if (writer->depth > 0) {
+			++writer->stack[writer->depth - 1].count;
+		}
+		msgpack_string(writer, key, strlen(key));
+		return;
+	}
+	separate(writer);
+	append_string(writer, key, strlen(key));
+	append_char(writer, ':');
+	writer->need_comma = false;
+}
+
+static void write_string(struct json_writer *writer, const char *str,
+		size_t len) {
+	if (writer->format == JSON_WRITER_OBJECT) {
+		object_new_value(writer, json_object_new_string_len(str, (int)len));
+		return;
+	}
+	if (writer->format == JSON_WRITER_MSGPACK) {
+		msgpack_value(writer);
+		msgpack_string(writer, str, len);
+		return;
+	}
+	separate(writer);
+	append_string(writer, str, len);
+	writer->need_comma = true;
+}
+
+void json_writer_string(struct json_writer *writer, const char *str) {
+	if (!str) {
+		json_writer_null(writer);
+		return;
+	}
+	write_string(writer, str, strlen(str));
+}
+
+void json_writer_int(struct json_writer *writer, int64_t value) {
+	if (writer->format == JSON_WRITER_OBJECT) {
+		object_new_value(writer, json_object_new_int64(value));
+		return;
+	}
+	if (writer->format == JSON_WRITER_MSGPACK) {
+		msgpack_value(writer);
+		if (value >= -32 && value <= INT8_MAX) {
+			append_char(writer, (char)value); // fixint
+		} else if (value >= INT8_MIN && value <= INT8_MAX) {
+			append_char(writer, (char)0xd0);
+			append_be(writer, (uint64_t)value, 1);
+		} else if (value >= INT16_MIN && value <= INT16_MAX) {
+			append_char(writer, (char)0xd1);
+			append_be(writer, (uint64_t)value, 2);
+		} else if (value >= INT32_MIN && value <= INT32_MAX) {
+			append_char(writer, (char)0xd2);
+			append_be(writer, (uint64_t)value, 4);
+		} else {
+			append_char(writer, (char)0xd3);
+			append_be(writer, (uint64_t)value, 8);
+		}
+		return;
+	}
+	char buf[32];
+	int len = snprintf(buf, sizeof(buf), "%" PRId64, value);
+	separate(writer);
+	append(writer, buf, len);
+	writer->need_comma = true;
+}
+
+void json_writer_double(struct json_writer *writer, double value) {
+	if (!isfinite(value)) {
+		json_writer_null(writer);
+		return;
+	}
+	if (writer->format == JSON_WRITER_OBJECT) {
+		object_new_value(writer, json_object_new_double(value));
+		return;
+	}
+	if (writer->format == JSON_WRITER_MSGPACK) {
+		uint64_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		msgpack_value(writer);
+		append_char(writer, (char)0xcb);
+		append_be(writer, bits, 8);
+		return;
+	}
+	char buf[32];
+	int len = snprintf(buf, sizeof(buf), "%.17g", value);
+	separate(writer);
+	append(writer, buf, len);
+	// Keep doubles distinguishable from integers, like json-c does
+	if (!strpbrk(buf, ".eE")) {
+		append(writer, ".0", 2);
+	}
+	writer->need_comma = true;
+}
+
+void json_writer_bool(struct json_writer *writer, bool value) {
+	if (writer->format == JSON_WRITER_OBJECT) {
+		object_new_value(writer, json_object_new_boolean(value));
+		return;
+	}
+	if (writer->format == JSON_WRITER_MSGPACK) {
+		msgpack_value(writer);
+		append_char(writer, value ? (char)0xc3 : (char)0xc2);
+		return;
+	}
+	separate(writer);
+	if (value) {
+		append(writer, "true", 4);
+	} else {
+		append(writer, "false", 5);
+	}
+	writer->need_comma = true;
+}
+
+void json_writer_null(struct json_writer *writer) {
+	if (writer->format == JSON_WRITER_OBJECT) {
+		object_value(writer, NULL);
+		return;
+	}
+	if (writer->format == JSON_WRITER_MSGPACK) {
+		msgpack_value(writer);
+		append_char(writer, (char)0xc0);
+		return;
+	}
+	separate(writer);
+	append(writer, "null", 4);
+	writer->need_comma = true;
+}
+
+void json_writer_object(struct json_writer *writer, json_object *obj) {
+	if (writer->format == JSON_WRITER_OBJECT) {
+		object_value(writer, json_object_get(obj));
+		return;
+	}
+	switch (json_object_get_type(obj)) {
+	case json_type_null:
+		json_writer_null(writer);
+		break;
+	case json_type_boolean:
+		json_writer_bool(writer, json_object_get_boolean(obj));
+		break;
+	case json_type_double:
+		json_writer_double(writer, json_object_get_double(obj));
+		break;
+	case json_type_int:
+		json_writer_int(writer, json_object_get_int64(obj));
+		break;
+	case json_type_string:
+		write_string(writer, json_object_get_string(obj),
+				json_object_get_string_len(obj));
+		break;
+	case json_type_object:
+		json_writer_begin_object(writer);
+		json_object_object_foreach(obj, key, value) {
+			json_writer_key(writer, key);
+			json_writer_object(writer, value);
+		}
+		json_writer_end_object(writer);
+		break;
+	case json_type_array:
+		json_writer_begin_array(writer);
+		for (size_t i = 0; i < json_object_array_length(obj); ++i) {
+			json_writer_object(writer, json_object_array_get_idx(obj, i));
+		}
+		json_writer_end_array(writer);
+		break;
+	}
+}
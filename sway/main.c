@@ -16,6 +16,7 @@
 #include "sway/config.h"
 #include "sway/server.h"
 #include "sway/swaynag.h"
+#include "sway/trace.h"
 #include "sway/desktop/transaction.h"
 #include "sway/tree/root.h"
 #include "sway/ipc-server.h"
@@ -210,6 +211,10 @@ void enable_debug_flag(const char *flag) {
 		debug.damage = DAMAGE_HIGHLIGHT;
 	} else if (strcmp(flag, "damage=rerender") == 0) {
 		debug.damage = DAMAGE_RERENDER;
+	} else if (strcmp(flag, "damage=heatmap") == 0) {
+		debug.damage = DAMAGE_HEATMAP;
+	} else if (strcmp(flag, "occlusion=highlight") == 0) {
+		debug.occlusion = true;
 	} else if (strcmp(flag, "noatomic") == 0) {
 		debug.noatomic = true;
 	} else if (strcmp(flag, "txn-wait") == 0) {
@@ -218,6 +223,10 @@ void enable_debug_flag(const char *flag) {
 		debug.txn_timings = true;
 	} else if (strncmp(flag, "txn-timeout=", 12) == 0) {
 		server.txn_timeout_ms = atoi(&flag[12]);
+	} else if (strcmp(flag, "txn-batch=frame") == 0) {
+		server.txn_batch_frame = true;
+	} else if (strncmp(flag, "txn-batch=", 10) == 0) {
+		server.txn_batch_ms = atoi(&flag[10]);
 	} else {
 		sway_log(SWAY_ERROR, "Unknown debug flag: %s", flag);
 	}
@@ -414,6 +423,7 @@ int main(int argc, char **argv) {
 shutdown:
 	sway_log(SWAY_INFO, "Shutting down sway");
 
+	trace_stop();
 	server_fini(&server);
 	root_destroy(root);
 	root = NULL;
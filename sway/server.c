@@ -31,6 +31,7 @@
 #include "log.h"
 #include "sway/config.h"
 #include "sway/desktop/idle_inhibit_v1.h"
+#include "sway/desktop/titlebar_cache.h"
 #include "sway/input/input-manager.h"
 #include "sway/output.h"
 #include "sway/server.h"
@@ -187,6 +188,10 @@ void server_fini(struct sway_server *server) {
 	wlr_xwayland_destroy(server->xwayland.wlr_xwayland);
 #endif
 	wl_display_destroy_clients(server->wl_display);
+	titlebar_cache_finish();
+	if (server->txn_batch_timer) {
+		wl_event_source_remove(server->txn_batch_timer);
+	}
 	wl_display_destroy(server->wl_display);
 	list_free(server->dirty_nodes);
 	list_free(server->transactions);
@@ -0,0 +1,150 @@
+#define _POSIX_C_SOURCE 200809L
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <json.h>
+#include "list.h"
+#include "log.h"
+#include "sway/trace.h"
+
+static struct {
+	FILE *file;
+	list_t *tracks; // char *, the track's tid is its index + 1
+} trace;
+
+static int64_t timespec_to_usec(const struct timespec *ts) {
+	return (int64_t)ts->tv_sec * 1000000 + ts->tv_nsec / 1000;
+}
+
+static void write_event(json_object *event) {
+	fprintf(trace.file, "%s,\n", json_object_to_json_string_ext(event,
+			JSON_C_TO_STRING_PLAIN));
+	json_object_put(event);
+}
+
+static json_object *create_event(const char *name, const char *phase,
+		int tid, const struct timespec *when, json_object *args) {
+	json_object *event = json_object_new_object();
+	json_object_object_add(event, "name", json_object_new_string(name));
+	json_object_object_add(event, "ph", json_object_new_string(phase));
+	json_object_object_add(event, "pid", json_object_new_int(getpid()));
+	json_object_object_add(event, "tid", json_object_new_int(tid));
+	if (when) {
+		json_object_object_add(event, "ts",
+				json_object_new_int64(timespec_to_usec(when)));
+	}
+	if (args) {
+		json_object_object_add(event, "args", args);
+	}
+	return event;
+}
+
+static int get_track(const char *track) {
+	for (int i = 0; i < trace.tracks->length; ++i) {
+		if (strcmp(trace.tracks->items[i], track) == 0) {
+			return i + 1;
+		}
+	}
+	list_add(trace.tracks, strdup(track));
+	int tid = trace.tracks->length;
+
+	// Name the track
+	json_object *args = json_object_new_object();
+	json_object_object_add(args, "name", json_object_new_string(track));
+	write_event(create_event("thread_name", "M", tid, NULL, args));
+	return tid;
+}
+
+bool trace_start(const char *path) {
+	trace_stop();
+
+	FILE *file = fopen(path, "w");
+	if (!file) {
+		sway_log_errno(SWAY_ERROR, "Unable to open trace file %s", path);
+		return false;
+	}
+	trace.file = file;
+	trace.tracks = create_list();
+	fprintf(trace.file, "[\n");
+
+	json_object *args = json_object_new_object();
+	json_object_object_add(args, "name", json_object_new_string("sway"));
+	write_event(create_event("process_name", "M", 0, NULL, args));
+
+	sway_log(SWAY_DEBUG, "Started tracing to %s", path);
+	return true;
+}
+
+void trace_stop(void) {
+	if (!trace.file) {
+		return;
+	}
+	// The trailing comma of the last event is allowed by the format, but end
+	// with a complete event anyway for stricter JSON parsers
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	json_object *event = create_event("trace_stop", "i", 0, &now, NULL);
+	json_object_object_add(event, "s", json_object_new_string("g"));
+	fprintf(trace.file, "%s\n]\n", json_object_to_json_string_ext(event,
+			JSON_C_TO_STRING_PLAIN));
+	json_object_put(event);
+
+	fclose(trace.file);
+	trace.file = NULL;
+	list_free_items_and_destroy(trace.tracks);
+	trace.tracks = NULL;
+	sway_log(SWAY_DEBUG, "Stopped tracing");
+}
+
+bool trace_is_active(void) {
+	return trace.file != NULL;
+}
+
+void trace_span(const char *track, const char *name,
+		const struct timespec *start, const struct timespec *end,
+		json_object *args) {
+	if (!trace.file) {
+		json_object_put(args);
+		return;
+	}
+	json_object *event =
+		create_event(name, "X", get_track(track), start, args);
+	int64_t duration = timespec_to_usec(end) - timespec_to_usec(start);
+	json_object_object_add(event, "dur", json_object_new_int64(duration));
+	write_event(event);
+}
+
+void trace_async_span(const char *name, uint64_t id,
+		const struct timespec *start, const struct timespec *end,
+		json_object *args) {
+	if (!trace.file) {
+		json_object_put(args);
+		return;
+	}
+	char id_str[32];
+	snprintf(id_str, sizeof(id_str), "0x%" PRIx64, id);
+
+	json_object *event = create_event(name, "b", 0, start, args);
+	json_object_object_add(event, "cat", json_object_new_string("async"));
+	json_object_object_add(event, "id", json_object_new_string(id_str));
+	write_event(event);
+
+	event = create_event(name, "e", 0, end, NULL);
+	json_object_object_add(event, "cat", json_object_new_string("async"));
+	json_object_object_add(event, "id", json_object_new_string(id_str));
+	write_event(event);
+}
+
+void trace_instant(const char *track, const char *name,
+		const struct timespec *when, json_object *args) {
+	if (!trace.file) {
+		json_object_put(args);
+		return;
+	}
+	json_object *event =
+		create_event(name, "i", get_track(track), when, args);
+	json_object_object_add(event, "s", json_object_new_string("t"));
+	write_event(event);
+}
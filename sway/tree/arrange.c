@@ -5,6 +5,7 @@
 #include <string.h>
 #include <wlr/types/wlr_output.h>
 #include <wlr/types/wlr_output_layout.h>
+#include "sway/desktop/transaction.h"
 #include "sway/tree/arrange.h"
 #include "sway/tree/container.h"
 #include "sway/output.h"
@@ -13,7 +14,8 @@
 #include "list.h"
 #include "log.h"
 
-static void apply_horiz_layout(list_t *children, struct wlr_box *parent) {
+static void apply_horiz_layout(list_t *children, struct wlr_box *parent,
+		bool gaps) {
 	if (!children->length) {
 		return;
 	}
@@ -56,18 +58,9 @@ static void apply_horiz_layout(list_t *children, struct wlr_box *parent) {
 	double inner_gap = 0;
 	struct sway_container *child = children->items[0];
 	struct sway_workspace *ws = child->workspace;
-	if (ws) {
+	if (ws && gaps) {
 		inner_gap = ws->gaps_inner;
 	}
-	// Descendants of tabbed/stacked containers don't have gaps
-	struct sway_container *temp = child;
-	while (temp) {
-		enum sway_container_layout layout = container_parent_layout(temp);
-		if (layout == L_TABBED || layout == L_STACKED) {
-			inner_gap = 0;
-		}
-		temp = temp->parent;
-	}
 	double total_gap = fmin(inner_gap * (children->length - 1),
 		fmax(0, parent->width - MIN_SANE_W * children->length));
 	double child_total_width = parent->width - total_gap;
@@ -92,7 +85,8 @@ static void apply_horiz_layout(list_t *children, struct wlr_box *parent) {
 	}
 }
 
-static void apply_vert_layout(list_t *children, struct wlr_box *parent) {
+static void apply_vert_layout(list_t *children, struct wlr_box *parent,
+		bool gaps) {
 	if (!children->length) {
 		return;
 	}
@@ -135,18 +129,9 @@ static void apply_vert_layout(list_t *children, struct wlr_box *parent) {
 	double inner_gap = 0;
 	struct sway_container *child = children->items[0];
 	struct sway_workspace *ws = child->workspace;
-	if (ws) {
+	if (ws && gaps) {
 		inner_gap = ws->gaps_inner;
 	}
-	// Descendants of tabbed/stacked containers don't have gaps
-	struct sway_container *temp = child;
-	while (temp) {
-		enum sway_container_layout layout = container_parent_layout(temp);
-		if (layout == L_TABBED || layout == L_STACKED) {
-			inner_gap = 0;
-		}
-		temp = temp->parent;
-	}
 	double total_gap = fmin(inner_gap * (children->length - 1),
 		fmax(0, parent->height - MIN_SANE_H * children->length));
 	double child_total_height = parent->height - total_gap;
@@ -200,6 +185,28 @@ static void apply_stacked_layout(list_t *children, struct wlr_box *parent) {
 	}
 }
 
+// Nodes whose pending state matches their current state are left out of the
+// next transaction, so that no-op arranges don't configure their views
+static void set_dirty(struct sway_node *node) {
+	if (transaction_node_changed(node)) {
+		node_set_dirty(node);
+	}
+}
+
+// Descendants of tabbed/stacked containers don't have gaps
+static bool in_tabbed_or_stacked(struct sway_container *con) {
+	for (; con; con = con->parent) {
+		enum sway_container_layout layout = container_parent_layout(con);
+		if (layout == L_TABBED || layout == L_STACKED) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void arrange_container_nested(struct sway_container *container,
+		bool tabbed);
+
 static void arrange_floating(list_t *floating) {
 	for (int i = 0; i < floating->length; ++i) {
 		struct sway_container *floater = floating->items[i];
@@ -207,15 +214,20 @@ static void arrange_floating(list_t *floating) {
 	}
 }
 
+// The tabbed argument is whether the children are within a tabbed or stacked
+// container, which is passed down rather than looked up for each child
 static void arrange_children(list_t *children,
-		enum sway_container_layout layout, struct wlr_box *parent) {
+		enum sway_container_layout layout, struct wlr_box *parent,
+		bool tabbed) {
+	tabbed = tabbed || layout == L_TABBED || layout == L_STACKED;
+
 	// Calculate x, y, width and height of children
 	switch (layout) {
 	case L_HORIZ:
-		apply_horiz_layout(children, parent);
+		apply_horiz_layout(children, parent, !tabbed);
 		break;
 	case L_VERT:
-		apply_vert_layout(children, parent);
+		apply_vert_layout(children, parent, !tabbed);
 		break;
 	case L_TABBED:
 		apply_tabbed_layout(children, parent);
@@ -224,30 +236,37 @@ static void arrange_children(list_t *children,
 		apply_stacked_layout(children, parent);
 		break;
 	case L_NONE:
-		apply_horiz_layout(children, parent);
+		apply_horiz_layout(children, parent, !tabbed);
 		break;
 	}
 
-	// Recurse into child containers
+	// Recurse into child containers. Subtrees are rearranged even if their box
+	// didn't change, as views also depend on borders, gaps and fullscreen
+	// state which callers change without telling arrange.
 	for (int i = 0; i < children->length; ++i) {
 		struct sway_container *child = children->items[i];
-		arrange_container(child);
+		arrange_container_nested(child, tabbed);
 	}
 }
 
-void arrange_container(struct sway_container *container) {
-	if (config->reloading) {
-		return;
-	}
+static void arrange_container_nested(struct sway_container *container,
+		bool tabbed) {
 	if (container->view) {
 		view_autoconfigure(container->view);
-		node_set_dirty(&container->node);
+		set_dirty(&container->node);
 		return;
 	}
 	struct wlr_box box;
 	container_get_box(container, &box);
-	arrange_children(container->children, container->layout, &box);
-	node_set_dirty(&container->node);
+	arrange_children(container->children, container->layout, &box, tabbed);
+	set_dirty(&container->node);
+}
+
+void arrange_container(struct sway_container *container) {
+	if (config->reloading) {
+		return;
+	}
+	arrange_container_nested(container, in_tabbed_or_stacked(container));
 }
 
 void arrange_workspace(struct sway_workspace *workspace) {
@@ -289,7 +308,7 @@ void arrange_workspace(struct sway_workspace *workspace) {
 	}
 
 	workspace_add_gaps(workspace);
-	node_set_dirty(&workspace->node);
+	set_dirty(&workspace->node);
 	sway_log(SWAY_DEBUG, "Arranging workspace '%s' at %f, %f", workspace->name,
 			workspace->x, workspace->y);
 	if (workspace->fullscreen) {
@@ -302,7 +321,7 @@ void arrange_workspace(struct sway_workspace *workspace) {
 	} else {
 		struct wlr_box box;
 		workspace_get_box(workspace, &box);
-		arrange_children(workspace->tiling, workspace->layout, &box);
+		arrange_children(workspace->tiling, workspace->layout, &box, false);
 		arrange_floating(workspace->floating);
 	}
 }
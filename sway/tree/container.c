@@ -10,6 +10,7 @@
 #include "pango.h"
 #include "sway/config.h"
 #include "sway/desktop.h"
+#include "sway/desktop/titlebar_cache.h"
 #include "sway/desktop/transaction.h"
 #include "sway/input/input-manager.h"
 #include "sway/input/seat.h"
@@ -58,19 +59,12 @@ void container_destroy(struct sway_container *con) {
 	}
 	free(con->title);
 	free(con->formatted_title);
-	wlr_texture_destroy(con->title_focused);
-	wlr_texture_destroy(con->title_focused_inactive);
-	wlr_texture_destroy(con->title_unfocused);
-	wlr_texture_destroy(con->title_urgent);
 	list_free(con->children);
 	list_free(con->current.children);
 	list_free(con->outputs);
 
 	list_free_items_and_destroy(con->marks);
-	wlr_texture_destroy(con->marks_focused);
-	wlr_texture_destroy(con->marks_focused_inactive);
-	wlr_texture_destroy(con->marks_unfocused);
-	wlr_texture_destroy(con->marks_urgent);
+	container_release_textures(con);
 
 	if (con->view) {
 		if (con->view->container == con) {
@@ -173,6 +167,10 @@ static struct sway_container *surface_at_view(struct sway_container *con, double
 		return NULL;
 	}
 	struct sway_view *view = con->view;
+	if (!view->surface) {
+		// Unmapped, but still shown until its transaction is applied
+		return NULL;
+	}
 	double view_sx = lx - con->surface_x + view->geometry.x;
 	double view_sy = ly - con->surface_y + view->geometry.y;
 
@@ -399,7 +397,10 @@ struct sway_container *container_at(struct sway_workspace *workspace,
 		}
 	}
 	// Tiling (non-focused)
-	if ((c = tiling_container_at(&workspace->node, lx, ly, surface, sx, sy))) {
+	if ((c = hit_index_container_at(workspace, lx, ly))) {
+		if (c->view) {
+			surface_at_view(c, lx, ly, surface, sx, sy);
+		}
 		return c;
 	}
 	return NULL;
@@ -446,83 +447,76 @@ struct sway_output *container_get_effective_output(struct sway_container *con) {
 	return con->outputs->items[con->outputs->length - 1];
 }
 
-static void update_title_texture(struct sway_container *con,
-		struct wlr_texture **texture, struct border_colors *class) {
-	struct sway_output *output = container_get_effective_output(con);
-	if (!output) {
-		return;
+static struct wlr_texture **texture_slot(struct border_colors *class,
+		struct wlr_texture **focused, struct wlr_texture **focused_inactive,
+		struct wlr_texture **unfocused, struct wlr_texture **urgent) {
+	if (class == &config->border_colors.focused) {
+		return focused;
+	} else if (class == &config->border_colors.focused_inactive) {
+		return focused_inactive;
+	} else if (class == &config->border_colors.unfocused) {
+		return unfocused;
+	} else if (class == &config->border_colors.urgent) {
+		return urgent;
 	}
-	if (*texture) {
-		wlr_texture_destroy(*texture);
-		*texture = NULL;
+	sway_assert(false, "Unknown border color class");
+	return NULL;
+}
+
+static void release_title_textures(struct sway_container *con) {
+	titlebar_cache_release(con->title_focused);
+	titlebar_cache_release(con->title_focused_inactive);
+	titlebar_cache_release(con->title_unfocused);
+	titlebar_cache_release(con->title_urgent);
+	con->title_focused = NULL;
+	con->title_focused_inactive = NULL;
+	con->title_unfocused = NULL;
+	con->title_urgent = NULL;
+	con->title_textures_empty = false;
+}
+
+static void release_marks_textures(struct sway_container *con) {
+	titlebar_cache_release(con->marks_focused);
+	titlebar_cache_release(con->marks_focused_inactive);
+	titlebar_cache_release(con->marks_unfocused);
+	titlebar_cache_release(con->marks_urgent);
+	con->marks_focused = NULL;
+	con->marks_focused_inactive = NULL;
+	con->marks_unfocused = NULL;
+	con->marks_urgent = NULL;
+	con->marks_textures_empty = false;
+}
+
+void container_release_textures(struct sway_container *con) {
+	release_title_textures(con);
+	release_marks_textures(con);
+}
+
+struct wlr_texture *container_get_title_texture(struct sway_container *con,
+		struct border_colors *class) {
+	struct wlr_texture **texture = texture_slot(class, &con->title_focused,
+			&con->title_focused_inactive, &con->title_unfocused,
+			&con->title_urgent);
+	if (!texture) {
+		return NULL;
 	}
-	if (!con->formatted_title) {
-		return;
+	if (*texture || !con->formatted_title || con->title_textures_empty) {
+		return *texture;
 	}
-
-	double scale = output->wlr_output->scale;
-	int width = 0;
-	int height = con->title_height * scale;
-
-	// We must use a non-nil cairo_t for cairo_set_font_options to work.
-	// Therefore, we cannot use cairo_create(NULL).
-	cairo_surface_t *dummy_surface = cairo_image_surface_create(
-			CAIRO_FORMAT_ARGB32, 0, 0);
-	cairo_t *c = cairo_create(dummy_surface);
-	cairo_set_antialias(c, CAIRO_ANTIALIAS_BEST);
-	cairo_font_options_t *fo = cairo_font_options_create();
-	cairo_font_options_set_hint_style(fo, CAIRO_HINT_STYLE_FULL);
-	if (output->wlr_output->subpixel == WL_OUTPUT_SUBPIXEL_NONE) {
-		cairo_font_options_set_antialias(fo, CAIRO_ANTIALIAS_GRAY);
-	} else {
-		cairo_font_options_set_antialias(fo, CAIRO_ANTIALIAS_SUBPIXEL);
-		cairo_font_options_set_subpixel_order(fo,
-			to_cairo_subpixel_order(output->wlr_output->subpixel));
-	}
-	cairo_set_font_options(c, fo);
-	get_text_size(c, config->font, &width, NULL, NULL, scale,
-			config->pango_markup, "%s", con->formatted_title);
-	cairo_surface_destroy(dummy_surface);
-	cairo_destroy(c);
-
-	cairo_surface_t *surface = cairo_image_surface_create(
-			CAIRO_FORMAT_ARGB32, width, height);
-	cairo_t *cairo = cairo_create(surface);
-	cairo_set_antialias(cairo, CAIRO_ANTIALIAS_BEST);
-	cairo_set_font_options(cairo, fo);
-	cairo_font_options_destroy(fo);
-	cairo_set_source_rgba(cairo, class->background[0], class->background[1],
-			class->background[2], class->background[3]);
-	cairo_paint(cairo);
-	PangoContext *pango = pango_cairo_create_context(cairo);
-	cairo_set_source_rgba(cairo, class->text[0], class->text[1],
-			class->text[2], class->text[3]);
-	cairo_move_to(cairo, 0, 0);
-
-	pango_printf(cairo, config->font, scale, config->pango_markup,
-			"%s", con->formatted_title);
-
-	cairo_surface_flush(surface);
-	unsigned char *data = cairo_image_surface_get_data(surface);
-	int stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, width);
-	struct wlr_renderer *renderer = wlr_backend_get_renderer(
-			output->wlr_output->backend);
-	*texture = wlr_texture_from_pixels(
-			renderer, WL_SHM_FORMAT_ARGB8888, stride, width, height, data);
-	cairo_surface_destroy(surface);
-	g_object_unref(pango);
-	cairo_destroy(cairo);
+	struct sway_output *output = container_get_effective_output(con);
+	if (!output) {
+		return NULL;
+	}
+	*texture = titlebar_cache_get(output, TITLEBAR_TEXT_TITLE,
+			con->formatted_title, con->title_height, class);
+	// Don't render it again every frame until the title changes
+	con->title_textures_empty = !*texture;
+	return *texture;
 }
 
 void container_update_title_textures(struct sway_container *container) {
-	update_title_texture(container, &container->title_focused,
-			&config->border_colors.focused);
-	update_title_texture(container, &container->title_focused_inactive,
-			&config->border_colors.focused_inactive);
-	update_title_texture(container, &container->title_unfocused,
-			&config->border_colors.unfocused);
-	update_title_texture(container, &container->title_urgent,
-			&config->border_colors.urgent);
+	// Textures are rendered again when they are next displayed
+	release_title_textures(container);
 	container_damage_whole(container);
 }
 
@@ -1465,6 +1459,7 @@ bool container_find_and_unmark(char *mark) {
 			list_del(con->marks, i);
 			container_update_marks_textures(con);
 			ipc_event_window(con, "mark");
+			ipc_event_tree_property(&con->node, "marks");
 			return true;
 		}
 	}
@@ -1477,6 +1472,7 @@ void container_clear_marks(struct sway_container *con) {
 	}
 	con->marks->length = 0;
 	ipc_event_window(con, "mark");
+	ipc_event_tree_property(&con->node, "marks");
 }
 
 bool container_has_mark(struct sway_container *con, char *mark) {
@@ -1492,20 +1488,26 @@ bool container_has_mark(struct sway_container *con, char *mark) {
 void container_add_mark(struct sway_container *con, char *mark) {
 	list_add(con->marks, strdup(mark));
 	ipc_event_window(con, "mark");
+	ipc_event_tree_property(&con->node, "marks");
 }
 
-static void update_marks_texture(struct sway_container *con,
-		struct wlr_texture **texture, struct border_colors *class) {
-	struct sway_output *output = container_get_effective_output(con);
-	if (!output) {
-		return;
+struct wlr_texture *container_get_marks_texture(struct sway_container *con,
+		struct border_colors *class) {
+	if (!config->show_marks) {
+		return NULL;
 	}
-	if (*texture) {
-		wlr_texture_destroy(*texture);
-		*texture = NULL;
+	struct wlr_texture **texture = texture_slot(class, &con->marks_focused,
+			&con->marks_focused_inactive, &con->marks_unfocused,
+			&con->marks_urgent);
+	if (!texture) {
+		return NULL;
 	}
-	if (!con->marks->length) {
-		return;
+	if (*texture || !con->marks->length || con->marks_textures_empty) {
+		return *texture;
+	}
+	struct sway_output *output = container_get_effective_output(con);
+	if (!output) {
+		return NULL;
 	}
 
 	size_t len = 0;
@@ -1515,12 +1517,17 @@ static void update_marks_texture(struct sway_container *con,
 			len += strlen(mark) + 2;
 		}
 	}
+	if (len == 0) {
+		con->marks_textures_empty = true;
+		return NULL;
+	}
 	char *buffer = calloc(len + 1, 1);
 	char *part = malloc(len + 1);
 
 	if (!sway_assert(buffer && part, "Unable to allocate memory")) {
 		free(buffer);
-		return;
+		free(part);
+		return NULL;
 	}
 
 	for (int i = 0; i < con->marks->length; ++i) {
@@ -1532,54 +1539,16 @@ static void update_marks_texture(struct sway_container *con,
 	}
 	free(part);
 
-	double scale = output->wlr_output->scale;
-	int width = 0;
-	int height = con->title_height * scale;
-
-	cairo_t *c = cairo_create(NULL);
-	get_text_size(c, config->font, &width, NULL, NULL, scale, false,
-			"%s", buffer);
-	cairo_destroy(c);
-
-	cairo_surface_t *surface = cairo_image_surface_create(
-			CAIRO_FORMAT_ARGB32, width, height);
-	cairo_t *cairo = cairo_create(surface);
-	cairo_set_source_rgba(cairo, class->background[0], class->background[1],
-			class->background[2], class->background[3]);
-	cairo_paint(cairo);
-	PangoContext *pango = pango_cairo_create_context(cairo);
-	cairo_set_antialias(cairo, CAIRO_ANTIALIAS_BEST);
-	cairo_set_source_rgba(cairo, class->text[0], class->text[1],
-			class->text[2], class->text[3]);
-	cairo_move_to(cairo, 0, 0);
-
-	pango_printf(cairo, config->font, scale, false, "%s", buffer);
-
-	cairo_surface_flush(surface);
-	unsigned char *data = cairo_image_surface_get_data(surface);
-	int stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, width);
-	struct wlr_renderer *renderer = wlr_backend_get_renderer(
-			output->wlr_output->backend);
-	*texture = wlr_texture_from_pixels(
-			renderer, WL_SHM_FORMAT_ARGB8888, stride, width, height, data);
-	cairo_surface_destroy(surface);
-	g_object_unref(pango);
-	cairo_destroy(cairo);
+	*texture = titlebar_cache_get(output, TITLEBAR_TEXT_MARKS, buffer,
+			con->title_height, class);
 	free(buffer);
+	con->marks_textures_empty = !*texture;
+	return *texture;
 }
 
 void container_update_marks_textures(struct sway_container *con) {
-	if (!config->show_marks) {
-		return;
-	}
-	update_marks_texture(con, &con->marks_focused,
-			&config->border_colors.focused);
-	update_marks_texture(con, &con->marks_focused_inactive,
-			&config->border_colors.focused_inactive);
-	update_marks_texture(con, &con->marks_unfocused,
-			&config->border_colors.unfocused);
-	update_marks_texture(con, &con->marks_urgent,
-			&config->border_colors.urgent);
+	// Textures are rendered again when they are next displayed
+	release_marks_textures(con);
 	container_damage_whole(con);
 }
 
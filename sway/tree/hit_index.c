@@ -0,0 +1,319 @@
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wlr/types/wlr_box.h>
+#include "sway/input/input-manager.h"
+#include "sway/input/seat.h"
+#include "sway/tree/container.h"
+#include "sway/tree/hit_index.h"
+#include "sway/tree/node.h"
+#include "sway/tree/view.h"
+#include "sway/tree/workspace.h"
+#include "list.h"
+#include "log.h"
+
+/**
+ * Containers which are being destroyed are no longer in the pending tree, but
+ * the index may still refer to them until it is rebuilt, and their views may
+ * already have lost their surfaces, which the caller would look up.
+ */
+static bool container_is_hittable(struct sway_container *con) {
+	return !con->node.destroying && (!con->view || con->view->surface);
+}
+
+/**
+ * The region which tabbed and stacked ancestors restrict hits to, as they only
+ * look into their children for points within their own box. All its edges are
+ * inclusive.
+ */
+struct hit_clip {
+	double x1, y1, x2, y2;
+};
+
+static void add_rect(struct sway_hit_index *index, struct hit_clip *clip,
+		double x, double y, double width, double height,
+		bool right_edge, bool bottom_edge, struct sway_container *con) {
+	if (!container_is_hittable(con)) {
+		return;
+	}
+	double x2 = x + width, y2 = y + height;
+	x = fmax(x, clip->x1);
+	y = fmax(y, clip->y1);
+	if (x2 > clip->x2) {
+		x2 = clip->x2;
+		right_edge = true;
+	}
+	if (y2 > clip->y2) {
+		y2 = clip->y2;
+		bottom_edge = true;
+	}
+	if (x2 < x || y2 < y || (x2 == x && !right_edge) ||
+			(y2 == y && !bottom_edge)) {
+		return;
+	}
+	if (index->rects_len == index->rects_cap) {
+		int cap = index->rects_cap ? index->rects_cap * 2 : 32;
+		struct sway_hit_rect *rects =
+			realloc(index->rects, cap * sizeof(struct sway_hit_rect));
+		if (!sway_assert(rects, "Unable to allocate hit rects")) {
+			return;
+		}
+		index->rects = rects;
+		index->rects_cap = cap;
+	}
+	index->rects[index->rects_len++] = (struct sway_hit_rect){
+		.x = x, .y = y, .width = x2 - x, .height = y2 - y,
+		.right_edge = right_edge, .bottom_edge = bottom_edge, .con = con,
+	};
+}
+
+/**
+ * Add the rects of the node in the order and with the edges
+ * tiling_container_at would find them: titlebars of tabbed and stacked
+ * containers take priority over their active child.
+ */
+static void add_node(struct sway_hit_index *index, struct hit_clip clip,
+		struct sway_node *node) {
+	if (node_is_view(node)) {
+		struct sway_container *con = node->sway_container;
+		struct wlr_box box = {
+			.x = con->x,
+			.y = con->y,
+			.width = con->width,
+			.height = con->height,
+		};
+		if (box.width > 0 && box.height > 0) {
+			add_rect(index, &clip, box.x, box.y, box.width, box.height,
+					true, true, con);
+		}
+		return;
+	}
+	list_t *children = node_get_children(node);
+	if (!children) {
+		return;
+	}
+	enum sway_container_layout layout = node_get_layout(node);
+	if (layout == L_HORIZ || layout == L_VERT) {
+		for (int i = 0; i < children->length; ++i) {
+			struct sway_container *child = children->items[i];
+			add_node(index, clip, &child->node);
+		}
+		return;
+	}
+	if ((layout != L_TABBED && layout != L_STACKED) || !children->length) {
+		return;
+	}
+
+	struct wlr_box box;
+	node_get_box(node, &box);
+	clip.x1 = fmax(clip.x1, box.x);
+	clip.y1 = fmax(clip.y1, box.y);
+	clip.x2 = fmin(clip.x2, box.x + box.width);
+	clip.y2 = fmin(clip.y2, box.y + box.height);
+
+	int title_height = container_titlebar_height();
+	if (title_height > 0 && layout == L_TABBED) {
+		int tab_width = box.width / children->length;
+		for (int i = 0; i < children->length; ++i) {
+			int tab_x = box.x + tab_width * i;
+			// The last tab also gets what's left of the parent's width
+			bool last = i == children->length - 1;
+			add_rect(index, &clip, tab_x, box.y,
+					last ? box.x + box.width - tab_x : tab_width,
+					title_height, last, false, children->items[i]);
+		}
+	} else if (title_height > 0) {
+		for (int i = 0; i < children->length; ++i) {
+			add_rect(index, &clip, box.x, box.y + title_height * i,
+					box.width, title_height, true, false,
+					children->items[i]);
+		}
+	}
+
+	struct sway_node *active = seat_get_active_tiling_child(index->seat, node);
+	if (active) {
+		add_node(index, clip, active);
+	}
+}
+
+static int clamp_cell(double offset, double cell_size, int max) {
+	if (cell_size <= 0) {
+		return 0;
+	}
+	int cell = offset / cell_size;
+	return cell < 0 ? 0 : cell >= max ? max - 1 : cell;
+}
+
+static void rect_cells(struct sway_hit_index *index,
+		struct sway_hit_rect *rect, int *c0, int *r0, int *c1, int *r1) {
+	double cell_width = index->width / index->cols;
+	double cell_height = index->height / index->rows;
+	*c0 = clamp_cell(rect->x - index->x, cell_width, index->cols);
+	*r0 = clamp_cell(rect->y - index->y, cell_height, index->rows);
+	*c1 = clamp_cell(rect->x + rect->width - index->x, cell_width,
+			index->cols);
+	*r1 = clamp_cell(rect->y + rect->height - index->y, cell_height,
+			index->rows);
+}
+
+static bool build_grid(struct sway_hit_index *index) {
+	double x1 = index->rects[0].x, y1 = index->rects[0].y;
+	double x2 = x1 + index->rects[0].width, y2 = y1 + index->rects[0].height;
+	for (int i = 1; i < index->rects_len; ++i) {
+		struct sway_hit_rect *rect = &index->rects[i];
+		x1 = fmin(x1, rect->x);
+		y1 = fmin(y1, rect->y);
+		x2 = fmax(x2, rect->x + rect->width);
+		y2 = fmax(y2, rect->y + rect->height);
+	}
+	index->x = x1;
+	index->y = y1;
+	index->width = x2 - x1;
+	index->height = y2 - y1;
+
+	// Aim for about one rect per cell, with roughly square cells
+	int n = index->rects_len;
+	if (index->width <= 0 || index->height <= 0) {
+		index->cols = 1;
+	} else {
+		index->cols = ceil(sqrt(n * index->width / index->height));
+	}
+	if (index->cols < 1) {
+		index->cols = 1;
+	} else if (index->cols > n) {
+		index->cols = n;
+	}
+	index->rows = (n + index->cols - 1) / index->cols;
+
+	int ncells = index->cols * index->rows;
+	if (ncells + 1 > index->cells_cap) {
+		int *cell_start = realloc(index->cell_start,
+				(ncells + 1) * sizeof(int));
+		if (!sway_assert(cell_start, "Unable to allocate hit grid")) {
+			return false;
+		}
+		index->cell_start = cell_start;
+		index->cells_cap = ncells + 1;
+	}
+	memset(index->cell_start, 0, (ncells + 1) * sizeof(int));
+
+	// Count the rects in each cell, then turn the counts into end offsets
+	int c0, r0, c1, r1;
+	for (int i = 0; i < n; ++i) {
+		rect_cells(index, &index->rects[i], &c0, &r0, &c1, &r1);
+		for (int r = r0; r <= r1; ++r) {
+			for (int c = c0; c <= c1; ++c) {
+				++index->cell_start[r * index->cols + c];
+			}
+		}
+	}
+	for (int i = 1; i < ncells; ++i) {
+		index->cell_start[i] += index->cell_start[i - 1];
+	}
+	int total = index->cell_start[ncells - 1];
+	index->cell_start[ncells] = total;
+
+	if (total > index->cell_rects_cap) {
+		int *cell_rects = realloc(index->cell_rects, total * sizeof(int));
+		if (!sway_assert(cell_rects, "Unable to allocate hit grid")) {
+			return false;
+		}
+		index->cell_rects = cell_rects;
+		index->cell_rects_cap = total;
+	}
+
+	// Filling backwards leaves each cell's rects in priority order and the
+	// offsets pointing at the start of each cell
+	for (int i = n - 1; i >= 0; --i) {
+		rect_cells(index, &index->rects[i], &c0, &r0, &c1, &r1);
+		for (int r = r0; r <= r1; ++r) {
+			for (int c = c0; c <= c1; ++c) {
+				int cell = r * index->cols + c;
+				index->cell_rects[--index->cell_start[cell]] = i;
+			}
+		}
+	}
+	return true;
+}
+
+static void hit_index_rebuild(struct sway_hit_index *index,
+		struct sway_workspace *ws, struct sway_seat *seat) {
+	index->rects_len = 0;
+	index->cols = index->rows = 0;
+	index->seat = seat;
+	struct hit_clip clip = { -INFINITY, -INFINITY, INFINITY, INFINITY };
+	add_node(index, clip, &ws->node);
+	if (index->rects_len && !build_grid(index)) {
+		index->rects_len = 0;
+		return;
+	}
+	index->valid = true;
+}
+
+void hit_index_invalidate(struct sway_hit_index *index) {
+	index->valid = false;
+}
+
+void hit_index_invalidate_node(struct sway_node *node) {
+	struct sway_workspace *ws = NULL;
+	switch (node->type) {
+	case N_ROOT:
+	case N_OUTPUT:
+		// Moving an output rearranges its workspaces, which dirties them
+		return;
+	case N_WORKSPACE:
+		ws = node->sway_workspace;
+		break;
+	case N_CONTAINER:
+		if (container_is_floating_or_child(node->sway_container)) {
+			return;
+		}
+		ws = node->sway_container->workspace;
+		break;
+	}
+	if (ws) {
+		hit_index_invalidate(&ws->hit_index);
+	}
+}
+
+void hit_index_finish(struct sway_hit_index *index) {
+	free(index->rects);
+	free(index->cell_start);
+	free(index->cell_rects);
+	memset(index, 0, sizeof(struct sway_hit_index));
+}
+
+struct sway_container *hit_index_container_at(struct sway_workspace *ws,
+		double lx, double ly) {
+	struct sway_hit_index *index = &ws->hit_index;
+	struct sway_seat *seat = input_manager_current_seat();
+	if (!index->valid || index->seat != seat) {
+		hit_index_rebuild(index, ws, seat);
+	}
+	if (!index->rects_len || lx < index->x || ly < index->y ||
+			lx > index->x + index->width || ly > index->y + index->height) {
+		return NULL;
+	}
+
+	int col = clamp_cell(lx - index->x, index->width / index->cols,
+			index->cols);
+	int row = clamp_cell(ly - index->y, index->height / index->rows,
+			index->rows);
+	int cell = row * index->cols + col;
+	for (int i = index->cell_start[cell]; i < index->cell_start[cell + 1];
+			++i) {
+		struct sway_hit_rect *rect = &index->rects[index->cell_rects[i]];
+		// A view can be unmapped without the index being rebuilt
+		if (!container_is_hittable(rect->con)) {
+			continue;
+		}
+		double x2 = rect->x + rect->width, y2 = rect->y + rect->height;
+		if (lx >= rect->x && (lx < x2 || (rect->right_edge && lx == x2)) &&
+				ly >= rect->y && (ly < y2 || (rect->bottom_edge && ly == y2))) {
+			return rect->con;
+		}
+	}
+	return NULL;
+}
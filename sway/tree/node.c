@@ -2,6 +2,7 @@
 #include "sway/output.h"
 #include "sway/server.h"
 #include "sway/tree/container.h"
+#include "sway/tree/hit_index.h"
 #include "sway/tree/node.h"
 #include "sway/tree/root.h"
 #include "sway/tree/workspace.h"
@@ -30,6 +31,9 @@ const char *node_type_to_str(enum sway_node_type type) {
 }
 
 void node_set_dirty(struct sway_node *node) {
+	// Every change to the pending tree goes through here, including those
+	// made while the node is already dirty
+	hit_index_invalidate_node(node);
 	if (node->dirty) {
 		return;
 	}
@@ -101,6 +101,7 @@ struct sway_output *output_create(struct wlr_output *wlr_output) {
 
 	output->workspaces = create_list();
 	output->current.workspaces = create_list();
+	output_damage_stats_init(output);
 
 	size_t len = sizeof(output->layers) / sizeof(output->layers[0]);
 	for (size_t i = 0; i < len; ++i) {
@@ -235,6 +236,7 @@ void output_destroy(struct sway_output *output) {
 	}
 	list_free(output->workspaces);
 	list_free(output->current.workspaces);
+	output_damage_stats_finish(output);
 	wl_event_source_remove(output->repaint_timer);
 	free(output);
 }
@@ -60,6 +60,7 @@ void view_destroy(struct sway_view *view) {
 		view_remove_saved_buffer(view);
 	}
 	list_free(view->executed_criteria);
+	list_free(view->attribute_criteria);
 
 	free(view->title_format);
 
@@ -495,7 +496,7 @@ void view_execute_criteria(struct sway_view *view) {
 		sway_log(SWAY_DEBUG, "for_window '%s' matches view %p, cmd: '%s'",
 				criteria->raw, view, criteria->cmdlist);
 		list_add(view->executed_criteria, criteria);
-		list_t *res_list = execute_command(
+		list_t *res_list = execute_compiled_command(&criteria->program,
 				criteria->cmdlist, NULL, view->container);
 		while (res_list->length) {
 			struct cmd_results *res = res_list->items[0];
@@ -689,6 +690,8 @@ void view_map(struct sway_view *view, struct wlr_surface *wlr_surface,
 	}
 	view->surface = wlr_surface;
 	view_populate_pid(view);
+	// Attributes may have changed while the view was unmapped
+	criteria_invalidate_view(view);
 	view->container = container_create(view);
 
 	// If there is a request to be opened fullscreen on a specific output, try
@@ -843,7 +846,9 @@ void view_unmap(struct sway_view *view) {
 		seat_consider_warp_to_focus(seat);
 	}
 
-	transaction_commit_dirty();
+	// The closing view's buffer is saved by the commit, which can't be
+	// batched as the surface is gone afterwards
+	transaction_commit_dirty_now();
 	view->surface = NULL;
 }
 
@@ -1219,6 +1224,7 @@ void view_update_title(struct sway_view *view, bool force) {
 	container_update_title_textures(view->container);
 
 	ipc_event_window(view->container, "title");
+	ipc_event_tree_property(&view->container->node, "name");
 
 	if (view->foreign_toplevel && title) {
 		wlr_foreign_toplevel_handle_v1_set_title(view->foreign_toplevel, title);
@@ -1297,6 +1303,8 @@ void view_set_urgent(struct sway_view *view, bool enable) {
 	container_damage_whole(view->container);
 
 	ipc_event_window(view->container, "urgent");
+	ipc_event_tree_property(&view->container->node, "urgent");
+	ipc_event_tree_ancestors_urgency(view->container);
 
 	if (!container_is_scratchpad_hidden(view->container)) {
 		workspace_detect_urgent(view->container->workspace);
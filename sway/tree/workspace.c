@@ -136,6 +136,7 @@ void workspace_destroy(struct sway_workspace *workspace) {
 	list_free(workspace->tiling);
 	list_free(workspace->current.floating);
 	list_free(workspace->current.tiling);
+	hit_index_finish(&workspace->hit_index);
 	free(workspace);
 }
 
@@ -581,6 +582,7 @@ void workspace_detect_urgent(struct sway_workspace *workspace) {
 	if (workspace->urgent != new_urgent) {
 		workspace->urgent = new_urgent;
 		ipc_event_workspace(NULL, workspace, "urgent");
+		ipc_event_tree_property(&workspace->node, "urgent");
 		output_damage_whole(workspace->output);
 	}
 }
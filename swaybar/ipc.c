@@ -13,6 +13,7 @@
 #endif
 #include "config.h"
 #include "ipc-client.h"
+#include "ipc-encoding.h"
 #include "list.h"
 #include "log.h"
 #include "loop.h"
@@ -95,14 +96,12 @@ static void ipc_parse_colors(
 }
 
 static bool ipc_parse_config(
-		struct swaybar_config *config, const char *payload) {
-	json_object *bar_config = json_tokener_parse(payload);
+		struct swaybar_config *config, json_object *bar_config) {
 	json_object *success;
 	if (json_object_object_get_ex(bar_config, "success", &success)
 			&& !json_object_get_boolean(success)) {
 		sway_log(SWAY_ERROR, "No bar with that ID. Use 'swaymsg -t "
 				"get_bar_config' to get the available bar configs.");
-		json_object_put(bar_config);
 		return false;
 	}
 
@@ -325,7 +324,6 @@ static bool ipc_parse_config(
 	}
 #endif
 
-	json_object_put(bar_config);
 	return true;
 }
 
@@ -338,7 +336,7 @@ bool ipc_get_workspaces(struct swaybar *bar) {
 	uint32_t len = 0;
 	char *res = ipc_single_command(bar->ipc_socketfd,
 			IPC_GET_WORKSPACES, NULL, &len);
-	json_object *results = json_tokener_parse(res);
+	json_object *results = ipc_parse_payload(res, len, bar->ipc_msgpack);
 	if (!results) {
 		free(res);
 		return false;
@@ -409,19 +407,29 @@ void ipc_execute_binding(struct swaybar *bar, struct swaybar_binding *bind) {
 }
 
 bool ipc_initialize(struct swaybar *bar) {
+	// Older versions of sway don't reply to unknown message types, but
+	// swaybar is only ever used with the sway it was built with
+	bar->ipc_msgpack = ipc_set_encoding(bar->ipc_socketfd, "msgpack")
+		&& ipc_set_encoding(bar->ipc_event_socketfd, "msgpack");
+	if (!bar->ipc_msgpack) {
+		ipc_set_encoding(bar->ipc_socketfd, "json");
+	}
+
 	uint32_t len = strlen(bar->id);
 	char *res = ipc_single_command(bar->ipc_socketfd,
 			IPC_GET_BAR_CONFIG, bar->id, &len);
-	if (!ipc_parse_config(bar->config, res)) {
-		free(res);
+	json_object *bar_config = ipc_parse_payload(res, len, bar->ipc_msgpack);
+	free(res);
+	bool parsed = ipc_parse_config(bar->config, bar_config);
+	json_object_put(bar_config);
+	if (!parsed) {
 		return false;
 	}
-	free(res);
 
 	struct swaybar_config *config = bar->config;
 	char subscribe[128]; // suitably large buffer
 	len = snprintf(subscribe, 128,
-			"[ \"barconfig_update\" , \"bar_state_update\" %s %s ]",
+			"[ \"barconfig_update\" , \"bar_state_update\" , \"coalesce\" %s %s ]",
 			config->binding_mode_indicator ? ", \"mode\"" : "",
 			config->workspace_buttons ? ", \"workspace\"" : "");
 	free(ipc_single_command(bar->ipc_event_socketfd,
@@ -450,7 +458,7 @@ static bool handle_bar_state_update(struct swaybar *bar, json_object *event) {
 	return determine_bar_visibility(bar, false);
 }
 
-static bool handle_barconfig_update(struct swaybar *bar, const char *payload,
+static bool handle_barconfig_update(struct swaybar *bar,
 		json_object *json_config) {
 	json_object *json_id = json_object_object_get(json_config, "id");
 	const char *id = json_object_get_string(json_id);
@@ -459,7 +467,7 @@ static bool handle_barconfig_update(struct swaybar *bar, const char *payload,
 	}
 
 	struct swaybar_config *newcfg = init_config();
-	ipc_parse_config(newcfg, payload);
+	ipc_parse_config(newcfg, json_config);
 
 	struct swaybar_config *oldcfg = bar->config;
 	bar->config = newcfg;
@@ -541,9 +549,10 @@ bool handle_ipc_readable(struct swaybar *bar) {
 		return false;
 	}
 
-	json_object *result = json_tokener_parse(resp->payload);
+	json_object *result =
+		ipc_parse_payload(resp->payload, resp->size, bar->ipc_msgpack);
 	if (!result) {
-		sway_log(SWAY_ERROR, "failed to parse payload as json");
+		sway_log(SWAY_ERROR, "failed to parse payload");
 		free_ipc_response(resp);
 		return false;
 	}
@@ -573,7 +582,7 @@ bool handle_ipc_readable(struct swaybar *bar) {
 		break;
 	}
 	case IPC_EVENT_BARCONFIG_UPDATE:
-		bar_is_dirty = handle_barconfig_update(bar, resp->payload, result);
+		bar_is_dirty = handle_barconfig_update(bar, result);
 		break;
 	case IPC_EVENT_BAR_STATE_UPDATE:
 		bar_is_dirty = handle_bar_state_update(bar, result);
@@ -13,6 +13,7 @@
 #include <json.h>
 #include "stringop.h"
 #include "ipc-client.h"
+#include "ipc-encoding.h"
 #include "log.h"
 
 void sway_terminate(int exit_code) {
@@ -190,7 +191,8 @@ static void pretty_print_output(json_object *o) {
 	json_object_object_get_ex(o, "active", &active);
 	json_object_object_get_ex(o, "current_workspace", &ws);
 	json_object *make, *model, *serial, *scale, *scale_filter, *subpixel,
-		*transform, *max_render_time, *adaptive_sync_status;
+		*transform, *max_render_time, *max_render_time_auto,
+		*adaptive_sync_status;
 	json_object_object_get_ex(o, "make", &make);
 	json_object_object_get_ex(o, "model", &model);
 	json_object_object_get_ex(o, "serial", &serial);
@@ -199,6 +201,7 @@ static void pretty_print_output(json_object *o) {
 	json_object_object_get_ex(o, "subpixel_hinting", &subpixel);
 	json_object_object_get_ex(o, "transform", &transform);
 	json_object_object_get_ex(o, "max_render_time", &max_render_time);
+	json_object_object_get_ex(o, "max_render_time_auto", &max_render_time_auto);
 	json_object_object_get_ex(o, "adaptive_sync_status", &adaptive_sync_status);
 	json_object *x, *y;
 	json_object_object_get_ex(rect, "x", &x);
@@ -239,7 +242,11 @@ static void pretty_print_output(json_object *o) {
 
 		int max_render_time_int = json_object_get_int(max_render_time);
 		printf("  Max render time: ");
-		printf(max_render_time_int == 0 ? "off\n" : "%d ms\n", max_render_time_int);
+		if (json_object_get_boolean(max_render_time_auto)) {
+			printf("auto (%d ms)\n", max_render_time_int);
+		} else {
+			printf(max_render_time_int == 0 ? "off\n" : "%d ms\n", max_render_time_int);
+		}
 
 		printf("  Adaptive sync: %s\n",
 			json_object_get_string(adaptive_sync_status));
@@ -338,6 +345,7 @@ int main(int argc, char **argv) {
 	static bool quiet = false;
 	static bool raw = false;
 	static bool monitor = false;
+	static bool msgpack = false;
 	char *socket_path = NULL;
 	char *cmdtype = NULL;
 
@@ -346,6 +354,7 @@ int main(int argc, char **argv) {
 	static struct option long_options[] = {
 		{"help", no_argument, NULL, 'h'},
 		{"monitor", no_argument, NULL, 'm'},
+		{"msgpack", no_argument, NULL, 'M'},
 		{"pretty", no_argument, NULL, 'p'},
 		{"quiet", no_argument, NULL, 'q'},
 		{"raw", no_argument, NULL, 'r'},
@@ -360,6 +369,7 @@ int main(int argc, char **argv) {
 		"\n"
 		"  -h, --help             Show help message and quit.\n"
 		"  -m, --monitor          Monitor until killed (-t SUBSCRIBE only)\n"
+		"      --msgpack          Have replies and events sent as MessagePack.\n"
 		"  -p, --pretty           Use pretty output even when not using a tty\n"
 		"  -q, --quiet            Be quiet.\n"
 		"  -r, --raw              Use raw output even if using a tty\n"
@@ -380,6 +390,9 @@ int main(int argc, char **argv) {
 		case 'm': // Monitor
 			monitor = true;
 			break;
+		case 'M': // MessagePack
+			msgpack = true;
+			break;
 		case 'p': // Pretty
 			raw = false;
 			break;
@@ -426,6 +439,12 @@ int main(int argc, char **argv) {
 		type = IPC_GET_WORKSPACES;
 	} else if (strcasecmp(cmdtype, "get_seats") == 0) {
 		type = IPC_GET_SEATS;
+	} else if (strcasecmp(cmdtype, "get_frame_stats") == 0) {
+		type = IPC_GET_FRAME_STATS;
+	} else if (strcasecmp(cmdtype, "get_damage_stats") == 0) {
+		type = IPC_GET_DAMAGE_STATS;
+	} else if (strcasecmp(cmdtype, "get_titlebar_cache") == 0) {
+		type = IPC_GET_TITLEBAR_CACHE;
 	} else if (strcasecmp(cmdtype, "get_inputs") == 0) {
 		type = IPC_GET_INPUTS;
 	} else if (strcasecmp(cmdtype, "get_outputs") == 0) {
@@ -476,16 +495,27 @@ int main(int argc, char **argv) {
 	int socketfd = ipc_open_socket(socket_path);
 	struct timeval timeout = {.tv_sec = 3, .tv_usec = 0};
 	ipc_set_recv_timeout(socketfd, timeout);
+	if (msgpack && !ipc_set_encoding(socketfd, "msgpack")) {
+		if (!quiet) {
+			sway_log(SWAY_ERROR, "sway does not support MessagePack");
+		}
+		close(socketfd);
+		free(command);
+		free(socket_path);
+		return 1;
+	}
 	uint32_t len = strlen(command);
 	char *resp = ipc_single_command(socketfd, type, command, &len);
 
 	// pretty print the json
-	json_object *obj = json_tokener_parse(resp);
+	json_object *obj = ipc_parse_payload(resp, len, msgpack);
 	if (obj == NULL) {
 		if (!quiet) {
 			fprintf(stderr, "ERROR: Could not parse json response from ipc. "
 					"This is a bug in sway.");
-			printf("%s\n", resp);
+			if (!msgpack) {
+				printf("%s\n", resp);
+			}
 		}
 		ret = 1;
 	} else {
@@ -517,7 +547,8 @@ int main(int argc, char **argv) {
 				break;
 			}
 
-			json_object *obj = json_tokener_parse(reply->payload);
+			json_object *obj = ipc_parse_payload(reply->payload,
+					reply->size, msgpack);
 			if (obj == NULL) {
 				if (!quiet) {
 					fprintf(stderr, "ERROR: Could not parse json response from"